@@ -0,0 +1,88 @@
+//! `cargo bench`: median time per call of the libdot kernels next to the pure-Rust loops of
+//! `lia_verif::portable` on the same operands, from 256 to 131072 bits.
+
+use std::hint::black_box;
+use std::time::Instant;
+
+use lia_verif::portable;
+
+const TRIALS: usize = 21;
+const MIN_BATCH_NS: u128 = 200_000; // Batches shorter than this are dominated by the timer
+
+type Kernel = fn(&mut [u64], &[u64], &[u64], bool) -> bool;
+
+const OPERATIONS: &[(&str, Kernel, &str, Kernel)] = &[
+    ("dot_add_nc", lia_verif::add_nc, "rust_add_nc", portable::add_nc),
+    ("dot_sub_nc", lia_verif::sub_nc, "rust_sub_nc", portable::sub_nc),
+];
+
+fn operand(state: &mut u64, n: usize) -> Vec<u64> {
+    (0..n)
+        .map(|_| {
+            *state ^= *state >> 12;
+            *state ^= *state << 25;
+            *state ^= *state >> 27;
+            state.wrapping_mul(0x2545F4914F6CDD1D)
+        })
+        .collect()
+}
+
+// Median nanoseconds per call of kernel over TRIALS batches of the same size
+fn median_ns(kernel: Kernel, r: &mut [u64], a: &[u64], b: &[u64]) -> f64 {
+    let mut reps = 1u32;
+    loop {
+        let start = Instant::now();
+        for _ in 0..reps {
+            black_box(kernel(black_box(&mut *r), black_box(a), black_box(b), false));
+        }
+        if start.elapsed().as_nanos() >= MIN_BATCH_NS {
+            break;
+        }
+        reps <<= 1;
+    }
+
+    let mut samples: Vec<f64> = (0..TRIALS)
+        .map(|_| {
+            let start = Instant::now();
+            for _ in 0..reps {
+                black_box(kernel(black_box(&mut *r), black_box(a), black_box(b), false));
+            }
+            start.elapsed().as_nanos() as f64 / reps as f64
+        })
+        .collect();
+    samples.sort_by(|x, y| x.partial_cmp(y).unwrap());
+    samples[TRIALS / 2]
+}
+
+fn main() {
+    println!(
+        "{:<12} {:>7} {:>6} {:>10} {:>9} {:<12} {:>10} {:>8}",
+        "op", "bits", "limbs", "median_ns", "per_limb", "baseline", "median_ns", "speedup"
+    );
+    for &(name, kernel, baseline_name, baseline) in OPERATIONS {
+        let mut bits = 256;
+        while bits <= 131072 {
+            // The same seed gives the same operands for both routines
+            let mut state = 1;
+            let n = bits / 64;
+            let a = operand(&mut state, n);
+            let b = operand(&mut state, n);
+            let mut r = vec![0; n];
+
+            let ns = median_ns(kernel, &mut r, &a, &b);
+            let baseline_ns = median_ns(baseline, &mut r, &a, &b);
+            println!(
+                "{:<12} {:>7} {:>6} {:>10.1} {:>9.3} {:<12} {:>10.1} {:>7.2}x",
+                name,
+                bits,
+                n,
+                ns,
+                ns / n as f64,
+                baseline_name,
+                baseline_ns,
+                baseline_ns / ns
+            );
+            bits <<= 1;
+        }
+    }
+}
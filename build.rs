@@ -0,0 +1,80 @@
+// Builds libdot.a from the C sources under code/ with the flags of code/Makefile and links it statically.
+// The compiler is taken from $CC, gcc by default.
+
+use std::env;
+use std::path::{Path, PathBuf};
+use std::process::Command;
+
+const SOURCES: &[&str] = &[
+    "src/dot_add.c",
+    "src/dot_sub.c",
+    "src/dot_add_approx.c",
+    "src/dot_sub_approx.c",
+    "src/dot_stream.c",
+    "src/dot_mod.c",
+    "src/dot_ct.c",
+    "src/dot_eval.c",
+    "src/dot_jit.c",
+    "utils/dot_utils.c",
+    "utils/dot_pool.c",
+    "utils/dot_arena.c",
+    "utils/dot_io.c",
+    "utils/dot_mmap.c",
+    "utils/dot_ctx.c",
+];
+
+const CFLAGS: &[&str] = &[
+    "-O2",
+    "-Wall",
+    "-fPIC",
+    "-std=c11",
+    "-mavx512f",
+    "-mavx512vl",
+    "-mavx512bw",
+];
+
+fn run(command: &mut Command) {
+    let status = command
+        .status()
+        .unwrap_or_else(|err| panic!("failed to run {:?}: {}", command, err));
+    if !status.success() {
+        panic!("{:?} exited with {}", command, status);
+    }
+}
+
+fn main() {
+    let root = PathBuf::from(env::var("CARGO_MANIFEST_DIR").unwrap()).join("code");
+    let out = PathBuf::from(env::var("OUT_DIR").unwrap());
+    let cc = env::var("CC").unwrap_or_else(|_| "gcc".to_string());
+
+    let mut objects = Vec::new();
+    for source in SOURCES {
+        let object = out.join(Path::new(source).file_stem().unwrap()).with_extension("o");
+        let mut command = Command::new(&cc);
+        command
+            .args(CFLAGS)
+            .arg("-I")
+            .arg(root.join("include"))
+            .arg("-I")
+            .arg(root.join("utils"));
+        // Same switch as make STATS=1
+        if env::var_os("CARGO_FEATURE_STATS").is_some() {
+            command.arg("-DDOT_ENABLE_STATS");
+        }
+        run(command.arg("-c").arg(root.join(source)).arg("-o").arg(&object));
+        objects.push(object);
+    }
+
+    let library = out.join("libdot.a");
+    let _ = std::fs::remove_file(&library);
+    run(Command::new("ar").arg("crs").arg(&library).args(&objects));
+
+    println!("cargo:rustc-link-search=native={}", out.display());
+    println!("cargo:rustc-link-lib=static=dot");
+    println!("cargo:rustc-link-lib=z");
+    println!("cargo:rustc-link-lib=pthread");
+    println!("cargo:rerun-if-env-changed=CC");
+    for dir in ["src", "utils", "include"] {
+        println!("cargo:rerun-if-changed={}", root.join(dir).display());
+    }
+}
@@ -13,7 +13,10 @@ typedef struct
     aligned_uint64_ptr dot_limbs; // Pointer to the limbs
     bool sign;                    // Sign of the number (true for negative)
     size_t size;                  // Number of limbs
+    size_t used;                  // Number of significant limbs, the limbs above it are zero
+    size_t alloc;                 // Number of limbs available at dot_limbs, size may grow up to it in place
     bool carry;                   // Carry flag
+    bool view;                    // Limbs are borrowed (caller buffer, GMP, arena), not owned by the memory pool
 } dot_limb_t;
 
 // Arithmetic operations
@@ -22,19 +25,203 @@ void dot_sub_n(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
 void dot_add_n_approx(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
 void dot_sub_n_approx(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
 
+// int limb counts, kept for existing callers: past 2^31 limbs use dot_add_nc/dot_sub_nc
 unsigned long dot_add_words(uint64_t *result, const uint64_t *a, const uint64_t *b, int n);
 unsigned long dot_sub_words(uint64_t *result, const uint64_t *a, const uint64_t *b, int n);
 
+// Limb-array primitives with 64-bit counts and a carry/borrow in and out
+uint64_t dot_add_nc(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry);
+uint64_t dot_sub_nc(uint64_t *result, const uint64_t *x, const uint64_t *y, size_t n, uint64_t borrow);
+
+// Modular add/sub of reduced operands, for a modulus array or a pseudo-Mersenne p = 2^k - c
+void dot_addmod(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n);
+void dot_submod(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n);
+void dot_addmod_pm(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, unsigned k, uint64_t c);
+void dot_submod_pm(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, unsigned k, uint64_t c);
+
+// Constant-time add/sub for secret operands, the time depends only on the sizes
+uint64_t dot_add_nc_ct(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry);
+uint64_t dot_sub_nc_ct(uint64_t *result, const uint64_t *x, const uint64_t *y, size_t n, uint64_t borrow);
+void dot_add_n_ct(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
+void dot_sub_n_ct(dot_limb_t *result, dot_limb_t *x, dot_limb_t *y);
+
+// Streaming add/sub over operands delivered in chunks, least significant first
+typedef enum
+{
+    DOT_STREAM_ADD = 0,
+    DOT_STREAM_SUB,
+} dot_stream_op_t;
+
+typedef struct
+{
+    dot_stream_op_t op; // Operation of the stream
+    uint64_t carry;     // Carry or borrow into the next chunk
+    size_t limbs;       // Number of limbs processed so far
+} dot_stream_t;
+
+void dot_stream_init(dot_stream_t *stream, dot_stream_op_t op);
+void dot_stream_update(dot_stream_t *stream, uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n);
+uint64_t dot_stream_finish(dot_stream_t *stream);
+
+// Fused sums and differences: build an expression node by node, dot_eval computes it in one pass
+typedef enum
+{
+    DOT_EXPR_LEAF = 0,
+    DOT_EXPR_ADD,
+    DOT_EXPR_SUB,
+} dot_expr_kind_t;
+
+typedef struct
+{
+    dot_expr_kind_t kind;
+    const dot_limb_t *leaf; // Operand of a leaf
+    size_t left;            // Children of an add or sub
+    size_t right;
+} dot_expr_node_t;
+
+typedef struct
+{
+    dot_expr_node_t *nodes; // Nodes by id, in creation order
+    int64_t *coeffs;        // Scratch of dot_eval
+    size_t count;           // Nodes in use
+    size_t capacity;        // Nodes allocated
+} dot_expr_t;
+
+void dot_expr_init(dot_expr_t *expr);
+void dot_expr_reset(dot_expr_t *expr);
+void dot_expr_free(dot_expr_t *expr);
+size_t dot_expr_leaf(dot_expr_t *expr, const dot_limb_t *x);
+size_t dot_expr_add(dot_expr_t *expr, size_t left, size_t right);
+size_t dot_expr_sub(dot_expr_t *expr, size_t left, size_t right);
+// The carry flag of a dot_eval result only reports that the magnitude did not fit: the part above result->size
+// may be more than one 2^(64 size) and is lost, allocate a limb more than the longest operand to keep it
+void dot_eval(dot_limb_t *result, dot_expr_t *expr, size_t root);
+
+// Kernels generated at run time for one limb count, NULL when unavailable: use dot_add_n/dot_sub_n then
+typedef enum
+{
+    DOT_JIT_ADD = 0,
+    DOT_JIT_SUB,
+} dot_jit_op_t;
+
+typedef void (*dot_jit_func_t)(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
+
+dot_jit_func_t dot_jit_get(dot_jit_op_t op, size_t n);
+void dot_jit_clear(void);
+
 // Memory and utility functions
 dot_limb_t *dot_limb_t_alloc(size_t size);
+void dot_limb_init_buffer(dot_limb_t *dot_limb, uint64_t *limbs, size_t capacity);
+size_t dot_limb_normalize(dot_limb_t *dot_limb);
 void dot_limb_t_free(dot_limb_t *dot_limb);
 dot_limb_t *dot_limb_t_realloc(dot_limb_t *dot_limb, size_t new_size);
 char *dot_limb_get_str(const dot_limb_t *num);
 dot_limb_t *dot_limb_set_str(const char *str);
 void dot_limb_t_adjust_sizes(dot_limb_t *num1, dot_limb_t *num2);
 
+// Raw binary import/export, compatible with GMP's mpz_import/mpz_export
+dot_limb_t *dot_import(size_t count, int order, size_t size, int endian, const void *op);
+void *dot_export(void *rop, size_t *countp, int order, size_t size, int endian, const dot_limb_t *op);
+
+// Files of raw little-endian limbs mapped as numbers, release them with dot_mmap_close
+#define DOT_MMAP_WRITE 0x1
+#define DOT_MMAP_POPULATE 0x2
+
+dot_limb_t *dot_mmap_open(const char *path, int flags);
+dot_limb_t *dot_mmap_create(const char *path, size_t size, int flags);
+int dot_mmap_sync(dot_limb_t *num);
+void dot_mmap_close(dot_limb_t *num);
+
 // Initialize memory pool
+typedef enum
+{
+    DOT_POOL_MALLOC = 0, // aligned_alloc from the C library
+    DOT_POOL_MMAP,       // Anonymous mmap
+    DOT_POOL_HUGETLB,    // Explicit 2 MB huge pages (MAP_HUGETLB), falls back to DOT_POOL_THP
+    DOT_POOL_THP,        // Transparent huge pages requested with madvise(MADV_HUGEPAGE)
+} dot_pool_backing_t;
+
+typedef struct
+{
+    dot_pool_backing_t backing; // Where slabs come from
+    bool prefault;              // Touch every page of a slab when it is created, not inside the kernels
+    bool numa;                  // One pool per NUMA node, threads allocate node-local memory
+} dot_pool_options_t;
+
 void init_memory_pool(void);
+void init_memory_pool_ex(const dot_pool_options_t *options);
+void *memory_pool_alloc(size_t size);
+void memory_pool_free(void *ptr);
 void destroy_memory_pool(void);
 
+// Stack-style arenas: dot_arena_release frees everything allocated after a mark in O(1)
+typedef struct dot_arena_chunk dot_arena_chunk_t;
+typedef struct
+{
+    dot_arena_chunk_t *head;  // First chunk of the arena
+    dot_arena_chunk_t *chunk; // Chunk currently allocated from
+    size_t offset;            // Bump offset into the current chunk
+} dot_arena_t;
+
+typedef struct
+{
+    dot_arena_chunk_t *chunk;
+    size_t offset;
+} dot_arena_mark_t;
+
+void dot_arena_init(dot_arena_t *arena);
+void *dot_arena_alloc(dot_arena_t *arena, size_t size);
+dot_arena_mark_t dot_arena_mark(const dot_arena_t *arena);
+void dot_arena_release(dot_arena_t *arena, dot_arena_mark_t mark);
+void dot_arena_destroy(dot_arena_t *arena);
+dot_arena_t *dot_scratch_arena(void);
+dot_limb_t *dot_arena_limb_alloc(dot_arena_t *arena, size_t size);
+
+// Library contexts: each thread works in its own context unless told to use another one. A number lives only
+// as long as the context it was allocated in, and a thread's own context is destroyed when the thread exits:
+// numbers handed to other threads must come from a context made with dot_ctx_create, and be freed before
+// dot_ctx_destroy. memory_pool_free exits with a message on a block whose context was destroyed.
+typedef struct dot_ctx dot_ctx_t;
+
+dot_ctx_t *dot_ctx_create(const dot_pool_options_t *options);
+void dot_ctx_destroy(dot_ctx_t *ctx);
+dot_ctx_t *dot_ctx_get(void);
+void dot_ctx_set(dot_ctx_t *ctx);
+
+// Per-context statistics, collected when libdot is built with make STATS=1
+typedef enum
+{
+    DOT_STATS_ADD = 0,    // dot_add_n, dot_add_nc, dot_add_words and streamed additions
+    DOT_STATS_SUB,        // dot_sub_n, dot_sub_nc, dot_sub_words and streamed subtractions
+    DOT_STATS_ADD_APPROX, // dot_add_n_approx
+    DOT_STATS_SUB_APPROX, // dot_sub_n_approx
+    DOT_STATS_OPS,
+} dot_stats_op_t;
+
+typedef struct
+{
+    uint64_t calls[DOT_STATS_OPS];            // Kernel calls
+    uint64_t limbs[DOT_STATS_OPS];            // Limbs processed
+    uint64_t slow_path[DOT_STATS_OPS];        // Blocks needing the second carry/borrow pass, exact kernels
+    uint64_t uncertain_blocks[DOT_STATS_OPS]; // Blocks whose carry/borrow needed a ripple the approx kernels skip
+    uint64_t pool_bytes;                      // Bytes the memory pool currently holds from the system
+    uint64_t pool_high_water;                 // Highest pool_bytes since the last reset
+    uint64_t pool_resets;                     // destroy_memory_pool calls
+} dot_stats_t;
+
+void dot_stats_get(dot_stats_t *stats);
+void dot_stats_reset(void);
+
+// Header-only mode: define DOT_HEADER_ONLY before including dotlib.h and the exact kernels are inlined from
+// dotlib_inline.h instead of called in libdot. Taking their address still gives the library functions.
+#ifdef DOT_HEADER_ONLY
+#include "dotlib_inline.h"
+#define dot_add_n(result, a, b) __dot_add_n(result, a, b)
+#define dot_sub_n(result, a, b) __dot_sub_n(result, a, b)
+#define dot_add_nc(result, a, b, n, carry) __dot_add_nc(result, a, b, n, carry)
+#define dot_sub_nc(result, x, y, n, borrow) __dot_sub_nc(result, x, y, n, borrow)
+#define dot_add_words(result, a, b, n) __dot_add_words(result, a, b, n)
+#define dot_sub_words(result, a, b, n) __dot_sub_words(result, a, b, n)
+#endif
+
 #endif // DOTLIB_H
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef DOTLIB_GMP_H
+#define DOTLIB_GMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <gmp.h>
+#include "dotlib.h"
+
+/*
+    Zero-copy interop between libdot and GMP. Both libraries store magnitudes as little-endian arrays of
+    64-bit limbs, so a dot_limb_t can borrow the limbs of an mpz_t (or a raw mpn array) and an mpz_t can
+    borrow the limbs of a dot_limb_t. Everything here is header-only so libdot itself does not link GMP.
+
+    Views are caller-owned dot_limb_t structures built on dot_limb_init_buffer: never pass them to
+    dot_limb_t_free. If a view is grown past its limbs by dot_limb_t_adjust_sizes or dot_limb_t_realloc,
+    its limbs are copied into the memory pool and the view flag is cleared; the borrowed limbs are left
+    untouched.
+*/
+
+#if GMP_LIMB_BITS != 64 || GMP_NAIL_BITS != 0
+#error "libdot interop requires 64-bit GMP limbs without nails"
+#endif
+
+/**
+ * @brief Wraps the limbs of a raw mpn array as a dot_limb_t, without copying.
+ *
+ * @param view The dot_limb_t to initialise
+ * @param limbs The mpn limbs, least significant first
+ * @param n The number of limbs
+ * @return void
+ */
+static inline void dot_limb_view_mpn(dot_limb_t *view, mp_limb_t *limbs, size_t n)
+{
+    dot_limb_init_buffer(view, (uint64_t *)limbs, n);
+}
+
+/**
+ * @brief Wraps the limbs of an mpz_t as a read-only dot_limb_t operand, without copying.
+ *
+ * @param view The dot_limb_t to initialise
+ * @param z The GMP integer to borrow from, it must outlive the view and stay unmodified
+ * @return void
+ * @note A zero mpz_t gives a view of size 0
+ */
+static inline void dot_limb_view_mpz(dot_limb_t *view, mpz_srcptr z)
+{
+    dot_limb_view_mpn(view, (mp_limb_t *)mpz_limbs_read(z), mpz_size(z));
+    view->sign = mpz_sgn(z) < 0;
+}
+
+/**
+ * @brief Wraps the limbs of an mpz_t as an n-limb dot_limb_t result, without copying.
+ *
+ * One limb beyond n is reserved for the carry. The current value of z is preserved, so z may also be
+ * viewed as an operand of the same operation. The result is published with dot_limb_mpz_finish.
+ *
+ * @param view The dot_limb_t to initialise
+ * @param z The GMP integer receiving the result
+ * @param n The number of limbs of the result
+ * @return void
+ */
+static inline void dot_limb_view_mpz_result(dot_limb_t *view, mpz_ptr z, size_t n)
+{
+    dot_limb_init_buffer(view, (uint64_t *)mpz_limbs_modify(z, (mp_size_t)n + 1), n + 1);
+    view->size = n;
+    view->used = n;
+}
+
+/**
+ * @brief Publishes a result written through dot_limb_view_mpz_result into its mpz_t.
+ *
+ * @param z The GMP integer the view was created on
+ * @param view The view holding the result, its carry becomes the top limb and its sign the mpz sign
+ * @return void
+ */
+static inline void dot_limb_mpz_finish(mpz_ptr z, dot_limb_t *view)
+{
+    size_t n = view->carry ? view->size : view->used;
+    if (view->carry)
+    {
+        view->dot_limbs[n++] = 1;
+    }
+    mpz_limbs_finish(z, view->sign ? -(mp_size_t)n : (mp_size_t)n);
+}
+
+/**
+ * @brief Wraps the limbs of a dot_limb_t as a read-only mpz_t, without copying.
+ *
+ * @param z The mpz_t to initialise, it must not be cleared or modified through GMP
+ * @param num The number to borrow from, its carry flag is not part of the view
+ * @return mpz_srcptr z, usable as an input operand of any GMP function
+ */
+static inline mpz_srcptr dot_limb_mpz_view(mpz_ptr z, const dot_limb_t *num)
+{
+    mp_size_t n = (mp_size_t)num->used;
+    return mpz_roinit_n(z, (const mp_limb_t *)num->dot_limbs, num->sign ? -n : n);
+}
+
+#endif // DOTLIB_GMP_H
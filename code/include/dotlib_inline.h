@@ -0,0 +1,358 @@
+#ifndef DOTLIB_INLINE_H
+#define DOTLIB_INLINE_H
+#include <immintrin.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+    Exact add/sub kernels as static inline functions. libdot builds dot_add_n, dot_sub_n, dot_add_nc,
+    dot_sub_nc, dot_add_words and dot_sub_words from them, and a program that defines DOT_HEADER_ONLY before
+    including dotlib.h gets them inlined at its call sites instead of a call into libdot.so. With a limb
+    count known at compile time the chunk loop and the tail mask then fold away, which is most of the cost
+    of a 4 to 8 limb operation. The program must be compiled with -mavx512f -mavx512vl -mavx512bw.
+
+    dot_limb_t must be defined before this header is included (dotlib.h or dot_utils.h does it). Inlined
+    calls are not counted by dot_stats_get.
+*/
+
+#ifndef AVX512_ZEROS
+#define AVX512_ZEROS _mm512_setzero_si512() // 0 as chunk of 8 64-bit integers
+#endif
+#ifndef AVX512_MASK
+#define AVX512_MASK _mm512_set1_epi64(-1)   // All-ones as chunk of 8 64-bit integers
+#endif
+#ifndef unlikely
+#define unlikely(expr) __builtin_expect(!!(expr), 0) // unlikely branch
+#endif
+#ifndef DOT_STAT_ADD
+#define DOT_STAT_ADD(field, value) ((void)0)
+#endif
+
+/***************************************** Precise Variants *****************************************/
+
+#define __ADD_N_8(result, a, b, c_in, c_out)                                                         \
+    do                                                                                               \
+    {                                                                                                \
+        /* a_vec [511:0] := MEM [mem_addr + 511:mem_addr] */                                         \
+        __m512i a_vec = _mm512_loadu_si512((__m512i *)(a));                                          \
+        /* b_vec [511:0] := MEM [mem_addr + 511:mem_addr] */                                         \
+        __m512i b_vec = _mm512_loadu_si512((__m512i *)(b));                                          \
+        /* FOR j := 0 to 7 */                                                                        \
+        /*   i := j*64 */                                                                            \
+        /*   result_vec [i+63:i] := a_vec [i+63:i] + b_vec [i+63:i] */                               \
+        /* ENDFOR */                                                                                 \
+        __m512i result_vec = _mm512_add_epi64(a_vec, b_vec);                                         \
+        /* FOR j := 0 to 7 */                                                                        \
+        /*   i := j*64 */                                                                            \
+        /*   c_mask[j] := ( result_vec[i+63:i] < a_vec[i+63:i] ) ? 1 : 0 */                          \
+        /* ENDFOR */                                                                                 \
+        __mmask16 c_mask = _mm512_cmplt_epu64_mask(result_vec, a_vec);                               \
+        c_out = c_mask >> 7;                                                                         \
+        c_mask <<= 1;                                                                                \
+        /* c_mask[15:0] := c_mask[15:0] OR c_in[15:0] */                                             \
+        c_mask = _mm512_kor(c_mask, c_in);                                                           \
+        /* FOR j := 0 to 7 */                                                                        \
+        /*   i := j*64 */                                                                            \
+        /*   IF c_mask[j] */                                                                         \
+        /*     result_vec_new [i+63:i] := result_vec [i+63:i] - AVX512_MASK [i+63:i] */              \
+        /*   ELSE */                                                                                 \
+        /*     result_vec_new [i+63:i] := result_vec [i+63:i] */                                     \
+        /*   FI */                                                                                   \
+        /* ENDFOR */                                                                                 \
+        __m512i result_vec_new = _mm512_mask_sub_epi64(result_vec, c_mask, result_vec, AVX512_MASK); \
+        /* FOR j := 0 to 7 */                                                                        \
+        /*   i := j*64 */                                                                            \
+        /*   c_mask[j] := ( result_vec_new[i+63:i] < result_vec[i+63:i] ) ? 1 : 0 */                 \
+        /* ENDFOR */                                                                                 \
+        c_mask = _mm512_cmplt_epu64_mask(result_vec_new, result_vec);                                \
+        result_vec = result_vec_new;                                                                 \
+        /* MEM[mem_addr+511:mem_addr] := result_vec[511:0] */                                        \
+        _mm512_storeu_si512((__m512i *)(result), result_vec);                                        \
+        /* IF c_mask[15:0] != 0 */                                                                   \
+        if (unlikely(_mm512_mask2int(c_mask)))                                                       \
+        {                                                                                            \
+            DOT_STAT_ADD(slow_path[DOT_STATS_ADD], 1);                                               \
+            c_mask <<= 1;                                                                            \
+            /* FOR j := 0 to 7 */                                                                    \
+            /*   i := j*64 */                                                                        \
+            /* m[j] := ( result_vec[i+63:i] == AVX512_MASK[i+63:i] ) ? 1 : 0*/                       \
+            /* ENDFOR */                                                                             \
+            __mmask16 m = _mm512_cmpeq_epi64_mask(result_vec, AVX512_MASK);                          \
+            c_mask = c_mask + m;                                                                     \
+            /* c_out[15:0] := c_out[15:0] OR (c_mask >> 8)[15:0] */                                  \
+            c_out = _mm512_kor(c_out, (c_mask >> 8));                                                \
+            /* m[15:0] := c_mask[15:0] OR m[15:0] */                                                 \
+            m = _mm512_kxor(c_mask, m);                                                              \
+            /* FOR j := 0 to 7 */                                                                    \
+            /* i := j*64 */                                                                          \
+            /* IF k[j] */                                                                            \
+            /*	dst[i+63:i] := a[i+63:i] - b[i+63:i] */                                               \
+            /* ELSE */                                                                               \
+            /*  dst[i+63:i] := src[i+63:i] */                                                        \
+            /* FI	 */                                                                                \
+            /* ENDFOR   */                                                                           \
+            result_vec = _mm512_mask_sub_epi64(result_vec, m, result_vec, AVX512_MASK);              \
+            /* MEM[mem_addr+511:mem_addr] := result_vec[511:0] */                                    \
+            _mm512_storeu_si512((__m512i *)(result), result_vec);                                    \
+        }                                                                                            \
+    } while (0)
+
+#define __ADD_N_K(result, a, b, c_in, c_out, k, remaining)                                           \
+    do                                                                                               \
+    {                                                                                                \
+        __m512i a_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(a));                    \
+        __m512i b_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(b));                    \
+        __m512i result_vec = _mm512_add_epi64(a_vec, b_vec);                                         \
+        __mmask16 c_mask = _mm512_cmplt_epu64_mask(result_vec, a_vec);                               \
+        c_out = c_mask >> remaining;                                                                 \
+        c_mask <<= 1;                                                                                \
+        c_mask = _mm512_kor(c_mask, c_in);                                                           \
+        __m512i result_vec_new = _mm512_mask_sub_epi64(result_vec, c_mask, result_vec, AVX512_MASK); \
+        c_mask = _mm512_cmplt_epu64_mask(result_vec_new, result_vec);                                \
+        result_vec = result_vec_new;                                                                 \
+        _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                                \
+        if (unlikely(_mm512_mask2int(c_mask)))                                                       \
+        {                                                                                            \
+            DOT_STAT_ADD(slow_path[DOT_STATS_ADD], 1);                                               \
+            c_mask <<= 1;                                                                            \
+            __mmask16 m = _mm512_cmpeq_epi64_mask(result_vec, AVX512_MASK);                          \
+            c_mask = c_mask + m;                                                                     \
+            c_out = _mm512_kor(c_out, (c_mask >> (remaining + 1)));                                  \
+            m = _mm512_kxor(c_mask, m);                                                              \
+            result_vec = _mm512_mask_sub_epi64(result_vec, m, result_vec, AVX512_MASK);              \
+            _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                            \
+        }                                                                                            \
+    } while (0)
+
+
+#define __SUB_N_8(result, a, b, b_in, b_out)                                                         \
+    do                                                                                               \
+    {                                                                                                \
+        __m512i a_vec = _mm512_loadu_si512((__m512i *)(a));                                          \
+        __m512i b_vec = _mm512_loadu_si512((__m512i *)(b));                                          \
+        __m512i result_vec = _mm512_sub_epi64(a_vec, b_vec);                                         \
+        __mmask16 b_mask = _mm512_cmpgt_epu64_mask(b_vec, a_vec);                                    \
+        b_out = b_mask >> 7;                                                                         \
+        b_mask <<= 1;                                                                                \
+        b_mask = _mm512_kor(b_mask, b_in);                                                           \
+        __m512i result_vec_new = _mm512_mask_add_epi64(result_vec, b_mask, result_vec, AVX512_MASK); \
+        b_mask = _mm512_cmpgt_epu64_mask(result_vec_new, result_vec);                                \
+        result_vec = result_vec_new;                                                                 \
+        _mm512_storeu_si512((__m512i *)(result), result_vec);                                        \
+        if (unlikely(_mm512_mask2int(b_mask)))                                                       \
+        {                                                                                            \
+            DOT_STAT_ADD(slow_path[DOT_STATS_SUB], 1);                                               \
+            b_mask <<= 1;                                                                            \
+            __mmask16 m = _mm512_cmpeq_epu64_mask(result_vec, AVX512_ZEROS);                         \
+            b_mask = b_mask + m;                                                                     \
+            b_out = _mm512_kor(b_out, (b_mask >> 8));                                                \
+            m = _mm512_kxor(b_mask, m);                                                              \
+            result_vec = _mm512_mask_add_epi64(result_vec, m, result_vec, AVX512_MASK);              \
+            _mm512_storeu_si512((__m512i *)(result), result_vec);                                    \
+        }                                                                                            \
+    } while (0)
+
+#define __SUB_N_K(result, a, b, b_in, b_out, k, remaining)                                           \
+    do                                                                                               \
+    {                                                                                                \
+        __m512i a_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(a));                    \
+        __m512i b_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(b));                    \
+        __m512i result_vec = _mm512_sub_epi64(a_vec, b_vec);                                         \
+        __mmask16 b_mask = _mm512_cmpgt_epu64_mask(b_vec, a_vec);                                    \
+        b_out = b_mask >> remaining;                                                                 \
+        b_mask <<= 1;                                                                                \
+        b_mask = _mm512_kor(b_mask, b_in);                                                           \
+        __m512i result_vec_new = _mm512_mask_add_epi64(result_vec, b_mask, result_vec, AVX512_MASK); \
+        b_mask = _mm512_cmpgt_epu64_mask(result_vec_new, result_vec);                                \
+        result_vec = result_vec_new;                                                                 \
+        _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                                \
+        if (unlikely(_mm512_mask2int(b_mask)))                                                       \
+        {                                                                                            \
+            DOT_STAT_ADD(slow_path[DOT_STATS_SUB], 1);                                               \
+            b_mask <<= 1;                                                                            \
+            /* Only lanes inside k may pass a borrow on, the zero lanes above them are not limbs */  \
+            __mmask16 m = _mm512_mask_cmpeq_epu64_mask(k, result_vec, AVX512_ZEROS);                 \
+            b_mask = b_mask + m;                                                                     \
+            b_out = _mm512_kor(b_out, (b_mask >> (remaining + 1)));                                  \
+            m = _mm512_kxor(b_mask, m);                                                              \
+            result_vec = _mm512_mask_add_epi64(result_vec, m, result_vec, AVX512_MASK);              \
+            _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                            \
+        }                                                                                            \
+    } while (0)
+
+/***************************************** Normalised Sizes *****************************************/
+
+// Function to get the number of limbs an operation has to process, the limbs above both used counts are zero
+static inline size_t __used_max(const dot_limb_t *a, const dot_limb_t *b)
+{
+    return a->used > b->used ? a->used : b->used;
+}
+
+// Function to drop the high zero limbs of the n limbs at limbs
+static inline size_t __normalize(const uint64_t *limbs, size_t n)
+{
+    while (n > 0 && limbs[n - 1] == 0)
+    {
+        n--;
+    }
+    return n;
+}
+
+// Function to set the used count of a result, zeroing the limbs its previous value still held above it
+static inline void __set_used(dot_limb_t *result, size_t used)
+{
+    if (result->used > used)
+    {
+        memset(result->dot_limbs + used, 0, (result->used - used) * sizeof(uint64_t));
+    }
+    result->used = used;
+}
+
+// Function to finish a sum written to the low n limbs of result, the carry becomes a limb while there is room
+static inline void __finish_sum(dot_limb_t *result, size_t n, __mmask16 carry)
+{
+    size_t size = result->size;
+    if (n > size)
+    {
+        n = size;
+    }
+    if (carry && n < size)
+    {
+        result->dot_limbs[n++] = 1;
+        carry = 0;
+    }
+    result->carry = carry;
+    // With the carry flag set the number spans every limb below it
+    __set_used(result, carry ? size : __normalize(result->dot_limbs, n));
+}
+
+/***************************************** Kernels *****************************************/
+
+static inline uint64_t __dot_add_nc(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry)
+{
+    // The carry in enters as the carry into lane 0 of the first chunk
+    __mmask16 c_in = (__mmask16)(carry & 1), c_out = c_in;
+    DOT_STAT_ADD(calls[DOT_STATS_ADD], 1);
+    DOT_STAT_ADD(limbs[DOT_STATS_ADD], n);
+
+    // Process limbs in chunks of 8
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __ADD_N_8((result + i), (a + i), (b + i), c_in, c_out);
+        c_in = c_out;
+    }
+
+    // Handle remaining limbs (if any)
+    if (unlikely(i < n))
+    {
+        // Create a mask for the remaining limbs
+        __mmask16 remaining = n - i;
+        __mmask16 k = (1ULL << remaining) - 1; // Mask with 'remaining' number of 1s
+        remaining--;
+
+        // Process remaining limbs using __ADD_N_K
+        __ADD_N_K((result + i), (a + i), (b + i), c_in, c_out, k, remaining);
+    }
+    return (uint64_t)!!c_out; // Return carry out
+}
+
+static inline void __dot_add_n(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    // Limbs above both used counts are zero, only the significant ones need adding
+    const size_t n = __used_max(a, b);
+    uint64_t c_out = __dot_add_nc(result->dot_limbs, a->dot_limbs, b->dot_limbs, n, 0);
+    __finish_sum(result, n, (__mmask16)c_out);
+}
+
+static inline unsigned long __dot_add_words(uint64_t *result, const uint64_t *a, const uint64_t *b, int n)
+{
+    assert(n >= 0);
+    if (n <= 0)
+        return (unsigned long)0; // No limbs to add
+    return (unsigned long)__dot_add_nc(result, a, b, (size_t)n, 0); // Return carry out
+}
+
+static inline uint64_t __dot_sub_nc(uint64_t *result, const uint64_t *x, const uint64_t *y, size_t n, uint64_t borrow)
+{
+    // The borrow in enters as the borrow into lane 0 of the first chunk
+    __mmask16 b_in = (__mmask16)(borrow & 1), b_out = b_in;
+    DOT_STAT_ADD(calls[DOT_STATS_SUB], 1);
+    DOT_STAT_ADD(limbs[DOT_STATS_SUB], n);
+
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __SUB_N_8((result + i), (x + i), (y + i), b_in, b_out);
+        b_in = b_out;
+    }
+
+    // Handle remaining limbs (if any)
+    if (unlikely(i < n))
+    {
+        // Create a mask for the remaining limbs
+        __mmask16 remaining = n - i;
+        __mmask16 k = (1ULL << remaining) - 1; // Mask with 'remaining' number of 1s
+        // Process remaining limbs using __SUB_N_K
+        remaining--;
+        __SUB_N_K((result + i), (x + i), (y + i), b_in, b_out, k, remaining);
+    }
+    return (uint64_t)!!b_out; // Return the borrow out
+}
+
+static inline void __dot_sub_n(dot_limb_t *result, dot_limb_t *x, dot_limb_t *y)
+{
+    // Compare from the highest used limb, the limbs above it are zero in both operands
+    size_t n = __used_max(x, y);
+    // swap x and y if x < y
+    int cmp = 0;
+    size_t i;
+    for (i = n; i-- > 0;)
+    {
+        if (x->dot_limbs[i] > y->dot_limbs[i])
+        {
+            cmp = 1;
+            break;
+        }
+        else if (x->dot_limbs[i] < y->dot_limbs[i])
+        {
+            cmp = -1;
+            break;
+        }
+    }
+    if (cmp == -1)
+    {
+        dot_limb_t *temp = x;
+        x = y;
+        y = temp;
+        result->sign = 1;
+    }
+    else if (cmp == 0)
+    {
+        result->sign = 0;
+        __set_used(result, 0);
+        return;
+    }
+    else
+    {
+        result->sign = 0;
+    }
+
+    // The limbs above the highest difference are equal and cancel out
+    n = i + 1;
+
+    __dot_sub_nc(result->dot_limbs, x->dot_limbs, y->dot_limbs, n, 0);
+    __set_used(result, __normalize(result->dot_limbs, n));
+}
+
+/* unsigned subtraction of b from a, a must be larger than b. */
+static inline unsigned long __dot_sub_words(uint64_t *result, const uint64_t *x, const uint64_t *y, int n)
+{
+    assert(n >= 0);
+    if (n <= 0)
+        return (unsigned long)0; // No limbs to subtract
+    return (unsigned long)__dot_sub_nc(result, x, y, (size_t)n, 0); // Return the borrow
+}
+
+#endif // DOTLIB_INLINE_H
@@ -3,155 +3,9 @@
 #include <immintrin.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "dot_utils.h"
-
-/***************************************** Precise Variants *****************************************/
-
-
-#define __ADD_N_8(result, a, b, c_in, c_out)                                                         \
-    do                                                                                               \
-    {                                                                                                \
-        /* a_vec [511:0] := MEM [mem_addr + 511:mem_addr] */                                         \
-        __m512i a_vec = _mm512_loadu_si512((__m512i *)(a));                                          \
-        /* b_vec [511:0] := MEM [mem_addr + 511:mem_addr] */                                         \
-        __m512i b_vec = _mm512_loadu_si512((__m512i *)(b));                                          \
-        /* FOR j := 0 to 7 */                                                                        \
-        /*   i := j*64 */                                                                            \
-        /*   result_vec [i+63:i] := a_vec [i+63:i] + b_vec [i+63:i] */                               \
-        /* ENDFOR */                                                                                 \
-        __m512i result_vec = _mm512_add_epi64(a_vec, b_vec);                                         \
-        /* FOR j := 0 to 7 */                                                                        \
-        /*   i := j*64 */                                                                            \
-        /*   c_mask[j] := ( result_vec[i+63:i] < a_vec[i+63:i] ) ? 1 : 0 */                          \
-        /* ENDFOR */                                                                                 \
-        __mmask16 c_mask = _mm512_cmplt_epu64_mask(result_vec, a_vec);                               \
-        c_out = c_mask >> 7;                                                                         \
-        c_mask <<= 1;                                                                                \
-        /* c_mask[15:0] := c_mask[15:0] OR c_in[15:0] */                                             \
-        c_mask = _mm512_kor(c_mask, c_in);                                                           \
-        /* FOR j := 0 to 7 */                                                                        \
-        /*   i := j*64 */                                                                            \
-        /*   IF c_mask[j] */                                                                         \
-        /*     result_vec_new [i+63:i] := result_vec [i+63:i] - AVX512_MASK [i+63:i] */              \
-        /*   ELSE */                                                                                 \
-        /*     result_vec_new [i+63:i] := result_vec [i+63:i] */                                     \
-        /*   FI */                                                                                   \
-        /* ENDFOR */                                                                                 \
-        __m512i result_vec_new = _mm512_mask_sub_epi64(result_vec, c_mask, result_vec, AVX512_MASK); \
-        /* FOR j := 0 to 7 */                                                                        \
-        /*   i := j*64 */                                                                            \
-        /*   c_mask[j] := ( result_vec_new[i+63:i] < result_vec[i+63:i] ) ? 1 : 0 */                 \
-        /* ENDFOR */                                                                                 \
-        c_mask = _mm512_cmplt_epu64_mask(result_vec_new, result_vec);                                \
-        result_vec = result_vec_new;                                                                 \
-        /* MEM[mem_addr+511:mem_addr] := result_vec[511:0] */                                        \
-        _mm512_storeu_si512((__m512i *)(result), result_vec);                                        \
-        /* IF c_mask[15:0] != 0 */                                                                   \
-        if (unlikely(_mm512_mask2int(c_mask)))                                                       \
-        {                                                                                            \
-            c_mask <<= 1;                                                                            \
-            /* FOR j := 0 to 7 */                                                                    \
-            /*   i := j*64 */                                                                        \
-            /* m[j] := ( result_vec[i+63:i] == AVX512_MASK[i+63:i] ) ? 1 : 0*/                       \
-            /* ENDFOR */                                                                             \
-            __mmask16 m = _mm512_cmpeq_epi64_mask(result_vec, AVX512_MASK);                          \
-            c_mask = c_mask + m;                                                                     \
-            /* c_out[15:0] := c_out[15:0] OR (c_mask >> 8)[15:0] */                                  \
-            c_out = _mm512_kor(c_out, (c_mask >> 8));                                                \
-            /* m[15:0] := c_mask[15:0] OR m[15:0] */                                                 \
-            m = _mm512_kxor(c_mask, m);                                                              \
-            /* FOR j := 0 to 7 */                                                                    \
-            /* i := j*64 */                                                                          \
-            /* IF k[j] */                                                                            \
-            /*	dst[i+63:i] := a[i+63:i] - b[i+63:i] */                                               \
-            /* ELSE */                                                                               \
-            /*  dst[i+63:i] := src[i+63:i] */                                                        \
-            /* FI	 */                                                                                \
-            /* ENDFOR   */                                                                           \
-            result_vec = _mm512_mask_sub_epi64(result_vec, m, result_vec, AVX512_MASK);              \
-            /* MEM[mem_addr+511:mem_addr] := result_vec[511:0] */                                    \
-            _mm512_storeu_si512((__m512i *)(result), result_vec);                                    \
-        }                                                                                            \
-    } while (0)
-
-#define __ADD_N_K(result, a, b, c_in, c_out, k, remaining)                                           \
-    do                                                                                               \
-    {                                                                                                \
-        __m512i a_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(a));                    \
-        __m512i b_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(b));                    \
-        __m512i result_vec = _mm512_add_epi64(a_vec, b_vec);                                         \
-        __mmask16 c_mask = _mm512_cmplt_epu64_mask(result_vec, a_vec);                               \
-        c_out = c_mask >> remaining;                                                                 \
-        c_mask <<= 1;                                                                                \
-        c_mask = _mm512_kor(c_mask, c_in);                                                           \
-        __m512i result_vec_new = _mm512_mask_sub_epi64(result_vec, c_mask, result_vec, AVX512_MASK); \
-        c_mask = _mm512_cmplt_epu64_mask(result_vec_new, result_vec);                                \
-        result_vec = result_vec_new;                                                                 \
-        _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                                \
-        if (unlikely(_mm512_mask2int(c_mask)))                                                       \
-        {                                                                                            \
-            c_mask <<= 1;                                                                            \
-            __mmask16 m = _mm512_cmpeq_epi64_mask(result_vec, AVX512_MASK);                          \
-            c_mask = c_mask + m;                                                                     \
-            c_out = _mm512_kor(c_out, (c_mask >> (remaining + 1)));                                  \
-            m = _mm512_kxor(c_mask, m);                                                              \
-            result_vec = _mm512_mask_sub_epi64(result_vec, m, result_vec, AVX512_MASK);              \
-            _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                            \
-        }                                                                                            \
-    } while (0)
-
-
-#define __SUB_N_8(result, a, b, b_in, b_out)                                                         \
-    do                                                                                               \
-    {                                                                                                \
-        __m512i a_vec = _mm512_loadu_si512((__m512i *)(a));                                          \
-        __m512i b_vec = _mm512_loadu_si512((__m512i *)(b));                                          \
-        __m512i result_vec = _mm512_sub_epi64(a_vec, b_vec);                                         \
-        __mmask16 b_mask = _mm512_cmpgt_epu64_mask(b_vec, a_vec);                                    \
-        b_out = b_mask >> 7;                                                                         \
-        b_mask <<= 1;                                                                                \
-        b_mask = _mm512_kor(b_mask, b_in);                                                           \
-        __m512i result_vec_new = _mm512_mask_add_epi64(result_vec, b_mask, result_vec, AVX512_MASK); \
-        b_mask = _mm512_cmpgt_epu64_mask(result_vec_new, result_vec);                                \
-        result_vec = result_vec_new;                                                                 \
-        _mm512_storeu_si512((__m512i *)(result), result_vec);                                        \
-        if (unlikely(_mm512_mask2int(b_mask)))                                                       \
-        {                                                                                            \
-            b_mask <<= 1;                                                                            \
-            __mmask16 m = _mm512_cmpeq_epu64_mask(result_vec, AVX512_ZEROS);                         \
-            b_mask = b_mask + m;                                                                     \
-            b_out = _mm512_kor(b_out, (b_mask >> 8));                                                \
-            m = _mm512_kxor(b_mask, m);                                                              \
-            result_vec = _mm512_mask_add_epi64(result_vec, m, result_vec, AVX512_MASK);              \
-            _mm512_storeu_si512((__m512i *)(result), result_vec);                                    \
-        }                                                                                            \
-    } while (0)
-
-#define __SUB_N_K(result, a, b, b_in, b_out, k, remaining)                                           \
-    do                                                                                               \
-    {                                                                                                \
-        __m512i a_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(a));                    \
-        __m512i b_vec = _mm512_mask_loadu_epi64(AVX512_ZEROS, k, (__m512i *)(b));                    \
-        __m512i result_vec = _mm512_sub_epi64(a_vec, b_vec);                                         \
-        __mmask16 b_mask = _mm512_cmpgt_epu64_mask(b_vec, a_vec);                                    \
-        b_out = b_mask >> remaining;                                                                 \
-        b_mask <<= 1;                                                                                \
-        b_mask = _mm512_kor(b_mask, b_in);                                                           \
-        __m512i result_vec_new = _mm512_mask_add_epi64(result_vec, b_mask, result_vec, AVX512_MASK); \
-        b_mask = _mm512_cmpgt_epu64_mask(result_vec_new, result_vec);                                \
-        result_vec = result_vec_new;                                                                 \
-        _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                                \
-        if (unlikely(_mm512_mask2int(b_mask)))                                                       \
-        {                                                                                            \
-            b_mask <<= 1;                                                                            \
-            __mmask16 m = _mm512_cmpeq_epu64_mask(result_vec, AVX512_ZEROS);                         \
-            b_mask = b_mask + m;                                                                     \
-            b_out = _mm512_kor(b_out, (b_mask >> (remaining + 1)));                                  \
-            m = _mm512_kxor(b_mask, m);                                                              \
-            result_vec = _mm512_mask_add_epi64(result_vec, m, result_vec, AVX512_MASK);              \
-            _mm512_mask_storeu_epi64((__m512i *)(result), k, result_vec);                            \
-        }                                                                                            \
-    } while (0)
+#include "dotlib_inline.h"
 
 /***************************************** Approximate Variants *****************************************/
 
@@ -164,6 +18,8 @@
         __mmask16 c_mask = _mm256_cmplt_epu64_mask(result_vec, a_vec);                   \
         c_out = c_mask >> 3;                                                             \
         c_mask <<= 1;                                                                    \
+        DOT_STAT_IF(uncertain_blocks[DOT_STATS_ADD_APPROX],                              \
+                    _mm256_mask_cmpeq_epi64_mask(c_mask, result_vec, AVX256_MASK));      \
         result_vec = _mm256_mask_sub_epi64(result_vec, c_mask, result_vec, AVX256_MASK); \
         _mm256_storeu_si256((__m256i *)(result), result_vec);                            \
     } while (0)
@@ -178,6 +34,8 @@
         c_out = c_mask >> 7;                                                             \
         c_mask <<= 1;                                                                    \
         c_mask = _mm512_kor(c_mask, c_in);                                               \
+        DOT_STAT_IF(uncertain_blocks[DOT_STATS_ADD_APPROX],                              \
+                    _mm512_mask_cmpeq_epi64_mask(c_mask, result_vec, AVX512_MASK));      \
         result_vec = _mm512_mask_sub_epi64(result_vec, c_mask, result_vec, AVX512_MASK); \
         _mm512_storeu_si512((__m512i *)(result), result_vec);                            \
     } while (0)
@@ -190,6 +48,8 @@
         __m256i result_vec = _mm256_sub_epi64(a_vec, b_vec);                             \
         __mmask16 b_mask = _mm256_cmpgt_epu64_mask(b_vec, a_vec);                        \
         b_mask <<= 1;                                                                    \
+        DOT_STAT_IF(uncertain_blocks[DOT_STATS_SUB_APPROX],                              \
+                    _mm256_mask_cmpeq_epi64_mask(b_mask, result_vec, AVX256_ZEROS));     \
         result_vec = _mm256_mask_add_epi64(result_vec, b_mask, result_vec, AVX256_MASK); \
         _mm256_storeu_epi64((__m256i *)(result), result_vec);                            \
     } while (0)
@@ -204,6 +64,8 @@
         b_out = b_mask >> 7;                                                             \
         b_mask <<= 1;                                                                    \
         b_mask = _mm512_kor(b_mask, b_in);                                               \
+        DOT_STAT_IF(uncertain_blocks[DOT_STATS_SUB_APPROX],                              \
+                    _mm512_mask_cmpeq_epi64_mask(b_mask, result_vec, AVX512_ZEROS));     \
         result_vec = _mm512_mask_add_epi64(result_vec, b_mask, result_vec, AVX512_MASK); \
         _mm512_storeu_si512((__m512i *)(result), result_vec);                            \
     } while (0)
@@ -215,6 +77,279 @@ void dot_add_n_approx(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
 void dot_sub_n(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
 void dot_sub_n_approx(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
 
+// int limb counts, kept for existing callers: past 2^31 limbs use dot_add_nc/dot_sub_nc
 unsigned long dot_add_words(uint64_t *result, const uint64_t *a, const uint64_t *b, int n);
 unsigned long dot_sub_words(uint64_t *result, const uint64_t *a, const uint64_t *b, int n);
+
+/**
+ * @brief Adds two n-limb arrays with a carry in, result = a + b + carry
+ *
+ * @param result The n-limb result, it may alias a or b
+ * @param a The first operand
+ * @param b The second operand
+ * @param n The number of limbs, without the 2^31 limit of dot_add_words
+ * @param carry The carry into the lowest limb, 0 or 1
+ * @return uint64_t The carry out of the highest limb, 0 or 1
+ */
+uint64_t dot_add_nc(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry);
+
+/**
+ * @brief Subtracts two n-limb arrays with a borrow in, result = x - y - borrow modulo 2^(64n)
+ *
+ * @param result The n-limb result, it may alias x or y
+ * @param x The minuend
+ * @param y The subtrahend
+ * @param n The number of limbs
+ * @param borrow The borrow into the lowest limb, 0 or 1
+ * @return uint64_t The borrow out of the highest limb, 1 when x < y + borrow
+ */
+uint64_t dot_sub_nc(uint64_t *result, const uint64_t *x, const uint64_t *y, size_t n, uint64_t borrow);
+
+/***************************************** Modular Arithmetic *****************************************/
+
+/**
+ * @brief Adds two residues modulo m, result = (a + b) mod m
+ *
+ * One pass over the operands. Up to 8 limbs a + b and a + b - m are both computed and blended by the final
+ * carry and borrow; longer operands compute only the one their top limbs select, when they can tell.
+ *
+ * @param result The n-limb result, it may alias a or b but not m
+ * @param a The first operand, below m
+ * @param b The second operand, below m
+ * @param m The modulus
+ * @param n The number of limbs of all four arrays
+ * @return void
+ */
+void dot_addmod(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n);
+
+/**
+ * @brief Subtracts two residues modulo m, result = (a - b) mod m
+ *
+ * @param result The n-limb result, it may alias a or b but not m
+ * @param a The minuend, below m
+ * @param b The subtrahend, below m
+ * @param m The modulus
+ * @param n The number of limbs of all four arrays
+ * @return void
+ */
+void dot_submod(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n);
+
+/**
+ * @brief Adds two residues modulo the pseudo-Mersenne prime p = 2^k - c, result = (a + b) mod p
+ *
+ * No modulus array is read, the reduction adds c to the lowest limbs and is fastest for small c.
+ *
+ * @param result The n-limb result, it may alias a or b
+ * @param a The first operand, below p
+ * @param b The second operand, below p
+ * @param n The number of limbs, 64(n - 1) < k <= 64n
+ * @param k The bit length of p
+ * @param c The distance of p below 2^k, c < 2^k
+ * @return void
+ */
+void dot_addmod_pm(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, unsigned k, uint64_t c);
+
+/**
+ * @brief Subtracts two residues modulo the pseudo-Mersenne prime p = 2^k - c, result = (a - b) mod p
+ *
+ * @param result The n-limb result, it may alias a or b
+ * @param a The minuend, below p
+ * @param b The subtrahend, below p
+ * @param n The number of limbs, 64(n - 1) < k <= 64n
+ * @param k The bit length of p
+ * @param c The distance of p below 2^k, c < 2^k
+ * @return void
+ */
+void dot_submod_pm(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, unsigned k, uint64_t c);
+
+/***************************************** Constant-Time Variants *****************************************/
+
+/**
+ * @brief Adds two n-limb arrays with a carry in in constant time, result = a + b + carry
+ *
+ * Same result as dot_add_nc, but with no branch or memory access that depends on the limbs: the time
+ * depends only on n. For operands that are secret.
+ *
+ * @param result The n-limb result, it may alias a or b
+ * @param a The first operand
+ * @param b The second operand
+ * @param n The number of limbs
+ * @param carry The carry in, 0 or 1
+ * @return The carry out, 0 or 1
+ */
+uint64_t dot_add_nc_ct(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry);
+
+/**
+ * @brief Subtracts two n-limb arrays with a borrow in in constant time, result = x - y - borrow modulo 2^(64n)
+ *
+ * @param result The n-limb result, it may alias x or y
+ * @param x The minuend
+ * @param y The subtrahend
+ * @param n The number of limbs
+ * @param borrow The borrow in, 0 or 1
+ * @return The borrow out, 0 or 1
+ */
+uint64_t dot_sub_nc_ct(uint64_t *result, const uint64_t *x, const uint64_t *y, size_t n, uint64_t borrow);
+
+/**
+ * @brief Adds two dot_limb_t in constant time, result = a + b
+ *
+ * Works on all a->size limbs rather than the used ones, so the operands must have the same size, as after
+ * dot_limb_t_adjust_sizes. The result is the same as with dot_add_n.
+ *
+ * @param result The result, at least a->size limbs allocated
+ * @param a The first operand
+ * @param b The second operand, of the same size as a
+ * @return void
+ */
+void dot_add_n_ct(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
+
+/**
+ * @brief Subtracts two dot_limb_t in constant time, result = |x - y| with the sign of x - y
+ *
+ * The larger operand is chosen from the borrow of a first pass and swapped in with masked blends rather than
+ * by comparing limbs. The operands must have the same size, as for dot_add_n_ct.
+ *
+ * @param result The result, at least x->size limbs allocated
+ * @param x The minuend
+ * @param y The subtrahend, of the same size as x
+ * @return void
+ */
+void dot_sub_n_ct(dot_limb_t *result, dot_limb_t *x, dot_limb_t *y);
+
+/***************************************** Streaming *****************************************/
+
+/**
+ * @brief Starts a streaming addition or subtraction
+ *
+ * The operands are fed in chunks from the least significant limb up, each chunk only needs to be in memory
+ * during its dot_stream_update call. A streamed subtraction cannot swap its operands up front like
+ * dot_sub_n, so when x < y the limbs hold x - y + 2^(64N) and dot_stream_finish returns a borrow.
+ *
+ * @param stream The stream to initialise
+ * @param op DOT_STREAM_ADD or DOT_STREAM_SUB
+ * @return void
+ */
+void dot_stream_init(dot_stream_t *stream, dot_stream_op_t op);
+
+/**
+ * @brief Processes the next chunk of both operands
+ *
+ * @param stream The stream
+ * @param result The n limbs of the result for this chunk, it may alias a or b
+ * @param a The next n limbs of the first operand
+ * @param b The next n limbs of the second operand
+ * @param n The number of limbs in the chunk, any size including 0
+ * @return void
+ */
+void dot_stream_update(dot_stream_t *stream, uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n);
+
+/**
+ * @brief Ends a stream
+ *
+ * @param stream The stream
+ * @return uint64_t The carry (add) or borrow (sub) out of the highest limb, 0 or 1
+ */
+uint64_t dot_stream_finish(dot_stream_t *stream);
+
+/***************************************** Expression Fusion *****************************************/
+
+/**
+ * @brief Starts an empty expression
+ *
+ * @param expr The expression to initialise
+ * @return void
+ */
+void dot_expr_init(dot_expr_t *expr);
+
+/**
+ * @brief Drops every node of an expression but keeps its memory, to build the next one
+ *
+ * @param expr The expression
+ * @return void
+ */
+void dot_expr_reset(dot_expr_t *expr);
+
+/**
+ * @brief Frees the nodes of an expression, which is left empty
+ *
+ * @param expr The expression
+ * @return void
+ */
+void dot_expr_free(dot_expr_t *expr);
+
+/**
+ * @brief Adds an operand to an expression
+ *
+ * Only the pointer is kept: the operand is read by dot_eval, with the value it has then.
+ *
+ * @param expr The expression
+ * @param x The operand, a magnitude, its sign is ignored
+ * @return size_t The id of the new node
+ */
+size_t dot_expr_leaf(dot_expr_t *expr, const dot_limb_t *x);
+
+/**
+ * @brief Adds the sum of two nodes to an expression
+ *
+ * A node may be used by any number of later nodes, so shared subexpressions are built once.
+ *
+ * @param expr The expression
+ * @param left The id of the first node
+ * @param right The id of the second node
+ * @return size_t The id of the new node
+ */
+size_t dot_expr_add(dot_expr_t *expr, size_t left, size_t right);
+
+/**
+ * @brief Adds the difference of two nodes to an expression, left - right
+ *
+ * @param expr The expression
+ * @param left The id of the minuend
+ * @param right The id of the subtrahend
+ * @return size_t The id of the new node
+ */
+size_t dot_expr_sub(dot_expr_t *expr, size_t left, size_t right);
+
+/**
+ * @brief Evaluates a node of an expression in one pass, result = |root| with the sign of root
+ *
+ * The node is folded into one signed coefficient per distinct operand, then every 8-limb block of every
+ * operand is read once and the carries of all terms are resolved together, with no temporaries. An operand
+ * with coefficient c costs one addition per set bit of |c| in each block, so repeated doublings stay cheap; the
+ * process exits with a message when the |c| add up to more than 2^61. As with dot_add_n
+ * the number of limbs is the largest used count, and one limb more always holds the magnitude. When the
+ * result has no room for it the low limbs are kept and the carry flag is set, but unlike dot_add_n the lost
+ * part may be more than one 2^(64 size): the flag only reports the overflow.
+ *
+ * @param result The result, it may alias an operand, at least as many limbs allocated as the longest one
+ * @param expr The expression
+ * @param root The id of the node to evaluate
+ * @return void
+ */
+void dot_eval(dot_limb_t *result, dot_expr_t *expr, size_t root);
+
+/***************************************** Generated Kernels *****************************************/
+
+/**
+ * @brief Returns a kernel generated for one operation on exactly n limbs
+ *
+ * The kernel is straight-line AVX-512 code with the limb count built in, called like dot_add_n. It reads and
+ * writes n limbs whatever the used counts, so both operands must hold their value in their first n limbs
+ * with zeros above it up to n. DOT_JIT_ADD then gives the result of dot_add_n, carry flag included, and
+ * DOT_JIT_SUB that of dot_sub_n. Kernels are generated on first use and cached, later calls for the same
+ * operation and n are a load. The pointer stays valid until dot_jit_clear.
+ *
+ * @param op DOT_JIT_ADD or DOT_JIT_SUB
+ * @param n The number of limbs, at most 4096
+ * @return dot_jit_func_t The kernel, or NULL when n is too large or no executable memory could be mapped
+ */
+dot_jit_func_t dot_jit_get(dot_jit_op_t op, size_t n);
+
+/**
+ * @brief Unmaps every generated kernel, no thread may still be calling one
+ *
+ * @return void
+ */
+void dot_jit_clear(void);
 #endif // DOT_H
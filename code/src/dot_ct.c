@@ -0,0 +1,167 @@
+#include "dot_utils.h"
+#include "dot.h"
+
+/*
+    Constant-time variants of the exact kernels. The exact kernels take a second pass over a chunk only when
+    a carry lands on an all-ones lane, dot_sub_n compares its operands limb by limb and stops at the first
+    difference, and both work on the used limbs only, so their latency depends on the values. Here every
+    chunk resolves its carries the same way whatever the data: with G the lanes that overflow and P the
+    lanes that are all ones (zero for a borrow), the lanes a carry reaches are ((G << 1 | c_in) + P) ^ P,
+    one scalar addition in which the carry ripples through P. Operands are swapped with masked blends,
+    lengths come from the sizes, which are public, and used counts are found without branches.
+
+    The instruction stream and the addresses touched depend only on the sizes. dudect.c in the microbench
+    checks it.
+*/
+
+// Function to add a chunk held in registers, lanes outside k must be zero in both operands
+static inline __m512i __add_ct(__m512i a_vec, __m512i b_vec, unsigned *carry, __mmask8 k, unsigned top)
+{
+    __m512i result_vec = _mm512_add_epi64(a_vec, b_vec);
+    unsigned g = _mm512_mask_cmplt_epu64_mask(k, result_vec, a_vec);
+    unsigned p = _mm512_mask_cmpeq_epu64_mask(k, result_vec, AVX512_MASK);
+    unsigned s = ((g << 1) | *carry) + p;
+    *carry = s >> (top + 1);
+    return _mm512_mask_sub_epi64(result_vec, (__mmask8)((s ^ p) & k), result_vec, AVX512_MASK);
+}
+
+// Function to subtract a chunk held in registers, lanes outside k must be zero in both operands
+static inline __m512i __sub_ct(__m512i a_vec, __m512i b_vec, unsigned *borrow, __mmask8 k, unsigned top)
+{
+    __m512i result_vec = _mm512_sub_epi64(a_vec, b_vec);
+    unsigned g = _mm512_mask_cmpgt_epu64_mask(k, b_vec, a_vec);
+    unsigned p = _mm512_mask_cmpeq_epu64_mask(k, result_vec, AVX512_ZEROS);
+    unsigned s = ((g << 1) | *borrow) + p;
+    *borrow = s >> (top + 1);
+    return _mm512_mask_add_epi64(result_vec, (__mmask8)((s ^ p) & k), result_vec, AVX512_MASK);
+}
+
+// Function to get the number of significant limbs among the n at limbs, reading all of them
+static inline size_t __used_ct(const uint64_t *limbs, size_t n)
+{
+    size_t used = 0;
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __mmask8 k = n - i >= 8 ? 0xFF : (__mmask8)((1U << (n - i)) - 1);
+        __m512i vec = _mm512_maskz_loadu_epi64(k, limbs + i);
+        unsigned nonzero = _mm512_test_epi64_mask(vec, vec);
+
+        // bsr of nonzero << 1 | 1 is the position of the highest nonzero limb plus one, or 0 for none
+        size_t top = 31 - __builtin_clz((nonzero << 1) | 1);
+        size_t found = 0 - (size_t)(top != 0);
+        used += (i + top - used) & found;
+    }
+    return used;
+}
+
+// Function to finish a constant-time result of n limbs: used count from all of them, zeros up to the size
+static inline void __finish_ct(dot_limb_t *result, size_t n, uint64_t carry)
+{
+    size_t size = result->size;
+    n = n > size ? size : n;
+    if (n < size)
+    {
+        // The carry becomes a limb, 0 or 1, whenever there is room for it
+        result->dot_limbs[n++] = carry;
+        carry = 0;
+    }
+    memset(result->dot_limbs + n, 0, (size - n) * sizeof(uint64_t));
+    result->carry = carry;
+    size_t full = 0 - (size_t)carry;
+    result->used = (__used_ct(result->dot_limbs, n) & ~full) | (size & full);
+}
+
+uint64_t dot_add_nc_ct(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, uint64_t carry)
+{
+    unsigned c = (unsigned)(carry & 1);
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512i a_vec = _mm512_loadu_si512((__m512i *)(a + i));
+        __m512i b_vec = _mm512_loadu_si512((__m512i *)(b + i));
+        _mm512_storeu_si512((__m512i *)(result + i), __add_ct(a_vec, b_vec, &c, 0xFF, 7));
+    }
+    if (i < n)
+    {
+        unsigned top = (unsigned)(n - i - 1);
+        __mmask8 k = (__mmask8)((2U << top) - 1);
+        __m512i a_vec = _mm512_maskz_loadu_epi64(k, a + i);
+        __m512i b_vec = _mm512_maskz_loadu_epi64(k, b + i);
+        _mm512_mask_storeu_epi64(result + i, k, __add_ct(a_vec, b_vec, &c, k, top));
+    }
+    return c;
+}
+
+uint64_t dot_sub_nc_ct(uint64_t *result, const uint64_t *x, const uint64_t *y, size_t n, uint64_t borrow)
+{
+    unsigned bw = (unsigned)(borrow & 1);
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512i x_vec = _mm512_loadu_si512((__m512i *)(x + i));
+        __m512i y_vec = _mm512_loadu_si512((__m512i *)(y + i));
+        _mm512_storeu_si512((__m512i *)(result + i), __sub_ct(x_vec, y_vec, &bw, 0xFF, 7));
+    }
+    if (i < n)
+    {
+        unsigned top = (unsigned)(n - i - 1);
+        __mmask8 k = (__mmask8)((2U << top) - 1);
+        __m512i x_vec = _mm512_maskz_loadu_epi64(k, x + i);
+        __m512i y_vec = _mm512_maskz_loadu_epi64(k, y + i);
+        _mm512_mask_storeu_epi64(result + i, k, __sub_ct(x_vec, y_vec, &bw, k, top));
+    }
+    return bw;
+}
+
+void dot_add_n_ct(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    // Every limb up to the size, the used counts would tell how large the operands are
+    const size_t n = a->size;
+    uint64_t carry = dot_add_nc_ct(result->dot_limbs, a->dot_limbs, b->dot_limbs, n, 0);
+    __finish_ct(result, n, carry);
+}
+
+void dot_sub_n_ct(dot_limb_t *result, dot_limb_t *x, dot_limb_t *y)
+{
+    const size_t n = x->size;
+    const uint64_t *xl = x->dot_limbs, *yl = y->dot_limbs;
+
+    // The borrow of x - y says which operand is larger, found by a pass that stores nothing
+    unsigned bw = 0;
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __sub_ct(_mm512_loadu_si512((__m512i *)(xl + i)), _mm512_loadu_si512((__m512i *)(yl + i)), &bw, 0xFF, 7);
+    }
+    if (i < n)
+    {
+        unsigned top = (unsigned)(n - i - 1);
+        __mmask8 k = (__mmask8)((2U << top) - 1);
+        __sub_ct(_mm512_maskz_loadu_epi64(k, xl + i), _mm512_maskz_loadu_epi64(k, yl + i), &bw, k, top);
+    }
+
+    // Then the larger minus the smaller, with the operands swapped lane by lane rather than by a branch
+    __mmask8 swap = (__mmask8)(0 - bw);
+    unsigned borrow = 0;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512i x_vec = _mm512_loadu_si512((__m512i *)(xl + i));
+        __m512i y_vec = _mm512_loadu_si512((__m512i *)(yl + i));
+        __m512i hi = _mm512_mask_blend_epi64(swap, x_vec, y_vec);
+        __m512i lo = _mm512_mask_blend_epi64(swap, y_vec, x_vec);
+        _mm512_storeu_si512((__m512i *)(result->dot_limbs + i), __sub_ct(hi, lo, &borrow, 0xFF, 7));
+    }
+    if (i < n)
+    {
+        unsigned top = (unsigned)(n - i - 1);
+        __mmask8 k = (__mmask8)((2U << top) - 1);
+        __m512i x_vec = _mm512_maskz_loadu_epi64(k, xl + i);
+        __m512i y_vec = _mm512_maskz_loadu_epi64(k, yl + i);
+        __m512i hi = _mm512_mask_blend_epi64(swap, x_vec, y_vec);
+        __m512i lo = _mm512_mask_blend_epi64(swap, y_vec, x_vec);
+        _mm512_mask_storeu_epi64(result->dot_limbs + i, k, __sub_ct(hi, lo, &borrow, k, top));
+    }
+
+    result->sign = bw;
+    __finish_ct(result, n, 0);
+}
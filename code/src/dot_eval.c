@@ -0,0 +1,450 @@
+#include "dot_utils.h"
+#include "dot.h"
+
+/*
+    Fused evaluation of sums and differences. Whatever its shape, an expression DAG is a signed combination
+    of its leaves, so dot_eval first folds it into one coefficient per distinct operand and then makes a
+    single pass over the limbs. Each 8-limb block of every operand is loaded once and, shifted left by every
+    set bit of its coefficient, added to or subtracted from an accumulator, while a second vector counts the
+    carries (+1) and borrows (-1) out of every lane and takes the bits shifted out of it. The counts, moved
+    one lane up with the count out of the previous block in lane 0, are then added to the accumulator. They
+    are bounded by the sum of the coefficients, so they seldom take a lane across 0 or 2^64, and when they do
+    the positive and negative parts are added separately, each resolved with one scalar addition of generate
+    and propagate masks. What leaves the top lane is the signed count into the next block, known before the
+    block is resolved, so blocks do not wait for each other. Where every operand has limbs, two blocks share
+    each walk over the terms. The expression thus costs one read of every operand and one write of the
+    result, with no temporaries and no pass per operator.
+
+    The operands are magnitudes, their sign fields are ignored as in dot_add_n. A negative total is negated
+    in a second pass over the result alone and reported in result->sign, as dot_sub_n does. What is left
+    above the longest operand goes into the next limb of the result; without one, the carry flag is set but,
+    unlike dot_add_n, it may stand for more than one 2^(64 size), which is lost.
+*/
+
+#define EXPR_MIN_CAPACITY 16                // Nodes of the first allocation of an expression
+#define EVAL_STACK_TERMS 16                 // Distinct operands evaluated without allocating
+#define EVAL_MAX_WEIGHT ((uint64_t)1 << 61) // Largest sum of |coeff| over the terms, keeps the lane counts in an int64_t
+
+// A distinct operand of a folded expression
+typedef struct
+{
+    const uint64_t *limbs;
+    size_t used;
+    size_t full;   // Whole 8-limb blocks of the operand
+    __mmask8 tail; // Lanes of its block after them
+    int64_t coeff; // Times the operand is added, negative when it is subtracted
+} eval_term_t;
+
+// Function to add non-negative counts to a chunk, the carry into lane 0 comes in and the one out of lane top goes out
+static inline __m512i __add_counts(__m512i acc, __m512i counts, unsigned *carry, __mmask8 k, unsigned top)
+{
+    __m512i sum = _mm512_add_epi64(acc, counts);
+    unsigned g = _mm512_mask_cmplt_epu64_mask(k, sum, acc);
+    unsigned p = _mm512_mask_cmpeq_epu64_mask(k, sum, AVX512_MASK);
+    unsigned s = ((g << 1) | *carry) + p;
+    *carry = s >> (top + 1);
+    return _mm512_mask_sub_epi64(sum, (__mmask8)((s ^ p) & k), sum, AVX512_MASK);
+}
+
+// Function to subtract non-negative counts from a chunk, as __add_counts with a borrow
+static inline __m512i __sub_counts(__m512i acc, __m512i counts, unsigned *borrow, __mmask8 k, unsigned top)
+{
+    __m512i diff = _mm512_sub_epi64(acc, counts);
+    unsigned g = _mm512_mask_cmpgt_epu64_mask(k, counts, acc);
+    unsigned p = _mm512_mask_cmpeq_epu64_mask(k, diff, AVX512_ZEROS);
+    unsigned s = ((g << 1) | *borrow) + p;
+    *borrow = s >> (top + 1);
+    return _mm512_mask_add_epi64(diff, (__mmask8)((s ^ p) & k), diff, AVX512_MASK);
+}
+
+// Function to append a node to an expression, returns its id
+static size_t __expr_push(dot_expr_t *expr, dot_expr_kind_t kind, const dot_limb_t *leaf, size_t left, size_t right)
+{
+    if (expr->count == expr->capacity)
+    {
+        size_t capacity = expr->capacity ? 2 * expr->capacity : EXPR_MIN_CAPACITY;
+        dot_expr_node_t *nodes = (dot_expr_node_t *)realloc(expr->nodes, capacity * sizeof(dot_expr_node_t));
+        if (nodes == NULL)
+        {
+            perror("Memory allocation failed for the expression nodes\n");
+            exit(EXIT_FAILURE);
+        }
+        expr->nodes = nodes;
+        int64_t *coeffs = (int64_t *)realloc(expr->coeffs, capacity * sizeof(int64_t));
+        if (coeffs == NULL)
+        {
+            perror("Memory allocation failed for the expression nodes\n");
+            exit(EXIT_FAILURE);
+        }
+        expr->coeffs = coeffs;
+        expr->capacity = capacity;
+    }
+    dot_expr_node_t *node = &expr->nodes[expr->count];
+    node->kind = kind;
+    node->leaf = leaf;
+    node->left = left;
+    node->right = right;
+    return expr->count++;
+}
+
+// Function to stop on a node id that the expression does not have yet
+static void __expr_check(const dot_expr_t *expr, size_t id, const char *func)
+{
+    if (id >= expr->count)
+    {
+        fprintf(stderr, "%s: node %zu is not in the expression (%zu nodes)\n", func, id, expr->count);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void dot_expr_init(dot_expr_t *expr)
+{
+    expr->nodes = NULL;
+    expr->coeffs = NULL;
+    expr->count = 0;
+    expr->capacity = 0;
+}
+
+void dot_expr_reset(dot_expr_t *expr)
+{
+    expr->count = 0;
+}
+
+void dot_expr_free(dot_expr_t *expr)
+{
+    free(expr->nodes);
+    free(expr->coeffs);
+    dot_expr_init(expr);
+}
+
+size_t dot_expr_leaf(dot_expr_t *expr, const dot_limb_t *x)
+{
+    return __expr_push(expr, DOT_EXPR_LEAF, x, 0, 0);
+}
+
+size_t dot_expr_add(dot_expr_t *expr, size_t left, size_t right)
+{
+    __expr_check(expr, left, "dot_expr_add");
+    __expr_check(expr, right, "dot_expr_add");
+    return __expr_push(expr, DOT_EXPR_ADD, NULL, left, right);
+}
+
+size_t dot_expr_sub(dot_expr_t *expr, size_t left, size_t right)
+{
+    __expr_check(expr, left, "dot_expr_sub");
+    __expr_check(expr, right, "dot_expr_sub");
+    return __expr_push(expr, DOT_EXPR_SUB, NULL, left, right);
+}
+
+// Function to stop on coefficients that do not fit, about 61 doublings of a node are enough
+static void __coeff_overflow(void)
+{
+    fprintf(stderr, "dot_eval: the operands are used more than 2^61 times in all, the expression cannot be evaluated\n");
+    exit(EXIT_FAILURE);
+}
+
+// Function to fold the expression under root into terms, returns their number and the longest used count
+static size_t __fold(dot_expr_t *expr, size_t root, eval_term_t *terms, size_t *n)
+{
+    // Children are older than their parents, so one walk down from the root hands every node its multiplicity
+    int64_t *coeffs = expr->coeffs;
+    memset(coeffs, 0, (root + 1) * sizeof(int64_t));
+    coeffs[root] = 1;
+    for (size_t id = root + 1; id-- > 0;)
+    {
+        const dot_expr_node_t *node = &expr->nodes[id];
+        if (coeffs[id] != 0 && node->kind != DOT_EXPR_LEAF)
+        {
+            bool overflow = __builtin_add_overflow(coeffs[node->left], coeffs[id], &coeffs[node->left]);
+            overflow |= node->kind == DOT_EXPR_ADD
+                            ? __builtin_add_overflow(coeffs[node->right], coeffs[id], &coeffs[node->right])
+                            : __builtin_sub_overflow(coeffs[node->right], coeffs[id], &coeffs[node->right]);
+            if (unlikely(overflow))
+            {
+                __coeff_overflow();
+            }
+        }
+    }
+
+    // The same operand may sit in several leaves, its coefficients add up and may cancel
+    size_t num_terms = 0;
+    for (size_t id = 0; id <= root; id++)
+    {
+        const dot_expr_node_t *node = &expr->nodes[id];
+        if (node->kind != DOT_EXPR_LEAF || coeffs[id] == 0)
+        {
+            continue;
+        }
+        size_t t = 0;
+        while (t < num_terms && terms[t].limbs != node->leaf->dot_limbs)
+        {
+            t++;
+        }
+        if (t == num_terms)
+        {
+            terms[num_terms].limbs = node->leaf->dot_limbs;
+            terms[num_terms].used = node->leaf->used;
+            terms[num_terms++].coeff = 0;
+        }
+        if (unlikely(__builtin_add_overflow(terms[t].coeff, coeffs[id], &terms[t].coeff)))
+        {
+            __coeff_overflow();
+        }
+    }
+
+    // Zero terms go, added ones come first so the first of them can start the accumulator
+    size_t kept = 0;
+    *n = 0;
+    for (int positive = 1; positive >= 0; positive--)
+    {
+        for (size_t t = kept; t < num_terms; t++)
+        {
+            if (terms[t].coeff != 0 && (terms[t].coeff > 0) == positive)
+            {
+                eval_term_t term = terms[t];
+                terms[t] = terms[kept];
+                terms[kept++] = term;
+            }
+        }
+    }
+    uint64_t weight = 0;
+    for (size_t t = 0; t < kept; t++)
+    {
+        // A lane count is at most the sum of the coefficients plus the carry into the block
+        uint64_t c = terms[t].coeff < 0 ? -(uint64_t)terms[t].coeff : (uint64_t)terms[t].coeff;
+        if (unlikely(__builtin_add_overflow(weight, c, &weight) || weight > EVAL_MAX_WEIGHT))
+        {
+            __coeff_overflow();
+        }
+        terms[t].full = terms[t].used / 8;
+        terms[t].tail = (__mmask8)((1U << (terms[t].used % 8)) - 1);
+        *n = terms[t].used > *n ? terms[t].used : *n;
+    }
+    return kept;
+}
+
+// Function to negate the n limbs at limbs in place, returns the carry out of ~x + 1
+static unsigned __negate(uint64_t *limbs, size_t n)
+{
+    unsigned carry = 1;
+    for (size_t i = 0; i < n; i += 8)
+    {
+        unsigned top = n - i >= 8 ? 7 : (unsigned)(n - i - 1);
+        __mmask8 k = (__mmask8)((2U << top) - 1);
+        __m512i x = _mm512_maskz_loadu_epi64(k, limbs + i);
+        x = __add_counts(_mm512_maskz_xor_epi64(k, x, AVX512_MASK), AVX512_ZEROS, &carry, k, top);
+        _mm512_mask_storeu_epi64(limbs + i, k, x);
+    }
+    return carry;
+}
+
+// Function to add (c > 0) or subtract (c < 0) c x, as x 2^b for every set bit b of |c|: x << b goes to the lane
+// with its carry or borrow, the bits x >> (64 - b) shifted out of it go to its count
+static inline void __accumulate_term(__m512i x, int64_t c, __m512i *acc, __m512i *counts)
+{
+    uint64_t bits = c < 0 ? -(uint64_t)c : (uint64_t)c;
+    while (bits)
+    {
+        int b = __builtin_ctzll(bits);
+        bits &= bits - 1;
+        // Shifts by 64 or more give zero, so b = 0 shifts nothing out
+        __m512i low = _mm512_sll_epi64(x, _mm_cvtsi32_si128(b));
+        __m512i high = _mm512_srl_epi64(x, _mm_cvtsi32_si128(64 - b));
+        if (c > 0)
+        {
+            __m512i sum = _mm512_add_epi64(*acc, low);
+            *counts = _mm512_mask_sub_epi64(*counts, _mm512_cmplt_epu64_mask(sum, *acc), *counts, AVX512_MASK);
+            *counts = _mm512_add_epi64(*counts, high);
+            *acc = sum;
+        }
+        else
+        {
+            *counts = _mm512_mask_add_epi64(*counts, _mm512_cmplt_epu64_mask(*acc, low), *counts, AVX512_MASK);
+            *counts = _mm512_sub_epi64(*counts, high);
+            *acc = _mm512_sub_epi64(*acc, low);
+        }
+    }
+}
+
+// Function to load the block at limb i of a term, zero above its used limbs
+static inline __m512i __load_term(const eval_term_t *term, size_t i, bool whole)
+{
+    size_t block = i / 8;
+    if (whole || block < term->full)
+    {
+        return _mm512_loadu_si512((__m512i *)(term->limbs + i));
+    }
+    return block == term->full ? _mm512_maskz_loadu_epi64(term->tail, term->limbs + i) : AVX512_ZEROS;
+}
+
+// Function to sum the terms over the block at limb i into acc, with the carries and borrows of each lane in counts
+static inline __attribute__((always_inline)) void __accumulate(const eval_term_t *terms, size_t num_terms, size_t i, bool whole, __m512i *acc, __m512i *counts)
+{
+    // Added terms come first, the first of them starts the accumulator
+    *counts = AVX512_ZEROS;
+    *acc = AVX512_ZEROS;
+    size_t t = 0;
+    if (terms[0].coeff > 0)
+    {
+        *acc = __load_term(&terms[0], i, whole);
+        __accumulate_term(*acc, terms[0].coeff - 1, acc, counts);
+        t = 1;
+    }
+    for (; t < num_terms; t++)
+    {
+        __m512i x = __load_term(&terms[t], i, whole);
+        int64_t c = terms[t].coeff;
+        if (likely(c == 1))
+        {
+            __m512i sum = _mm512_add_epi64(*acc, x);
+            *counts = _mm512_mask_sub_epi64(*counts, _mm512_cmplt_epu64_mask(sum, *acc), *counts, AVX512_MASK);
+            *acc = sum;
+        }
+        else if (likely(c == -1))
+        {
+            *counts = _mm512_mask_add_epi64(*counts, _mm512_cmplt_epu64_mask(*acc, x), *counts, AVX512_MASK);
+            *acc = _mm512_sub_epi64(*acc, x);
+        }
+        else
+        {
+            __accumulate_term(x, c, acc, counts);
+        }
+    }
+}
+
+// Function to sum the terms over the two whole blocks at limbs i and i + 8, as __accumulate
+static inline __attribute__((always_inline)) void __accumulate_pair(const eval_term_t *terms, size_t num_terms, size_t i, __m512i acc[2], __m512i counts[2])
+{
+    counts[0] = counts[1] = AVX512_ZEROS;
+    acc[0] = acc[1] = AVX512_ZEROS;
+    size_t t = 0;
+    if (terms[0].coeff > 0)
+    {
+        acc[0] = _mm512_loadu_si512((__m512i *)(terms[0].limbs + i));
+        acc[1] = _mm512_loadu_si512((__m512i *)(terms[0].limbs + i + 8));
+        __accumulate_term(acc[0], terms[0].coeff - 1, &acc[0], &counts[0]);
+        __accumulate_term(acc[1], terms[0].coeff - 1, &acc[1], &counts[1]);
+        t = 1;
+    }
+    for (; t < num_terms; t++)
+    {
+        __m512i x0 = _mm512_loadu_si512((__m512i *)(terms[t].limbs + i));
+        __m512i x1 = _mm512_loadu_si512((__m512i *)(terms[t].limbs + i + 8));
+        int64_t c = terms[t].coeff;
+        if (likely(c == 1))
+        {
+            __m512i sum0 = _mm512_add_epi64(acc[0], x0), sum1 = _mm512_add_epi64(acc[1], x1);
+            counts[0] = _mm512_mask_sub_epi64(counts[0], _mm512_cmplt_epu64_mask(sum0, acc[0]), counts[0], AVX512_MASK);
+            counts[1] = _mm512_mask_sub_epi64(counts[1], _mm512_cmplt_epu64_mask(sum1, acc[1]), counts[1], AVX512_MASK);
+            acc[0] = sum0;
+            acc[1] = sum1;
+        }
+        else if (likely(c == -1))
+        {
+            counts[0] = _mm512_mask_add_epi64(counts[0], _mm512_cmplt_epu64_mask(acc[0], x0), counts[0], AVX512_MASK);
+            counts[1] = _mm512_mask_add_epi64(counts[1], _mm512_cmplt_epu64_mask(acc[1], x1), counts[1], AVX512_MASK);
+            acc[0] = _mm512_sub_epi64(acc[0], x0);
+            acc[1] = _mm512_sub_epi64(acc[1], x1);
+        }
+        else
+        {
+            __accumulate_term(x0, c, &acc[0], &counts[0]);
+            __accumulate_term(x1, c, &acc[1], &counts[1]);
+        }
+    }
+}
+
+// Function to add the counts of a block to its sum, the carry vector holds the count into the block in every lane
+// and gets the count out of lane top
+static inline __m512i __resolve(__m512i acc, __m512i counts, __m512i *carry, __mmask8 k, unsigned top)
+{
+    // The count of lane j is worth 2^64 in lane j + 1
+    __m512i up = _mm512_maskz_alignr_epi64(k, counts, *carry, 7);
+    *carry = _mm512_permutexvar_epi64(_mm512_set1_epi64(top), counts);
+    __m512i sum = _mm512_add_epi64(acc, up);
+
+    // The counts rarely move a lane across 0 or 2^64, and only then do they ripple: a lane has wrapped when it
+    // went down with a positive count or up with a negative one
+    __mmask8 wrapped = _mm512_cmplt_epu64_mask(sum, acc) ^ _mm512_cmplt_epi64_mask(up, AVX512_ZEROS);
+    if (unlikely(wrapped))
+    {
+        unsigned c = 0, bw = 0;
+        sum = __add_counts(acc, _mm512_max_epi64(up, AVX512_ZEROS), &c, k, top);
+        sum = __sub_counts(sum, _mm512_max_epi64(_mm512_sub_epi64(AVX512_ZEROS, up), AVX512_ZEROS), &bw, k, top);
+        *carry = _mm512_add_epi64(*carry, _mm512_set1_epi64((int64_t)c - (int64_t)bw));
+    }
+    return sum;
+}
+
+void dot_eval(dot_limb_t *result, dot_expr_t *expr, size_t root)
+{
+    __expr_check(expr, root, "dot_eval");
+
+    // At most one term per leaf under the root
+    eval_term_t stack_terms[EVAL_STACK_TERMS], *terms = stack_terms;
+    size_t leaves = 0;
+    for (size_t id = 0; id <= root; id++)
+    {
+        leaves += expr->nodes[id].kind == DOT_EXPR_LEAF;
+    }
+    if (leaves > EVAL_STACK_TERMS && (terms = (eval_term_t *)malloc(leaves * sizeof(eval_term_t))) == NULL)
+    {
+        perror("Memory allocation failed for the expression terms\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t n;
+    size_t num_terms = __fold(expr, root, terms, &n);
+
+    // Blocks below every operand's used limbs load without checks
+    size_t whole = n / 8;
+    for (size_t t = 0; t < num_terms; t++)
+    {
+        whole = terms[t].full < whole ? terms[t].full : whole;
+    }
+
+    // Signed count into the next block, worth 2^64 in its lane 0, kept in every lane of a vector
+    __m512i carry = AVX512_ZEROS;
+    size_t i = 0;
+
+    // Pairs of whole blocks share one walk over the terms
+    for (; i + 16 <= whole * 8; i += 16)
+    {
+        __m512i acc[2], counts[2];
+        __accumulate_pair(terms, num_terms, i, acc, counts);
+        _mm512_storeu_si512((__m512i *)(result->dot_limbs + i), __resolve(acc[0], counts[0], &carry, 0xFF, 7));
+        _mm512_storeu_si512((__m512i *)(result->dot_limbs + i + 8), __resolve(acc[1], counts[1], &carry, 0xFF, 7));
+    }
+    for (; i < n; i += 8)
+    {
+        unsigned top = n - i >= 8 ? 7 : (unsigned)(n - i - 1);
+        __mmask8 k = (__mmask8)((2U << top) - 1);
+        __m512i acc, counts;
+        __accumulate(terms, num_terms, i, i / 8 < whole, &acc, &counts);
+        _mm512_mask_storeu_epi64(result->dot_limbs + i, k, __resolve(acc, counts, &carry, k, top));
+    }
+
+    // result = limbs + carry 2^(64n), |result| = 2^(64n) - limbs + (-carry - 1) 2^(64n) when carry < 0
+    int64_t count = _mm_cvtsi128_si64(_mm512_castsi512_si128(carry));
+    uint64_t high = (uint64_t)count;
+    result->sign = count < 0;
+    if (count < 0)
+    {
+        high = (uint64_t)(-(count + 1)) + __negate(result->dot_limbs, n);
+    }
+
+    size_t size = result->size;
+    n = n > size ? size : n;
+    if (high && n < size)
+    {
+        result->dot_limbs[n++] = high;
+        high = 0;
+    }
+    result->carry = high != 0;
+    // With the carry flag set the magnitude did not fit and spans every limb
+    __set_used(result, result->carry ? size : __normalize(result->dot_limbs, n));
+
+    if (terms != stack_terms)
+    {
+        free(terms);
+    }
+}
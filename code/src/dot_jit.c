@@ -0,0 +1,374 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sys/mman.h>
+#include "dot_utils.h"
+#include "dot.h"
+
+/*
+    Size-specialised kernels generated at run time. For a limb count fixed when the kernel is asked for,
+    dot_jit_get writes straight-line AVX-512 code for it into an executable mapping: one block of
+    instructions per 8-limb chunk at constant offsets, the tail mask loaded once, no loop counter and no
+    used counts read. Carries are resolved as in dot_ct.c, with G the lanes that overflow and P the lanes
+    that are all ones (zero for a borrow), the lanes a carry reaches are ((G << 1 | c_in) + P) ^ P, so a
+    chunk costs a few vector instructions and one scalar addition whatever the data, with no branch.
+
+    The one branch is in the prologue of a subtraction. It compares the top chunks of its operands, and a
+    jbe skips the xchg of the two operand pointers unless b is larger there, as dot_sub_n does, so the chunk
+    loads do not wait for the comparison. Only operands that agree on their top 8 limbs can then end in a
+    borrow, which the finish negates. The code ends with a jump to a C function that sets the carry or sign
+    and the used count.
+
+    Kernels are cached by operation and limb count and live until dot_jit_clear. Only the encodings below
+    are emitted, for zmm0-zmm3, k1-k4 and registers the System V ABI lets a callee clobber.
+*/
+
+#define DOT_JIT_MAX_LIMBS 4096 // Largest limb count a kernel is generated for, about 40 KB of code
+#define JIT_CHUNK_BYTES 96     // Upper bound on the code of one 8-limb chunk
+#define JIT_FIXED_BYTES 256    // Upper bound on the prologue, operand swap, tail mask and epilogue
+
+// Code emitted so far
+typedef struct
+{
+    uint8_t *code;
+    size_t length;
+} jit_buffer_t;
+
+// A generated kernel and the mapping holding it
+typedef struct
+{
+    dot_jit_func_t func;
+    size_t length;
+} jit_kernel_t;
+
+static jit_kernel_t jit_cache[2][DOT_JIT_MAX_LIMBS + 1]; // Kernels by operation and limb count
+static pthread_mutex_t jit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Registers by encoding
+enum
+{
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RSI = 6,
+    RDI = 7,
+};
+
+// EVEX opcode maps and implied prefixes
+enum
+{
+    MAP_0F = 1,
+    MAP_0F38 = 2,
+    MAP_0F3A = 3,
+};
+
+enum
+{
+    PP_NONE = 0,
+    PP_66 = 1,
+    PP_F3 = 2,
+};
+
+static inline void __emit8(jit_buffer_t *buf, uint8_t byte)
+{
+    buf->code[buf->length++] = byte;
+}
+
+static inline void __emit32(jit_buffer_t *buf, uint32_t value)
+{
+    memcpy(buf->code + buf->length, &value, sizeof(value));
+    buf->length += sizeof(value);
+}
+
+static inline void __emit64(jit_buffer_t *buf, uint64_t value)
+{
+    memcpy(buf->code + buf->length, &value, sizeof(value));
+    buf->length += sizeof(value);
+}
+
+static void __emit_bytes(jit_buffer_t *buf, const uint8_t *bytes, size_t n)
+{
+    memcpy(buf->code + buf->length, bytes, n);
+    buf->length += n;
+}
+
+// Function to emit the EVEX prefix and opcode of a 512-bit instruction on registers 0-7
+static void __emit_evex(jit_buffer_t *buf, int map, int pp, int w, int vvvv, int zeroing, int mask, uint8_t opcode)
+{
+    __emit8(buf, 0x62);
+    __emit8(buf, (uint8_t)(0xF0 | map));                                   // R, X, B and R' inverted, all clear
+    __emit8(buf, (uint8_t)((w << 7) | ((~vvvv & 0xF) << 3) | 0x4 | pp));    // vvvv inverted
+    __emit8(buf, (uint8_t)((zeroing << 7) | (2 << 5) | 0x8 | mask));       // L'L = 512 bits, V' inverted
+    __emit8(buf, opcode);
+}
+
+// Function to emit a register-register ModRM byte
+static inline void __emit_reg(jit_buffer_t *buf, int reg, int rm)
+{
+    __emit8(buf, (uint8_t)(0xC0 | (reg << 3) | rm));
+}
+
+// Function to emit a ModRM byte for [base + disp32], a 32-bit displacement is never scaled by EVEX
+static inline void __emit_mem(jit_buffer_t *buf, int reg, int base, uint32_t disp)
+{
+    __emit8(buf, (uint8_t)(0x80 | (reg << 3) | base));
+    __emit32(buf, disp);
+}
+
+// Function to emit one chunk: zmm1 = a, zmm2 = b, zmm0 = a +- b with the carry of r8d resolved, stored
+static void __emit_chunk(jit_buffer_t *buf, dot_jit_op_t op, uint32_t offset, int mask, unsigned lanes)
+{
+    int zeroing = mask != 0;
+
+    // vmovdqu64 zmm1{k}{z}, [rsi + offset] and zmm2{k}{z}, [rdx + offset], masked lanes are zero
+    __emit_evex(buf, MAP_0F, PP_F3, 1, 0, zeroing, mask, 0x6F);
+    __emit_mem(buf, 1, RSI, offset);
+    __emit_evex(buf, MAP_0F, PP_F3, 1, 0, zeroing, mask, 0x6F);
+    __emit_mem(buf, 2, RDX, offset);
+
+    if (op == DOT_JIT_ADD)
+    {
+        // vpaddq zmm0, zmm1, zmm2
+        __emit_evex(buf, MAP_0F, PP_66, 1, 1, 0, 0, 0xD4);
+        __emit_reg(buf, 0, 2);
+        // vpcmpuq k1, zmm0, zmm1, LT: the lanes that overflow
+        __emit_evex(buf, MAP_0F3A, PP_66, 1, 0, 0, 0, 0x1E);
+        __emit_reg(buf, 1, 1);
+        __emit8(buf, 0x01);
+        // vpcmpeqq k2{k}, zmm0, zmm3: the lanes a carry goes through
+        __emit_evex(buf, MAP_0F38, PP_66, 1, 0, 0, mask, 0x29);
+        __emit_reg(buf, 2, 3);
+    }
+    else
+    {
+        // vpsubq zmm0, zmm1, zmm2
+        __emit_evex(buf, MAP_0F, PP_66, 1, 1, 0, 0, 0xFB);
+        __emit_reg(buf, 0, 2);
+        // vpcmpuq k1, zmm1, zmm2, LT: the lanes that borrow
+        __emit_evex(buf, MAP_0F3A, PP_66, 1, 1, 0, 0, 0x1E);
+        __emit_reg(buf, 1, 2);
+        __emit8(buf, 0x01);
+        // vptestnmq k2{k}, zmm0, zmm0: the lanes a borrow goes through, masked lanes are zero too
+        __emit_evex(buf, MAP_0F38, PP_F3, 1, 0, 0, mask, 0x27);
+        __emit_reg(buf, 2, 0);
+    }
+
+    static const uint8_t resolve[] = {
+        0xC5, 0xF8, 0x93, 0xC1, // kmovw eax, k1
+        0xC5, 0xF8, 0x93, 0xCA, // kmovw ecx, k2
+        0x8D, 0x04, 0x41,       // lea eax, [rcx + rax * 2]
+        0x44, 0x01, 0xC0,       // add eax, r8d
+        0x41, 0x89, 0xC0,       // mov r8d, eax
+        0x41, 0xC1, 0xE8,       // shr r8d, imm8
+    };
+    __emit_bytes(buf, resolve, sizeof(resolve));
+    __emit8(buf, (uint8_t)lanes); // The carry out is the bit above the top lane
+    static const uint8_t apply[] = {
+        0x31, 0xC8,             // xor eax, ecx: the lanes the carries reach
+        0xC5, 0xF8, 0x92, 0xD8, // kmovw k3, eax
+    };
+    __emit_bytes(buf, apply, sizeof(apply));
+
+    // vpsubq zmm0{k3}, zmm0, zmm3 adds the carries, vpaddq takes the borrows
+    __emit_evex(buf, MAP_0F, PP_66, 1, 0, 0, 3, op == DOT_JIT_ADD ? 0xFB : 0xD4);
+    __emit_reg(buf, 0, 3);
+
+    // vmovdqu64 [rdi + offset]{k}, zmm0
+    __emit_evex(buf, MAP_0F, PP_F3, 1, 0, 0, mask, 0x7F);
+    __emit_mem(buf, 0, RDI, offset);
+}
+
+// Function to finish a generated sum of n limbs
+static void __jit_finish_add(dot_limb_t *result, size_t n, unsigned carry)
+{
+    __finish_sum(result, n, (__mmask16)carry);
+}
+
+// Function to finish a generated difference of n limbs, a borrow out means it wrapped and is negated
+static void __jit_finish_sub(dot_limb_t *result, size_t n, unsigned borrow, unsigned swapped)
+{
+    uint64_t *limbs = result->dot_limbs;
+    result->sign = (borrow != 0) != (swapped != 0);
+    if (borrow)
+    {
+        // 2^(64n) - x = ~x + 1, the one ripples through the limbs of x that are zero, x is not 0
+        size_t i;
+        for (i = 0; i + 8 <= n; i += 8)
+        {
+            __m512i x_vec = _mm512_loadu_si512((__m512i *)(limbs + i));
+            _mm512_storeu_si512((__m512i *)(limbs + i), _mm512_xor_si512(x_vec, AVX512_MASK));
+        }
+        if (i < n)
+        {
+            __mmask8 k = (__mmask8)((1U << (n - i)) - 1);
+            __m512i x_vec = _mm512_maskz_loadu_epi64(k, limbs + i);
+            _mm512_mask_storeu_epi64(limbs + i, k, _mm512_xor_si512(x_vec, AVX512_MASK));
+        }
+        for (i = 0; ++limbs[i] == 0; i++)
+        {
+        }
+    }
+    __set_used(result, __normalize(limbs, n));
+}
+
+// Function to write the kernel for op on n limbs into buf
+static void __jit_generate(jit_buffer_t *buf, dot_jit_op_t op, size_t n)
+{
+    uint32_t limbs = (uint32_t)offsetof(dot_limb_t, dot_limbs);
+
+    // Keep the result in r9 for the finish and load the three limb pointers, r8d is the carry
+    static const uint8_t save[] = {0x49, 0x89, 0xF9}; // mov r9, rdi
+    __emit_bytes(buf, save, sizeof(save));
+    static const uint8_t load_a[] = {0x48, 0x8B, 0xB6}; // mov rsi, [rsi + disp32]
+    __emit_bytes(buf, load_a, sizeof(load_a));
+    __emit32(buf, limbs);
+    static const uint8_t load_b[] = {0x48, 0x8B, 0x92}; // mov rdx, [rdx + disp32]
+    __emit_bytes(buf, load_b, sizeof(load_b));
+    __emit32(buf, limbs);
+    static const uint8_t load_result[] = {0x48, 0x8B, 0xBF}; // mov rdi, [rdi + disp32]
+    __emit_bytes(buf, load_result, sizeof(load_result));
+    __emit32(buf, limbs);
+    static const uint8_t clear[] = {0x45, 0x31, 0xC0}; // xor r8d, r8d
+    __emit_bytes(buf, clear, sizeof(clear));
+
+    // vpternlogd zmm3, zmm3, zmm3, 0xFF: all ones
+    __emit_evex(buf, MAP_0F3A, PP_66, 0, 3, 0, 0, 0x25);
+    __emit_reg(buf, 3, 3);
+    __emit8(buf, 0xFF);
+
+    size_t i;
+    int tail_mask = n % 8 != 0 ? 4 : 0;
+    if (tail_mask)
+    {
+        __emit8(buf, 0xB8); // mov eax, imm32
+        __emit32(buf, (1U << (n % 8)) - 1);
+        static const uint8_t set_tail[] = {0xC5, 0xF8, 0x92, 0xE0}; // kmovw k4, eax
+        __emit_bytes(buf, set_tail, sizeof(set_tail));
+    }
+    if (op == DOT_JIT_SUB && n > 0)
+    {
+        // Lanes where a < b and where a > b in the top chunk, the higher mask as a number has the higher lane
+        uint32_t top = (uint32_t)(((n - 1) & ~(size_t)7) * sizeof(uint64_t));
+        __emit_evex(buf, MAP_0F, PP_F3, 1, 0, tail_mask != 0, tail_mask, 0x6F);
+        __emit_mem(buf, 1, RSI, top);
+        __emit_evex(buf, MAP_0F, PP_F3, 1, 0, tail_mask != 0, tail_mask, 0x6F);
+        __emit_mem(buf, 2, RDX, top);
+        __emit_evex(buf, MAP_0F3A, PP_66, 1, 1, 0, 0, 0x1E); // vpcmpuq k1, zmm1, zmm2, LT
+        __emit_reg(buf, 1, 2);
+        __emit8(buf, 0x01);
+        __emit_evex(buf, MAP_0F3A, PP_66, 1, 1, 0, 0, 0x1E); // vpcmpuq k2, zmm1, zmm2, NLE
+        __emit_reg(buf, 2, 2);
+        __emit8(buf, 0x06);
+        static const uint8_t swap[] = {
+            0xC5, 0xF8, 0x93, 0xC1, // kmovw eax, k1
+            0xC5, 0xF8, 0x93, 0xCA, // kmovw ecx, k2
+            0x45, 0x31, 0xD2,       // xor r10d, r10d
+            0x39, 0xC8,             // cmp eax, ecx
+            0x76, 0x09,             // jbe over the swap
+            0x48, 0x87, 0xD6,       // xchg rsi, rdx
+            0x41, 0xBA, 0x01, 0x00, 0x00, 0x00, // mov r10d, 1: the sign unless the difference wraps
+        };
+        __emit_bytes(buf, swap, sizeof(swap));
+    }
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __emit_chunk(buf, op, (uint32_t)(i * sizeof(uint64_t)), 0, 8);
+    }
+    if (i < n)
+    {
+        __emit_chunk(buf, op, (uint32_t)(i * sizeof(uint64_t)), tail_mask, (unsigned)(n - i));
+    }
+
+    // Tail call of the finish with (result, n, carry) and for a subtraction the swap
+    static const uint8_t restore[] = {0x4C, 0x89, 0xCF}; // mov rdi, r9
+    __emit_bytes(buf, restore, sizeof(restore));
+    __emit8(buf, 0xBE); // mov esi, imm32
+    __emit32(buf, (uint32_t)n);
+    static const uint8_t carry[] = {
+        0x44, 0x89, 0xC2, // mov edx, r8d
+        0xC5, 0xF8, 0x77, // vzeroupper
+        0x48, 0xB8,       // mov rax, imm64
+    };
+    if (op == DOT_JIT_SUB)
+    {
+        static const uint8_t swapped[] = {0x44, 0x89, 0xD1}; // mov ecx, r10d
+        __emit_bytes(buf, swapped, sizeof(swapped));
+    }
+    __emit_bytes(buf, carry, sizeof(carry));
+    uintptr_t finish = op == DOT_JIT_ADD ? (uintptr_t)__jit_finish_add : (uintptr_t)__jit_finish_sub;
+    __emit64(buf, (uint64_t)finish);
+    static const uint8_t jump[] = {0xFF, 0xE0}; // jmp rax
+    __emit_bytes(buf, jump, sizeof(jump));
+}
+
+// Function to map, write and seal the kernel for op on n limbs
+static jit_kernel_t __jit_build(dot_jit_op_t op, size_t n)
+{
+    jit_kernel_t kernel = {NULL, 0};
+    size_t length = JIT_FIXED_BYTES + JIT_CHUNK_BYTES * (n / 8 + 1);
+    void *code = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+    {
+        return kernel;
+    }
+
+    jit_buffer_t buf = {(uint8_t *)code, 0};
+    __jit_generate(&buf, op, n);
+    assert(buf.length <= length);
+
+    // Never writable and executable at once
+    if (mprotect(code, length, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(code, length);
+        return kernel;
+    }
+    kernel.func = (dot_jit_func_t)code;
+    kernel.length = length;
+    return kernel;
+}
+
+dot_jit_func_t dot_jit_get(dot_jit_op_t op, size_t n)
+{
+    if ((op != DOT_JIT_ADD && op != DOT_JIT_SUB) || n > DOT_JIT_MAX_LIMBS)
+    {
+        return NULL;
+    }
+
+    // Kernels are published once complete, a hit needs no lock
+    dot_jit_func_t func = __atomic_load_n(&jit_cache[op][n].func, __ATOMIC_ACQUIRE);
+    if (likely(func != NULL))
+    {
+        return func;
+    }
+
+    pthread_mutex_lock(&jit_lock);
+    func = jit_cache[op][n].func;
+    if (func == NULL)
+    {
+        jit_kernel_t kernel = __jit_build(op, n);
+        jit_cache[op][n].length = kernel.length;
+        __atomic_store_n(&jit_cache[op][n].func, kernel.func, __ATOMIC_RELEASE);
+        func = kernel.func;
+    }
+    pthread_mutex_unlock(&jit_lock);
+    return func;
+}
+
+void dot_jit_clear(void)
+{
+    pthread_mutex_lock(&jit_lock);
+    for (int op = 0; op < 2; op++)
+    {
+        for (size_t n = 0; n <= DOT_JIT_MAX_LIMBS; n++)
+        {
+            jit_kernel_t *kernel = &jit_cache[op][n];
+            if (kernel->func != NULL)
+            {
+                munmap((void *)kernel->func, kernel->length);
+                __atomic_store_n(&kernel->func, NULL, __ATOMIC_RELEASE);
+                kernel->length = 0;
+            }
+        }
+    }
+    pthread_mutex_unlock(&jit_lock);
+}
@@ -0,0 +1,252 @@
+#include "dot_utils.h"
+#include "dot.h"
+
+/*
+    Modular addition and subtraction for a fixed modulus, on n-limb arrays whose operands are already
+    reduced. The top limbs of a, b and m nearly always tell whether a + b reaches m, and then dot_addmod
+    makes a single pass: a + b alone, or a + b - m with each chunk of a + b going into the subtraction
+    straight from its register. When they do not, both candidates are computed in that same pass and the
+    final carry and borrow select one with a masked blend. dot_submod does the same with a - b and
+    a - b + m.
+
+    Pseudo-Mersenne moduli p = 2^k - c need no second operand at all: a + b is at least p exactly when
+    a + b + c reaches bit k, and adding c only ripples past the lowest limb when that limb is nearly all
+    ones. dot_addmod_pm and dot_submod_pm fold the reduction into one scalar pass over the lowest limbs.
+*/
+
+#define DOT_MOD_STACK_LIMBS 64 // Longest candidate kept on the stack, longer ones go to the scratch arena
+
+/*
+    The carry logic of __ADD_N_K and __SUB_N_K on operands already in registers, so that a chunk of a + b
+    feeds the subtraction of m without a store and reload. Lanes outside k are zero in both operands and
+    are cleared from the result, so no carry or borrow leaks from them into the next step.
+*/
+static inline __m512i __add_vec(__m512i a_vec, __m512i b_vec, __mmask16 c_in, __mmask16 *c_out, __mmask8 k,
+                                unsigned top)
+{
+    __m512i result_vec = _mm512_add_epi64(a_vec, b_vec);
+    __mmask16 c_mask = _mm512_cmplt_epu64_mask(result_vec, a_vec);
+    *c_out = c_mask >> top;
+    c_mask <<= 1;
+    c_mask = _mm512_kor(c_mask, c_in);
+    __m512i result_vec_new = _mm512_mask_sub_epi64(result_vec, c_mask, result_vec, AVX512_MASK);
+    c_mask = _mm512_cmplt_epu64_mask(result_vec_new, result_vec);
+    result_vec = result_vec_new;
+    if (unlikely(_mm512_mask2int(c_mask)))
+    {
+        DOT_STAT_ADD(slow_path[DOT_STATS_ADD], 1);
+        c_mask <<= 1;
+        __mmask16 m = _mm512_mask_cmpeq_epi64_mask(k, result_vec, AVX512_MASK);
+        c_mask = c_mask + m;
+        *c_out = _mm512_kor(*c_out, (c_mask >> (top + 1)));
+        m = _mm512_kxor(c_mask, m);
+        result_vec = _mm512_mask_sub_epi64(result_vec, m, result_vec, AVX512_MASK);
+    }
+    return _mm512_maskz_mov_epi64(k, result_vec);
+}
+
+static inline __m512i __sub_vec(__m512i a_vec, __m512i b_vec, __mmask16 b_in, __mmask16 *b_out, __mmask8 k,
+                                unsigned top)
+{
+    __m512i result_vec = _mm512_sub_epi64(a_vec, b_vec);
+    __mmask16 b_mask = _mm512_cmpgt_epu64_mask(b_vec, a_vec);
+    *b_out = b_mask >> top;
+    b_mask <<= 1;
+    b_mask = _mm512_kor(b_mask, b_in);
+    __m512i result_vec_new = _mm512_mask_add_epi64(result_vec, b_mask, result_vec, AVX512_MASK);
+    b_mask = _mm512_cmpgt_epu64_mask(result_vec_new, result_vec);
+    result_vec = result_vec_new;
+    if (unlikely(_mm512_mask2int(b_mask)))
+    {
+        DOT_STAT_ADD(slow_path[DOT_STATS_SUB], 1);
+        b_mask <<= 1;
+        __mmask16 m = _mm512_mask_cmpeq_epu64_mask(k, result_vec, AVX512_ZEROS);
+        b_mask = b_mask + m;
+        *b_out = _mm512_kor(*b_out, (b_mask >> (top + 1)));
+        m = _mm512_kxor(b_mask, m);
+        result_vec = _mm512_mask_add_epi64(result_vec, m, result_vec, AVX512_MASK);
+    }
+    return _mm512_maskz_mov_epi64(k, result_vec);
+}
+
+// Function to copy the whole chunks of alt over result when pick is set, with the same loads and stores either way
+static inline void __select(uint64_t *result, const uint64_t *alt, size_t n, __mmask8 pick)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m512i r_vec = _mm512_loadu_si512((__m512i *)(result + i));
+        __m512i t_vec = _mm512_loadu_si512((__m512i *)(alt + i));
+        _mm512_storeu_si512((__m512i *)(result + i), _mm512_mask_blend_epi64(pick, r_vec, t_vec));
+    }
+}
+
+/*
+    Which candidate the top limbs decide: 0 for x = a op b, 1 for y = x op' m, -1 when it takes the lower
+    limbs too. With B = 2^(64(n-1)) the low limbs of a + b add less than 2B, so a + b < m when the top limbs
+    sum to at most m_top - 2 and a + b >= m when they sum to more than m_top; a - b has the sign of
+    a_top - b_top unless they are equal.
+*/
+static inline int __mod_side(uint64_t a_top, uint64_t b_top, uint64_t m_top, bool add)
+{
+    if (add)
+    {
+        unsigned __int128 sum = (unsigned __int128)a_top + b_top;
+        return sum + 2 <= m_top ? 0 : (sum > m_top ? 1 : -1);
+    }
+    return a_top > b_top ? 0 : (a_top < b_top ? 1 : -1);
+}
+
+/*
+    Shared loop of dot_addmod and dot_submod: x = a op b, y = x op' m. When the top limbs settle the result
+    only x is computed, or y in one pass with x kept in registers. Otherwise every chunk but the last stores
+    x to result and y to a candidate buffer, the last chunk is blended in registers once the final carry and
+    borrow are known, and the earlier chunks are blended after it.
+*/
+static inline void __mod_n(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n,
+                           bool add)
+{
+    if (unlikely(n == 0))
+    {
+        return;
+    }
+    // A single chunk holds both candidates in registers, blending them is cheaper than a mispredicted branch
+    int side = n <= 8 ? -1 : __mod_side(a[n - 1], b[n - 1], m[n - 1], add);
+    if (side == 0)
+    {
+        add ? __dot_add_nc(result, a, b, n, 0) : __dot_sub_nc(result, a, b, n, 0);
+        return;
+    }
+
+    bool both = side < 0;
+    uint64_t stack[DOT_MOD_STACK_LIMBS];
+    uint64_t *t = stack;
+    dot_arena_t *scratch = NULL;
+    dot_arena_mark_t mark = {0};
+    if (unlikely(both && n > DOT_MOD_STACK_LIMBS + 8))
+    {
+        scratch = dot_scratch_arena();
+        mark = dot_arena_mark(scratch);
+        t = (uint64_t *)dot_arena_alloc(scratch, n * sizeof(uint64_t));
+    }
+
+    __mmask16 c = 0, bw = 0;
+    size_t i;
+    for (i = 0; i + 8 < n; i += 8)
+    {
+        __m512i a_vec = _mm512_loadu_si512((__m512i *)(a + i));
+        __m512i b_vec = _mm512_loadu_si512((__m512i *)(b + i));
+        __m512i m_vec = _mm512_loadu_si512((__m512i *)(m + i));
+        __m512i x_vec, y_vec;
+        if (add)
+        {
+            x_vec = __add_vec(a_vec, b_vec, c, &c, 0xFF, 7);
+            y_vec = __sub_vec(x_vec, m_vec, bw, &bw, 0xFF, 7);
+        }
+        else
+        {
+            x_vec = __sub_vec(a_vec, b_vec, bw, &bw, 0xFF, 7);
+            y_vec = __add_vec(x_vec, m_vec, c, &c, 0xFF, 7);
+        }
+        if (likely(!both))
+        {
+            _mm512_storeu_si512((__m512i *)(result + i), y_vec);
+        }
+        else
+        {
+            _mm512_storeu_si512((__m512i *)(result + i), x_vec);
+            _mm512_storeu_si512((__m512i *)(t + i), y_vec);
+        }
+    }
+
+    // The last 1 to 8 limbs
+    unsigned top = (unsigned)(n - i - 1);
+    __mmask8 k = (__mmask8)((2U << top) - 1);
+    __m512i a_vec = _mm512_maskz_loadu_epi64(k, a + i);
+    __m512i b_vec = _mm512_maskz_loadu_epi64(k, b + i);
+    __m512i m_vec = _mm512_maskz_loadu_epi64(k, m + i);
+    __m512i x_vec, y_vec;
+    bool take;
+    if (add)
+    {
+        x_vec = __add_vec(a_vec, b_vec, c, &c, k, top);
+        y_vec = __sub_vec(x_vec, m_vec, bw, &bw, k, top);
+        // a + b - m is the result unless it borrowed while a + b fit in n limbs
+        take = (c != 0) | (bw == 0);
+    }
+    else
+    {
+        x_vec = __sub_vec(a_vec, b_vec, bw, &bw, k, top);
+        y_vec = __add_vec(x_vec, m_vec, c, &c, k, top);
+        // a - b + m is the result when a - b went below zero
+        take = bw != 0;
+    }
+    __mmask8 pick = (__mmask8)(0 - (unsigned)(take | !both));
+    _mm512_mask_storeu_epi64(result + i, k, _mm512_mask_blend_epi64(pick, x_vec, y_vec));
+    if (both)
+    {
+        __select(result, t, i, pick);
+    }
+
+    if (scratch != NULL)
+    {
+        dot_arena_release(scratch, mark);
+    }
+}
+
+void dot_addmod(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n)
+{
+    __mod_n(result, a, b, m, n, true);
+}
+
+void dot_submod(uint64_t *result, const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n)
+{
+    __mod_n(result, a, b, m, n, false);
+}
+
+void dot_addmod_pm(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, unsigned k, uint64_t c)
+{
+    const unsigned top_bits = k - 64 * (unsigned)(n - 1); // Bits of p in the top limb, 1 to 64
+    uint64_t over = __dot_add_nc(result, a, b, n, 0);
+
+    // Add c, the carry almost always stops in the lowest limb
+    uint64_t carry = c;
+    for (size_t i = 0; carry != 0 && i < n; i++)
+    {
+        result[i] += carry;
+        carry = result[i] < carry;
+    }
+    over |= carry;
+    if (top_bits < 64)
+    {
+        // a + b + c < 2^(k+1), so bit k is the only one that can be set above p
+        over |= result[n - 1] >> top_bits;
+        result[n - 1] &= (1ULL << top_bits) - 1;
+    }
+
+    // a + b + c - 2^k = a + b - p when a + b >= p, otherwise take c back out
+    uint64_t borrow = over ? 0 : c;
+    for (size_t i = 0; borrow != 0 && i < n; i++)
+    {
+        uint64_t limb = result[i];
+        result[i] = limb - borrow;
+        borrow = limb < borrow;
+    }
+}
+
+void dot_submod_pm(uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n, unsigned k, uint64_t c)
+{
+    const unsigned top_bits = k - 64 * (unsigned)(n - 1);
+
+    // Below zero a - b holds a - b + 2^(64n), adding p to it is subtracting c modulo 2^k
+    uint64_t borrow = __dot_sub_nc(result, a, b, n, 0) ? c : 0;
+    for (size_t i = 0; borrow != 0 && i < n; i++)
+    {
+        uint64_t limb = result[i];
+        result[i] = limb - borrow;
+        borrow = limb < borrow;
+    }
+    if (top_bits < 64)
+    {
+        result[n - 1] &= (1ULL << top_bits) - 1;
+    }
+}
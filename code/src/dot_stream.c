@@ -0,0 +1,35 @@
+#include "dot_utils.h"
+#include "dot.h"
+
+/*
+    Streaming add/sub. The only state carried between chunks is the carry or borrow, so a number can be
+    processed in pieces of any size as they are read from disk or a decompressor, with no limit on its
+    total length. Every chunk goes straight to dot_add_nc/dot_sub_nc.
+*/
+
+void dot_stream_init(dot_stream_t *stream, dot_stream_op_t op)
+{
+    stream->op = op;
+    stream->carry = 0;
+    stream->limbs = 0;
+}
+
+void dot_stream_update(dot_stream_t *stream, uint64_t *result, const uint64_t *a, const uint64_t *b, size_t n)
+{
+    if (stream->op == DOT_STREAM_ADD)
+    {
+        stream->carry = dot_add_nc(result, a, b, n, stream->carry);
+    }
+    else
+    {
+        stream->carry = dot_sub_nc(result, a, b, n, stream->carry);
+    }
+    stream->limbs += n;
+}
+
+uint64_t dot_stream_finish(dot_stream_t *stream)
+{
+    uint64_t carry = stream->carry;
+    dot_stream_init(stream, stream->op);
+    return carry;
+}
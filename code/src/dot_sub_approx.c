@@ -1,13 +1,6 @@
 #include "dot_utils.h"
 #include "dot.h"
 
-extern __m512i AVX512_ZEROS; // AVX512 vector of zeros
-extern __m256i AVX256_ZEROS; // AVX256 vector of zeros
-extern __m128i AVX128_ZEROS; // AVX128 vector of zeros
-extern __m512i AVX512_MASK;  // AVX512 vector of 64-bit mask
-extern __m256i AVX256_MASK;  // AVX256 vector of 64-bit mask
-extern __m128i AVX128_MASK;  // AVX128 vector of 64-bit mask
-
 void dot_sub_approx_256(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
 {
     // swap a and b if a < b
@@ -34,19 +27,25 @@ void dot_sub_approx_256(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
     }
     else if (cmp == 0)
     {
-        result->size = 1;
-        result->dot_limbs[0] = 0;
+        result->sign = 0;
+        __set_used(result, 0);
         return;
     }
+    else
+    {
+        result->sign = 0;
+    }
     __SUB_N_4_APPROX((result->dot_limbs), (a->dot_limbs), (b->dot_limbs));
+    __set_used(result, __normalize(result->dot_limbs, result->size < 4 ? result->size : 4));
 }
 
 void __sub_n_approx(dot_limb_t *result, dot_limb_t *x, dot_limb_t *y)
 {
-    int n = x->size;
+    size_t n = __used_max(x, y);
     // swap x and y if x < y
     int cmp = 0;
-    for (int i = n - 1; i >= 0; --i)
+    size_t i;
+    for (i = n; i-- > 0;)
     {
         if (x->dot_limbs[i] > y->dot_limbs[i])
         {
@@ -68,26 +67,36 @@ void __sub_n_approx(dot_limb_t *result, dot_limb_t *x, dot_limb_t *y)
     }
     else if (cmp == 0)
     {
-        result->size = 1;
-        result->dot_limbs[0] = 0;
+        result->sign = 0;
+        __set_used(result, 0);
         return;
     }
+    else
+    {
+        result->sign = 0;
+    }
+
+    // The limbs above the highest difference are equal and cancel out
+    n = i + 1;
 
     uint64_t *res_ptr = result->dot_limbs;
     uint64_t *x_ptr = x->dot_limbs;
     uint64_t *y_ptr = y->dot_limbs;
 
     __mmask16 b_in = 0, b_out = 0;
-    for (int i = 0; i < n; i += 8)
+    for (i = 0; i < n; i += 8)
     {
         __SUB_N_8_APPROX((res_ptr + i), (x_ptr + i), (y_ptr + i), b_in, b_out);
         b_in = b_out;
     }
+    __set_used(result, __normalize(res_ptr, i < result->size ? i : result->size));
 }
 
 void dot_sub_n_approx(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
 {
-    int n = a->size;
+    size_t n = __used_max(a, b);
+    DOT_STAT_ADD(calls[DOT_STATS_SUB_APPROX], 1);
+    DOT_STAT_ADD(limbs[DOT_STATS_SUB_APPROX], n);
 
     if (n <= 4)
     {
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "vectors.h"
+
+#define CHUNK 655360 // Chunk size for reading the file
+
+/*
+    Converts the generated ./cases/<op>/<bits>/<type>.csv.gz files into the binary vectors read by
+    test_vectors.c, next to them as <type>.dotv. The hex is parsed here, independently of libdot, so the
+    vectors do not depend on the library they test.
+*/
+
+// Function to parse hex into limbs, least significant first, returns false if it needs more than limbs
+static bool parse_hex(const char *str, size_t len, uint64_t *limbs, size_t n)
+{
+    memset(limbs, 0, n * sizeof(uint64_t));
+    size_t digit = 0;
+    for (size_t i = len; i-- > 0; digit++)
+    {
+        int c = tolower((unsigned char)str[i]);
+        if (!isxdigit(c))
+        {
+            return false;
+        }
+        uint64_t v = isdigit(c) ? (uint64_t)(c - '0') : (uint64_t)(c - 'a' + 10);
+        if (v == 0)
+        {
+            continue;
+        }
+        if (digit / 16 >= n)
+        {
+            return false;
+        }
+        limbs[digit / 16] |= v << (4 * (digit % 16));
+    }
+    return true;
+}
+
+// Function to get the next comma-separated field of a line, with surrounding whitespace removed
+static char *next_field(char **cursor, size_t *len)
+{
+    char *start = *cursor;
+    if (start == NULL)
+    {
+        return NULL;
+    }
+    char *end = strchr(start, ',');
+    *cursor = end != NULL ? end + 1 : NULL;
+    end = end != NULL ? end : start + strlen(start);
+    while (start < end && isspace((unsigned char)*start))
+    {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)end[-1]))
+    {
+        end--;
+    }
+    *len = end - start;
+    return start;
+}
+
+void convert(int op, int NUM_BITS, int case_type, bool compress)
+{
+    const char *file_type = (case_type == 0) ? "random" : "special";
+    char csv_filename[100], vector_filename[100];
+    snprintf(csv_filename, sizeof(csv_filename), "./cases/%s/%d/%s.csv.gz", op ? "sub" : "add", NUM_BITS, file_type);
+    dotv_filename(vector_filename, sizeof(vector_filename), op, NUM_BITS, case_type);
+
+    gzFile in = gzopen(csv_filename, "rb");
+    if (in == NULL)
+    {
+        fprintf(stderr, "Error opening file %s: %s\n", csv_filename, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // Level 6 keeps conversion quick, transparent mode stores the records as-is
+    gzFile out = gzopen(vector_filename, compress ? "wb6" : "wbT");
+    if (out == NULL)
+    {
+        fprintf(stderr, "Error opening file %s: %s\n", vector_filename, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    dotv_header_t header = {DOTV_MAGIC, DOTV_VERSION, (uint32_t)op, (uint32_t)NUM_BITS, (NUM_BITS + 63) / 64, 0};
+    size_t n = header.limbs;
+    size_t record_limbs = dotv_record_limbs(n);
+    uint64_t *record = (uint64_t *)malloc(record_limbs * sizeof(uint64_t));
+    char *buffer = (char *)malloc(CHUNK);
+    if (record == NULL || buffer == NULL)
+    {
+        perror("Memory allocation failed for the conversion buffers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The count is only known at the end, a compressed stream cannot be patched, so count first
+    if (gzgets(in, buffer, CHUNK) == NULL)
+    {
+        fprintf(stderr, "Error reading header line of %s\n", csv_filename);
+        exit(EXIT_FAILURE);
+    }
+    while (gzgets(in, buffer, CHUNK) != NULL)
+    {
+        header.count++;
+    }
+    gzrewind(in);
+    gzgets(in, buffer, CHUNK);
+    if (gzwrite(out, &header, sizeof(header)) != (int)sizeof(header))
+    {
+        fprintf(stderr, "Error writing file %s\n", vector_filename);
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint64_t i = 0; i < header.count; i++)
+    {
+        if (gzgets(in, buffer, CHUNK) == NULL)
+        {
+            fprintf(stderr, "Error reading line %lu of %s\n", (unsigned long)i, csv_filename);
+            exit(EXIT_FAILURE);
+        }
+        char *cursor = buffer;
+        size_t a_len, b_len, r_len;
+        char *a_str = next_field(&cursor, &a_len);
+        char *b_str = next_field(&cursor, &b_len);
+        char *r_str = next_field(&cursor, &r_len);
+        if (a_str == NULL || b_str == NULL || r_str == NULL)
+        {
+            fprintf(stderr, "Error parsing line %lu of %s\n", (unsigned long)i, csv_filename);
+            exit(EXIT_FAILURE);
+        }
+
+        uint64_t flags = 0;
+        if (r_len > 0 && r_str[0] == '-')
+        {
+            flags |= DOTV_NEGATIVE;
+            r_str++;
+            r_len--;
+        }
+        if (!parse_hex(a_str, a_len, dotv_a(record, n), n) || !parse_hex(b_str, b_len, dotv_b(record, n), n) ||
+            !parse_hex(r_str, r_len, dotv_result(record, n), n + 1))
+        {
+            fprintf(stderr, "Error parsing line %lu of %s: operand wider than %d bits\n", (unsigned long)i,
+                    csv_filename, NUM_BITS);
+            exit(EXIT_FAILURE);
+        }
+        *dotv_flags(record, n) = flags;
+
+        if (gzwrite(out, record, record_limbs * sizeof(uint64_t)) != (int)(record_limbs * sizeof(uint64_t)))
+        {
+            fprintf(stderr, "Error writing file %s\n", vector_filename);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    gzclose(in);
+    if (gzclose(out) != Z_OK)
+    {
+        fprintf(stderr, "Error closing file %s\n", vector_filename);
+        exit(EXIT_FAILURE);
+    }
+    free(record);
+    free(buffer);
+    printf("Converted %lu cases from %s to %s\n", (unsigned long)header.count, csv_filename, vector_filename);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4 && argc != 5)
+    {
+        fprintf(stderr, "Usage: %s <operation> <number_of_bits> <case_type> [compress]\n", argv[0]);
+        fprintf(stderr, "operation: 0 for addition, 1 for subtraction\n");
+        fprintf(stderr, "number_of_bits: number of bits for the test cases\n");
+        fprintf(stderr, "case_type: 0 for random test cases, 1 for special test cases\n");
+        fprintf(stderr, "compress: 1 for zlib-compressed vectors (default), 0 for uncompressed\n");
+        fprintf(stderr, "Example: %s 1 512 0\n", argv[0]);
+        fprintf(stderr, "This converts ./cases/sub/512/random.csv.gz into ./cases/sub/512/random.dotv\n");
+        return EXIT_FAILURE;
+    }
+
+    int op = atoi(argv[1]);
+    int NUM_BITS = atoi(argv[2]);
+    int case_type = atoi(argv[3]);
+    bool compress = argc == 4 || atoi(argv[4]) != 0;
+
+    assert(op == 0 || op == 1);
+    assert(NUM_BITS > 0 && NUM_BITS <= 131072);
+    assert(case_type == 0 || case_type == 1);
+
+    convert(op, NUM_BITS, case_type, compress);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1049 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <gmp.h>
+
+#include "dotlib.h"
+
+/*
+    Differential fuzzer for the exact kernels.
+
+    Operands are generated in-process and every result is checked against GMP's mpn routines. The generators
+    aim at what the kernels are built around: long runs of all-ones and all-zeros limbs that make a carry or
+    borrow ripple across lanes and blocks, alternating saturated limbs, edge values (all ones plus one, equal
+    operands, off by one), high zero limbs that exercise the used counts, and lengths with n % 8 != 0 so the
+    masked tail runs. Each case is derived from a 64-bit case seed alone, so a failure is replayed with -R and
+    is minimised (fewer limbs, limbs pushed to 0 or all ones) before it is reported.
+
+    The modular operations draw their modulus from the case as well and reduce the operands below it first.
+    dot_eval cases draw the shape of their expression and a third, shorter operand from it, and are checked
+    with mpz arithmetic. Some nodes double the one before, so coefficients grow far beyond the node count.
+
+    The approximate kernels may differ from exact results by design and are not checked here.
+*/
+
+#define DEFAULT_MAX_LIMBS 256    // Largest operand, in limbs
+#define PROGRESS_SECONDS 10      // Interval between progress lines
+#define GUARD 0xA5A5A5A5A5A5A5A5ULL // Pattern around and inside outputs, to catch missing or stray writes
+#define EVAL_MAX_NODES 40           // Largest expression of a dot_eval case, doublings make coefficients up to 2^37
+
+typedef enum
+{
+    FUZZ_ADD_N = 0,   // dot_add_n into n limbs, the carry in the flag
+    FUZZ_SUB_N,       // dot_sub_n, magnitude and sign
+    FUZZ_ADD_NC,      // dot_add_nc with a carry in
+    FUZZ_SUB_NC,      // dot_sub_nc with a borrow in
+    FUZZ_STREAM_ADD,  // dot_stream_* over random chunks
+    FUZZ_STREAM_SUB,  // dot_stream_* over random chunks
+    FUZZ_ADD_ALIAS,   // dot_add_n with the result aliasing a
+    FUZZ_SUB_ALIAS,   // dot_sub_n with the result aliasing a
+    FUZZ_ADDMOD,      // dot_addmod, operands reduced modulo a modulus drawn from the case
+    FUZZ_SUBMOD,      // dot_submod
+    FUZZ_ADDMOD_PM,   // dot_addmod_pm, modulo 2^k - c
+    FUZZ_SUBMOD_PM,   // dot_submod_pm
+    FUZZ_ADD_N_CT,    // dot_add_n_ct, checked like dot_add_n
+    FUZZ_SUB_N_CT,    // dot_sub_n_ct, checked like dot_sub_n
+    FUZZ_ADD_NC_CT,   // dot_add_nc_ct, checked like dot_add_nc
+    FUZZ_SUB_NC_CT,   // dot_sub_nc_ct, checked like dot_sub_nc
+    FUZZ_EVAL,        // dot_eval of a random expression over a, b and a third operand
+    FUZZ_ADD_JIT,     // dot_jit_get(DOT_JIT_ADD, n), checked like dot_add_n
+    FUZZ_SUB_JIT,     // dot_jit_get(DOT_JIT_SUB, n), checked like dot_sub_n
+    NUM_FUZZ_OPS,
+} fuzz_op_t;
+
+static const char *FUZZ_OP_NAMES[NUM_FUZZ_OPS] = {
+    "dot_add_n", "dot_sub_n", "dot_add_nc", "dot_sub_nc",
+    "dot_stream(add)", "dot_stream(sub)", "dot_add_n(alias)", "dot_sub_n(alias)",
+    "dot_addmod", "dot_submod", "dot_addmod_pm", "dot_submod_pm",
+    "dot_add_n_ct", "dot_sub_n_ct", "dot_add_nc_ct", "dot_sub_nc_ct",
+    "dot_eval", "dot_jit(add)", "dot_jit(sub)",
+};
+
+typedef enum
+{
+    GEN_RANDOM = 0,  // Uniform limbs
+    GEN_RUNS,        // Runs of saturated, zero and random limb pairs
+    GEN_ALTERNATING, // Alternating all-ones and zero limbs
+    GEN_EDGE,        // All ones plus one, equal operands, off by one
+    NUM_GENS,
+} fuzz_gen_t;
+
+typedef struct
+{
+    fuzz_op_t op;
+    size_t n;         // Limbs of each operand
+    bool wide;        // The result of dot_add_n/dot_sub_n has a spare limb
+    uint64_t carry;   // Carry or borrow in of the nc operations
+    uint64_t chunks;  // Seed of the stream chunking, of the modulus and of the dot_eval expression
+    uint64_t *a, *b;  // n limbs each
+} fuzz_case_t;
+
+typedef struct
+{
+    int threads;
+    double seconds;
+    uint64_t cases;
+    size_t max_limbs;
+    uint64_t seed;
+    bool keep_going;
+} fuzz_config_t;
+
+static fuzz_config_t config = {.threads = 1, .max_limbs = DEFAULT_MAX_LIMBS, .seed = 1};
+static atomic_uint_fast64_t total_cases;
+static atomic_uint_fast64_t total_failures;
+static atomic_bool stop;
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Function to mix a 64-bit value (splitmix64), used to derive case seeds
+static inline uint64_t mix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Function to get the next pseudo-random value of a generator state
+static inline uint64_t next(uint64_t *state)
+{
+    *state += 0x9E3779B97F4A7C15ULL;
+    return mix64(*state);
+}
+
+// Function to pick a saturated, zero, small or random limb
+static uint64_t special_limb(uint64_t *state)
+{
+    switch (next(state) % 6)
+    {
+    case 0:
+        return ~0ULL;
+    case 1:
+        return 0;
+    case 2:
+        return 1;
+    case 3:
+        return ~0ULL - 1;
+    case 4:
+        return 1ULL << 63;
+    default:
+        return next(state);
+    }
+}
+
+// Function to fill a and b with runs of limb pairs that generate, propagate or kill a carry or borrow
+static void gen_runs(uint64_t *state, uint64_t *a, uint64_t *b, size_t n)
+{
+    static const uint64_t pairs[][2] = {
+        {~0ULL, 0}, {0, ~0ULL}, {~0ULL, ~0ULL}, {0, 0}, {~0ULL, 1}, {0, 1}, {1, 0},
+    };
+    size_t i = 0;
+    while (i < n)
+    {
+        // Mostly long runs, the carry chains they build are what the slow paths handle
+        size_t span = next(state) % 4 == 0 ? n : 9;
+        size_t run = 1 + next(state) % span;
+        uint64_t kind = next(state) % 9;
+        for (size_t j = 0; j < run && i < n; j++, i++)
+        {
+            if (kind < 7)
+            {
+                a[i] = pairs[kind][0];
+                b[i] = pairs[kind][1];
+            }
+            else if (kind == 7)
+            {
+                a[i] = special_limb(state);
+                b[i] = special_limb(state);
+            }
+            else
+            {
+                a[i] = next(state);
+                b[i] = next(state);
+            }
+        }
+    }
+}
+
+// Function to fill a and b with alternating saturated limbs
+static void gen_alternating(uint64_t *state, uint64_t *a, uint64_t *b, size_t n)
+{
+    uint64_t phase = next(state) & 1, variant = next(state) % 4;
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = ((i + phase) & 1) ? ~0ULL : 0;
+        switch (variant)
+        {
+        case 0:
+            b[i] = ~a[i];
+            break;
+        case 1:
+            b[i] = a[i];
+            break;
+        case 2:
+            b[i] = ((i + phase) & 1) ? 1 : ~0ULL;
+            break;
+        default:
+            b[i] = next(state);
+            break;
+        }
+    }
+    if (variant == 0 && n > 0)
+    {
+        // a + ~a is all ones, a carry in the lowest limb then ripples through every limb
+        b[0] += 1;
+    }
+}
+
+// Function to fill a and b with edge values
+static void gen_edge(uint64_t *state, uint64_t *a, uint64_t *b, size_t n)
+{
+    switch (next(state) % 5)
+    {
+    case 0: // All ones and one
+        memset(a, 0xff, n * sizeof(uint64_t));
+        memset(b, 0, n * sizeof(uint64_t));
+        b[0] = 1;
+        break;
+    case 1: // Equal operands
+        for (size_t i = 0; i < n; i++)
+        {
+            a[i] = b[i] = special_limb(state);
+        }
+        break;
+    case 2: // Off by one in the lowest limb, the borrow ripples up when it wraps
+        for (size_t i = 0; i < n; i++)
+        {
+            a[i] = b[i] = next(state);
+        }
+        b[0] = a[0] + 1;
+        break;
+    case 3: // Zero and all ones
+        memset(a, 0, n * sizeof(uint64_t));
+        memset(b, 0xff, n * sizeof(uint64_t));
+        break;
+    default: // Power of two and one
+        memset(a, 0, n * sizeof(uint64_t));
+        memset(b, 0, n * sizeof(uint64_t));
+        a[n - 1] = 1ULL << (next(state) & 63);
+        b[0] = 1;
+        break;
+    }
+}
+
+static bool is_modular(fuzz_op_t op)
+{
+    return op >= FUZZ_ADDMOD && op <= FUZZ_SUBMOD_PM;
+}
+
+/*
+    Draws the n-limb modulus of a modular case from its chunks seed, so it follows the case when minimising
+    shortens it. Pseudo-Mersenne moduli set k and c, the others are random with a top limb that is either
+    full, so a + b overflows n limbs, or small, or all ones.
+*/
+static void make_modulus(const fuzz_case_t *c, uint64_t *m, unsigned *k, uint64_t *pm_c)
+{
+    uint64_t state = c->chunks;
+    size_t n = c->n;
+    if (c->op == FUZZ_ADDMOD_PM || c->op == FUZZ_SUBMOD_PM)
+    {
+        unsigned top_bits = 1 + next(&state) % 64;
+        *k = 64 * (unsigned)(n - 1) + top_bits;
+        uint64_t c_max = *k > 32 ? 1ULL << 32 : (1ULL << *k) - 1;
+        *pm_c = 1 + next(&state) % c_max;
+        // 2^k - 1, then less c - 1
+        for (size_t i = 0; i < n; i++)
+        {
+            m[i] = ~0ULL;
+        }
+        m[n - 1] = top_bits == 64 ? ~0ULL : (1ULL << top_bits) - 1;
+        mpn_sub_1(m, m, n, *pm_c - 1);
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        m[i] = next(&state);
+    }
+    switch (next(&state) % 4)
+    {
+    case 0:
+        m[n - 1] |= 1ULL << 63;
+        break;
+    case 1:
+        m[n - 1] &= 0xFF;
+        break;
+    case 2:
+        memset(m, 0xFF, n * sizeof(uint64_t));
+        break;
+    }
+    m[n - 1] |= m[n - 1] == 0;
+}
+
+// Function to reduce the n limbs of x modulo m, whose top limb is not zero
+static void reduce_mod(uint64_t *x, const uint64_t *m, size_t n)
+{
+    if (mpn_cmp(x, m, n) < 0)
+    {
+        return;
+    }
+    mp_limb_t q[1], *r = (mp_limb_t *)malloc(n * sizeof(mp_limb_t));
+    if (r == NULL)
+    {
+        perror("Memory allocation failed for the remainder\n");
+        exit(EXIT_FAILURE);
+    }
+    mpn_tdiv_qr(q, r, 0, x, n, m, n);
+    memcpy(x, r, n * sizeof(uint64_t));
+    free(r);
+}
+
+// Function to generate the case of a case seed, a and b must hold max_limbs limbs
+static void generate_case(uint64_t case_seed, fuzz_case_t *c, size_t max_limbs)
+{
+    uint64_t state = case_seed;
+    c->op = (fuzz_op_t)(next(&state) % NUM_FUZZ_OPS);
+
+    // Half of the lengths leave a masked tail of 1 to 7 limbs
+    if (next(&state) & 1)
+    {
+        size_t blocks = next(&state) % (max_limbs / 8 + 1);
+        c->n = blocks * 8 + 1 + next(&state) % 7;
+    }
+    else
+    {
+        c->n = 1 + next(&state) % max_limbs;
+    }
+    c->n = c->n > max_limbs ? max_limbs : c->n;
+    c->wide = next(&state) & 1;
+    c->carry = next(&state) & 1;
+    c->chunks = next(&state);
+
+    switch ((fuzz_gen_t)(next(&state) % NUM_GENS))
+    {
+    case GEN_RANDOM:
+        for (size_t i = 0; i < c->n; i++)
+        {
+            c->a[i] = next(&state);
+            c->b[i] = next(&state);
+        }
+        break;
+    case GEN_RUNS:
+        gen_runs(&state, c->a, c->b, c->n);
+        break;
+    case GEN_ALTERNATING:
+        gen_alternating(&state, c->a, c->b, c->n);
+        break;
+    default:
+        gen_edge(&state, c->a, c->b, c->n);
+        break;
+    }
+
+    // A quarter of the cases clear high limbs of one operand, so the used counts differ from the sizes
+    if (next(&state) % 4 == 0)
+    {
+        uint64_t *x = (next(&state) & 1) ? c->a : c->b;
+        size_t zeros = next(&state) % (c->n + 1);
+        memset(x + c->n - zeros, 0, zeros * sizeof(uint64_t));
+    }
+
+    // Modular operations take reduced operands, the generated patterns survive whenever they are below m
+    if (is_modular(c->op))
+    {
+        uint64_t *m = (uint64_t *)malloc(c->n * sizeof(uint64_t));
+        unsigned k;
+        uint64_t pm_c;
+        if (m == NULL)
+        {
+            perror("Memory allocation failed for the modulus\n");
+            exit(EXIT_FAILURE);
+        }
+        make_modulus(c, m, &k, &pm_c);
+        reduce_mod(c->a, m, c->n);
+        reduce_mod(c->b, m, c->n);
+        // A quarter of them put a + b or a - b within a few units of m, where the correction flips
+        if (next(&state) % 4 == 0 && (c->n > 1 || m[0] > 8))
+        {
+            mpn_sub_1(c->a, m, c->n, 1 + next(&state) % 4);
+            if (c->op == FUZZ_SUBMOD || c->op == FUZZ_SUBMOD_PM)
+            {
+                mpn_sub_1(c->b, m, c->n, 1 + next(&state) % 4);
+            }
+            else
+            {
+                memset(c->b, 0, c->n * sizeof(uint64_t));
+                c->b[0] = next(&state) % 8;
+            }
+        }
+        free(m);
+    }
+}
+
+// Function to check the used count and the zero limbs above it
+static bool check_used(const dot_limb_t *r, char *why, size_t why_len)
+{
+    size_t used = r->size;
+    while (used > 0 && r->dot_limbs[used - 1] == 0)
+    {
+        used--;
+    }
+    if (r->carry ? r->used != r->size : r->used != used)
+    {
+        snprintf(why, why_len, "used is %zu, expected %zu", r->used, r->carry ? r->size : used);
+        return false;
+    }
+    return true;
+}
+
+// Function to compare n limbs, describing the first difference
+static bool check_limbs(const uint64_t *got, const uint64_t *expected, size_t n, char *why, size_t why_len)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (got[i] != expected[i])
+        {
+            snprintf(why, why_len, "limb %zu is %016lx, expected %016lx", i, got[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to run a dot_eval case into R, e must hold R->size limbs
+static bool run_eval(const fuzz_case_t *c, dot_limb_t *A, dot_limb_t *B, dot_limb_t *R, uint64_t *e, char *why, size_t why_len)
+{
+    size_t n = c->n;
+    uint64_t state = c->chunks;
+    uint64_t *x = (uint64_t *)calloc(n, sizeof(uint64_t));
+    if (x == NULL)
+    {
+        perror("Memory allocation failed for the third operand\n");
+        exit(EXIT_FAILURE);
+    }
+    // Shorter than a and b, with saturated limbs to make carries ripple, or all ones over n limbs when the
+    // expression is pushed past what n limbs hold below
+    bool saturate = next(&state) % 4 == 0;
+    size_t xn = saturate ? n : 1 + next(&state) % n;
+    for (size_t i = 0; i < xn; i++)
+    {
+        x[i] = saturate || next(&state) % 3 == 0 ? ~0ULL : next(&state);
+    }
+    dot_limb_t X;
+    dot_limb_init_buffer(&X, x, n);
+    dot_limb_normalize(&X);
+
+    // The operands first, then random sums and differences of earlier nodes, now and then a repeated leaf or a
+    // doubling of the previous node
+    const dot_limb_t *operands[] = {A, B, &X};
+    dot_expr_t expr;
+    dot_expr_init(&expr);
+    mpz_t value[EVAL_MAX_NODES];
+    size_t count = 0, nodes = 4 + next(&state) % (EVAL_MAX_NODES - 9);
+    for (; count < nodes; count++)
+    {
+        mpz_init(value[count]);
+        uint64_t pick = next(&state);
+        if (count < 3 || pick % 6 == 0)
+        {
+            const dot_limb_t *leaf = operands[count < 3 ? count : (pick >> 8) % 3];
+            dot_expr_leaf(&expr, leaf);
+            mpz_import(value[count], leaf->size, -1, sizeof(uint64_t), 0, 0, leaf->dot_limbs);
+            continue;
+        }
+        size_t left = (pick >> 8) % count, right = (pick >> 24) % count;
+        if (pick % 6 == 1)
+        {
+            left = right = count - 1;
+        }
+        if (pick & 1)
+        {
+            dot_expr_add(&expr, left, right);
+            mpz_add(value[count], value[left], value[right]);
+        }
+        else
+        {
+            dot_expr_sub(&expr, left, right);
+            mpz_sub(value[count], value[left], value[right]);
+        }
+    }
+    // A quarter of the expressions are negated as 0 - e with 0 = e - e, so every term may be subtracted
+    if (next(&state) % 4 == 0)
+    {
+        size_t root = count - 1;
+        mpz_init_set_ui(value[count], 0);
+        dot_expr_sub(&expr, root, root);
+        count++;
+        mpz_init(value[count]);
+        mpz_neg(value[count], value[root]);
+        dot_expr_sub(&expr, count - 1, root);
+        count++;
+    }
+    // Moved 4 X away from zero, the magnitude is at least 3 2^(64 n), so with R->size == n more than one
+    // 2^(64 n) is lost above the result and the carry flag only reports the overflow
+    if (saturate)
+    {
+        size_t root = count - 1;
+        bool negative = mpz_sgn(value[root]) < 0;
+        mpz_init(value[count]);
+        mpz_import(value[count], n, -1, sizeof(uint64_t), 0, 0, x);
+        dot_expr_leaf(&expr, &X);
+        count++;
+        for (int i = 0; i < 2; i++, count++)
+        {
+            mpz_init(value[count]);
+            mpz_add(value[count], value[count - 1], value[count - 1]);
+            dot_expr_add(&expr, count - 1, count - 1);
+        }
+        mpz_init(value[count]);
+        if (negative)
+        {
+            mpz_sub(value[count], value[root], value[count - 1]);
+            dot_expr_sub(&expr, root, count - 1);
+        }
+        else
+        {
+            mpz_add(value[count], value[root], value[count - 1]);
+            dot_expr_add(&expr, root, count - 1);
+        }
+        count++;
+    }
+    dot_eval(R, &expr, count - 1);
+
+    // The magnitude modulo 2^(64 size), the carry flag when it does not fit
+    mpz_t magnitude, high;
+    mpz_inits(magnitude, high, NULL);
+    mpz_abs(magnitude, value[count - 1]);
+    mpz_tdiv_q_2exp(high, magnitude, 64 * R->size);
+    mpz_tdiv_r_2exp(magnitude, magnitude, 64 * R->size);
+    memset(e, 0, R->size * sizeof(uint64_t));
+    mpz_export(e, NULL, -1, sizeof(uint64_t), 0, 0, magnitude);
+    bool ok = check_limbs(R->dot_limbs, e, R->size, why, why_len) && check_used(R, why, why_len);
+    if (ok && R->sign != (mpz_sgn(value[count - 1]) < 0))
+    {
+        snprintf(why, why_len, "sign is %d, expected %d", R->sign, mpz_sgn(value[count - 1]) < 0);
+        ok = false;
+    }
+    if (ok && R->carry != (mpz_sgn(high) != 0))
+    {
+        snprintf(why, why_len, "carry is %d, expected %d", R->carry, mpz_sgn(high) != 0);
+        ok = false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        mpz_clear(value[i]);
+    }
+    mpz_clears(magnitude, high, NULL);
+    dot_expr_free(&expr);
+    free(x);
+    return ok;
+}
+
+/*
+    Runs one case through libdot and GMP. The buffers are padded to whole 8-limb blocks and filled with GUARD
+    beyond the operands, a limb the kernel should not touch that changes is reported as a stray write.
+*/
+static bool run_case(const fuzz_case_t *c, char *why, size_t why_len)
+{
+    size_t n = c->n, padded = ((n + 1 + 7) & ~(size_t)7) + 8;
+    uint64_t *buf = (uint64_t *)aligned_alloc(64, 4 * padded * sizeof(uint64_t));
+    if (buf == NULL)
+    {
+        perror("Memory allocation failed for the case buffers\n");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t *a = buf, *b = buf + padded, *r = buf + 2 * padded, *e = buf + 3 * padded;
+    for (size_t i = 0; i < 4 * padded; i++)
+    {
+        buf[i] = GUARD;
+    }
+    memcpy(a, c->a, n * sizeof(uint64_t));
+    memcpy(b, c->b, n * sizeof(uint64_t));
+
+    bool ok = true;
+    dot_limb_t A, B, R;
+    dot_limb_init_buffer(&A, a, n);
+    dot_limb_init_buffer(&B, b, n);
+    dot_limb_normalize(&A);
+    dot_limb_normalize(&B);
+    size_t rn = c->wide ? n + 1 : n;
+    dot_limb_init_buffer(&R, r, rn);
+    size_t guard_from = rn; // First limb of r the operation must leave alone
+
+    switch (c->op)
+    {
+    case FUZZ_ADD_N:
+    case FUZZ_ADD_ALIAS:
+    case FUZZ_ADD_N_CT:
+    case FUZZ_ADD_JIT:
+    {
+        mp_limb_t cy = mpn_add_n(e, c->a, c->b, n);
+        dot_limb_t *dst = c->op == FUZZ_ADD_ALIAS ? &A : &R;
+        if (c->op == FUZZ_ADD_ALIAS)
+        {
+            // The result lands in a, r stays untouched
+            guard_from = 0;
+        }
+        if (c->op == FUZZ_ADD_N_CT)
+        {
+            dot_add_n_ct(dst, &A, &B);
+        }
+        else if (c->op == FUZZ_ADD_JIT)
+        {
+            // Past the largest generated size the caller falls back to dot_add_n
+            dot_jit_func_t jit = dot_jit_get(DOT_JIT_ADD, n);
+            (jit != NULL ? jit : dot_add_n)(dst, &A, &B);
+        }
+        else
+        {
+            dot_add_n(dst, &A, &B);
+        }
+        if (dst->size > n)
+        {
+            e[n] = cy;
+            cy = 0;
+        }
+        ok = check_limbs(dst->dot_limbs, e, dst->size, why, why_len) && check_used(dst, why, why_len);
+        if (ok && (mp_limb_t)dst->carry != cy)
+        {
+            snprintf(why, why_len, "carry is %d, expected %lu", dst->carry, cy);
+            ok = false;
+        }
+        break;
+    }
+    case FUZZ_SUB_N:
+    case FUZZ_SUB_ALIAS:
+    case FUZZ_SUB_N_CT:
+    case FUZZ_SUB_JIT:
+    {
+        int cmp = mpn_cmp(c->a, c->b, n);
+        mpn_sub_n(e, cmp >= 0 ? c->a : c->b, cmp >= 0 ? c->b : c->a, n);
+        e[n] = 0;
+        dot_limb_t *dst = c->op == FUZZ_SUB_ALIAS ? &A : &R;
+        if (c->op == FUZZ_SUB_ALIAS)
+        {
+            guard_from = 0;
+        }
+        if (c->op == FUZZ_SUB_N_CT)
+        {
+            dot_sub_n_ct(dst, &A, &B);
+        }
+        else if (c->op == FUZZ_SUB_JIT)
+        {
+            dot_jit_func_t jit = dot_jit_get(DOT_JIT_SUB, n);
+            (jit != NULL ? jit : dot_sub_n)(dst, &A, &B);
+        }
+        else
+        {
+            dot_sub_n(dst, &A, &B);
+        }
+        ok = check_limbs(dst->dot_limbs, e, dst->size, why, why_len) && check_used(dst, why, why_len);
+        if (ok && dst->sign != (cmp < 0))
+        {
+            snprintf(why, why_len, "sign is %d, expected %d", dst->sign, cmp < 0);
+            ok = false;
+        }
+        break;
+    }
+    case FUZZ_ADD_NC:
+    case FUZZ_SUB_NC:
+    case FUZZ_ADD_NC_CT:
+    case FUZZ_SUB_NC_CT:
+    {
+        bool add = c->op == FUZZ_ADD_NC || c->op == FUZZ_ADD_NC_CT;
+        bool ct = c->op == FUZZ_ADD_NC_CT || c->op == FUZZ_SUB_NC_CT;
+        mp_limb_t cy = add ? mpn_add_n(e, c->a, c->b, n) : mpn_sub_n(e, c->a, c->b, n);
+        cy += add ? mpn_add_1(e, e, n, c->carry) : mpn_sub_1(e, e, n, c->carry);
+        uint64_t got;
+        if (ct)
+        {
+            got = add ? dot_add_nc_ct(r, a, b, n, c->carry) : dot_sub_nc_ct(r, a, b, n, c->carry);
+        }
+        else
+        {
+            got = add ? dot_add_nc(r, a, b, n, c->carry) : dot_sub_nc(r, a, b, n, c->carry);
+        }
+        guard_from = n;
+        ok = check_limbs(r, e, n, why, why_len);
+        if (ok && got != cy)
+        {
+            snprintf(why, why_len, "carry out is %lu, expected %lu", got, cy);
+            ok = false;
+        }
+        break;
+    }
+    case FUZZ_EVAL:
+        ok = run_eval(c, &A, &B, &R, e, why, why_len);
+        break;
+    case FUZZ_ADDMOD:
+    case FUZZ_SUBMOD:
+    case FUZZ_ADDMOD_PM:
+    case FUZZ_SUBMOD_PM:
+    {
+        uint64_t *m = (uint64_t *)malloc(n * sizeof(uint64_t));
+        unsigned k = 0;
+        uint64_t pm_c = 0;
+        if (m == NULL)
+        {
+            perror("Memory allocation failed for the modulus\n");
+            exit(EXIT_FAILURE);
+        }
+        make_modulus(c, m, &k, &pm_c);
+        guard_from = n;
+        // Minimising may leave operands that are not reduced, they are outside the contract
+        if (mpn_cmp(c->a, m, n) >= 0 || mpn_cmp(c->b, m, n) >= 0)
+        {
+            free(m);
+            guard_from = 0;
+            break;
+        }
+        bool add = c->op == FUZZ_ADDMOD || c->op == FUZZ_ADDMOD_PM;
+        if (add && (mpn_add_n(e, c->a, c->b, n) || mpn_cmp(e, m, n) >= 0))
+        {
+            mpn_sub_n(e, e, m, n);
+        }
+        if (!add && mpn_sub_n(e, c->a, c->b, n))
+        {
+            mpn_add_n(e, e, m, n);
+        }
+        switch (c->op)
+        {
+        case FUZZ_ADDMOD:
+            dot_addmod(r, a, b, m, n);
+            break;
+        case FUZZ_SUBMOD:
+            dot_submod(r, a, b, m, n);
+            break;
+        case FUZZ_ADDMOD_PM:
+            dot_addmod_pm(r, a, b, n, k, pm_c);
+            break;
+        default:
+            dot_submod_pm(r, a, b, n, k, pm_c);
+            break;
+        }
+        ok = check_limbs(r, e, n, why, why_len);
+        free(m);
+        break;
+    }
+    default:
+    {
+        bool add = c->op == FUZZ_STREAM_ADD;
+        mp_limb_t cy = add ? mpn_add_n(e, c->a, c->b, n) : mpn_sub_n(e, c->a, c->b, n);
+        dot_stream_t stream;
+        dot_stream_init(&stream, add ? DOT_STREAM_ADD : DOT_STREAM_SUB);
+        uint64_t state = c->chunks;
+        for (size_t done = 0; done < n;)
+        {
+            size_t span = next(&state) & 1 ? 9 : n;
+            size_t chunk = 1 + next(&state) % span;
+            chunk = chunk > n - done ? n - done : chunk;
+            dot_stream_update(&stream, r + done, a + done, b + done, chunk);
+            done += chunk;
+        }
+        uint64_t got = dot_stream_finish(&stream);
+        guard_from = n;
+        ok = check_limbs(r, e, n, why, why_len);
+        if (ok && got != cy)
+        {
+            snprintf(why, why_len, "carry out is %lu, expected %lu", got, cy);
+            ok = false;
+        }
+        break;
+    }
+    }
+
+    // Nothing may be written past the result, and the operands are read-only unless aliased
+    for (size_t i = guard_from; ok && i < padded; i++)
+    {
+        if (r[i] != GUARD)
+        {
+            snprintf(why, why_len, "stray write to result limb %zu", i);
+            ok = false;
+        }
+    }
+    for (size_t i = 0; ok && i < padded; i++)
+    {
+        bool aliased = (c->op == FUZZ_ADD_ALIAS || c->op == FUZZ_SUB_ALIAS) && i < n;
+        if (!aliased && a[i] != (i < n ? c->a[i] : GUARD))
+        {
+            snprintf(why, why_len, "operand a changed at limb %zu", i);
+            ok = false;
+        }
+        if (ok && b[i] != (i < n ? c->b[i] : GUARD))
+        {
+            snprintf(why, why_len, "operand b changed at limb %zu", i);
+            ok = false;
+        }
+    }
+
+    free(buf);
+    return ok;
+}
+
+// Function to shrink a failing case while it keeps failing: fewer limbs, then simpler limbs
+static void minimise_case(fuzz_case_t *c)
+{
+    char why[256];
+    uint64_t carry = c->carry;
+    c->carry = 0;
+    if (run_case(c, why, sizeof(why)))
+    {
+        c->carry = carry;
+    }
+
+    // Drop limbs from the top, the smallest length that still fails wins
+    size_t n = c->n;
+    for (size_t m = 1; m < n; m++)
+    {
+        c->n = m;
+        if (!run_case(c, why, sizeof(why)))
+        {
+            break;
+        }
+        c->n = n;
+    }
+
+    // Push every limb to 0, then to all ones, until no change keeps the failure
+    static const uint64_t simple[] = {0, ~0ULL, 1};
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < c->n; i++)
+        {
+            for (int which = 0; which < 2; which++)
+            {
+                uint64_t *x = which ? c->b : c->a;
+                for (size_t s = 0; s < sizeof(simple) / sizeof(simple[0]); s++)
+                {
+                    uint64_t old = x[i];
+                    if (old == simple[s])
+                    {
+                        break;
+                    }
+                    x[i] = simple[s];
+                    if (!run_case(c, why, sizeof(why)))
+                    {
+                        changed = true;
+                        break;
+                    }
+                    x[i] = old;
+                }
+            }
+        }
+    }
+}
+
+// Function to print the limbs of an operand, most significant first
+static void print_limbs(const char *label, const uint64_t *limbs, size_t n)
+{
+    printf("  %s =", label);
+    for (size_t j = n; j-- > 0;)
+    {
+        printf(" %016lx", limbs[j]);
+    }
+    printf("\n");
+}
+
+static void report_failure(uint64_t case_seed, fuzz_case_t *c, const char *why)
+{
+    char min_why[256];
+    pthread_mutex_lock(&report_lock);
+    printf("FAIL case seed 0x%016lx: %s with %zu limbs: %s\n", case_seed, FUZZ_OP_NAMES[c->op], c->n, why);
+    minimise_case(c);
+    run_case(c, min_why, sizeof(min_why));
+    printf("  minimised to %zu limbs, wide %d, carry %lu: %s\n", c->n, c->wide, c->carry, min_why);
+    print_limbs("a", c->a, c->n);
+    print_limbs("b", c->b, c->n);
+    printf("  replay with -n %zu -R 0x%016lx\n", config.max_limbs, case_seed);
+    fflush(stdout);
+    pthread_mutex_unlock(&report_lock);
+}
+
+static void *fuzz_thread(void *arg)
+{
+    uint64_t thread_seed = mix64(config.seed ^ mix64((uint64_t)(intptr_t)arg));
+    fuzz_case_t c;
+    c.a = (uint64_t *)malloc(config.max_limbs * sizeof(uint64_t));
+    c.b = (uint64_t *)malloc(config.max_limbs * sizeof(uint64_t));
+    if (c.a == NULL || c.b == NULL)
+    {
+        perror("Memory allocation failed for the operands\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char why[256];
+    for (uint64_t i = 0; !atomic_load_explicit(&stop, memory_order_relaxed); i++)
+    {
+        if (config.cases != 0 && atomic_fetch_add(&total_cases, 1) >= config.cases)
+        {
+            break;
+        }
+        uint64_t case_seed = mix64(thread_seed + i);
+        generate_case(case_seed, &c, config.max_limbs);
+        if (!run_case(&c, why, sizeof(why)))
+        {
+            atomic_fetch_add(&total_failures, 1);
+            report_failure(case_seed, &c, why);
+            if (!config.keep_going)
+            {
+                atomic_store(&stop, true);
+            }
+        }
+        if (config.cases == 0)
+        {
+            atomic_fetch_add_explicit(&total_cases, 1, memory_order_relaxed);
+        }
+    }
+
+    free(c.a);
+    free(c.b);
+    return NULL;
+}
+
+static double elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-j threads] [-t seconds] [-i cases] [-n max_limbs] [-s seed] [-k] [-R case_seed]\n", prog);
+    fprintf(stderr, "  -j threads    fuzzing threads (default 1)\n");
+    fprintf(stderr, "  -t seconds    stop after this long (default: run until -i cases or a failure)\n");
+    fprintf(stderr, "  -i cases      stop after this many cases (default 1000000 without -t)\n");
+    fprintf(stderr, "  -n max_limbs  largest operand in limbs (default %d)\n", DEFAULT_MAX_LIMBS);
+    fprintf(stderr, "  -s seed       seed of the run (default 1)\n");
+    fprintf(stderr, "  -k            keep going after a failure\n");
+    fprintf(stderr, "  -R case_seed  replay and minimise a single case\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t replay = 0;
+    bool replaying = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:t:i:n:s:kR:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'j':
+            config.threads = atoi(optarg);
+            break;
+        case 't':
+            config.seconds = atof(optarg);
+            break;
+        case 'i':
+            config.cases = strtoull(optarg, NULL, 0);
+            break;
+        case 'n':
+            config.max_limbs = strtoull(optarg, NULL, 0);
+            break;
+        case 's':
+            config.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'k':
+            config.keep_going = true;
+            break;
+        case 'R':
+            replay = strtoull(optarg, NULL, 0);
+            replaying = true;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (config.threads <= 0 || config.max_limbs == 0 || config.seconds < 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (replaying)
+    {
+        char why[256];
+        fuzz_case_t c;
+        c.a = (uint64_t *)malloc(config.max_limbs * sizeof(uint64_t));
+        c.b = (uint64_t *)malloc(config.max_limbs * sizeof(uint64_t));
+        if (c.a == NULL || c.b == NULL)
+        {
+            perror("Memory allocation failed for the operands\n");
+            exit(EXIT_FAILURE);
+        }
+        generate_case(replay, &c, config.max_limbs);
+        if (run_case(&c, why, sizeof(why)))
+        {
+            printf("Case 0x%016lx (%s, %zu limbs) passes\n", replay, FUZZ_OP_NAMES[c.op], c.n);
+            return EXIT_SUCCESS;
+        }
+        report_failure(replay, &c, why);
+        return EXIT_FAILURE;
+    }
+    if (config.seconds == 0 && config.cases == 0)
+    {
+        config.cases = 1000000;
+    }
+
+    printf("Fuzzing with %d threads, seed %lu, up to %zu limbs\n", config.threads, config.seed, config.max_limbs);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t *threads = (pthread_t *)malloc(config.threads * sizeof(pthread_t));
+    if (threads == NULL)
+    {
+        perror("Memory allocation failed for the threads\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < config.threads; t++)
+    {
+        if (pthread_create(&threads[t], NULL, fuzz_thread, (void *)(intptr_t)t) != 0)
+        {
+            perror("Failed to create a fuzzing thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Report progress until the threads are told to stop or run out of cases
+    double next_report = PROGRESS_SECONDS;
+    while (!atomic_load(&stop))
+    {
+        usleep(100000);
+        double elapsed = elapsed_seconds(&start);
+        uint64_t done = atomic_load(&total_cases);
+        if (config.cases != 0 && done >= config.cases)
+        {
+            break;
+        }
+        if (config.seconds != 0 && elapsed >= config.seconds)
+        {
+            atomic_store(&stop, true);
+        }
+        if (elapsed >= next_report)
+        {
+            printf("%.0f s: %lu cases, %.0f cases/s, %lu failures\n", elapsed, (unsigned long)done, done / elapsed,
+                   (unsigned long)atomic_load(&total_failures));
+            fflush(stdout);
+            next_report += PROGRESS_SECONDS;
+        }
+    }
+    for (int t = 0; t < config.threads; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+
+    uint64_t done = atomic_load(&total_cases);
+    done = config.cases != 0 && done > config.cases ? config.cases : done;
+    printf("\n===== FUZZ SUMMARY =====\n");
+    printf("Total cases run: %lu in %.1f s\n", (unsigned long)done, elapsed_seconds(&start));
+    printf("Total failures: %lu\n", (unsigned long)atomic_load(&total_failures));
+
+    return atomic_load(&total_failures) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
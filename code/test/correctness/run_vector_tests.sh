@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Compile the converter and the threaded runner
+gcc convert_cases.c -o convert_cases -lz -O2
+gcc test_vectors.c -o test_vectors -ldot -lz -pthread -O2
+
+bit_sizes=(256 260 512 520 1024 1036 2048 2052 4096 4104 8192 8204 16384 16388 32768 32776)
+operations=(0 1)
+# operation name: 0 for dot_add, 1 for dot_sub, 2 for dot_add_approx, 3 for dot_sub_approx
+operation_name=(dot_add dot_sub)
+# case types: 0 for random, 1 for special
+case_types=(0 1)
+case_name=(random special)
+
+for operation in "${operations[@]}"; do
+    for case_type in "${case_types[@]}"; do
+        for bit_size in "${bit_sizes[@]}"; do
+            dir="./cases/$([ $((operation % 2)) -eq 0 ] && echo add || echo sub)/$bit_size"
+            # Convert once, the vectors are rebuilt when the csv is newer
+            if [ ! -f "$dir/${case_name[$case_type]}.dotv" ] || [ "$dir/${case_name[$case_type]}.csv.gz" -nt "$dir/${case_name[$case_type]}.dotv" ]; then
+                ./convert_cases $((operation % 2)) $bit_size $case_type || exit 1
+            fi
+
+            ./test_vectors $operation $bit_size $case_type > /dev/null
+            if [ $? -ne 0 ]; then
+                echo "❌ Test failed for operation ${operation_name[$operation]}, bit size $bit_size, case type ${case_name[$case_type]}"
+                echo "   rerun: ./test_vectors $operation $bit_size $case_type"
+                exit 1
+            else
+                echo "✅ Test passed for operation ${operation_name[$operation]}, bit size $bit_size, case type ${case_name[$case_type]}"
+            fi
+        done
+    done
+done
+
+echo "🎉 All vector tests completed successfully!"
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "dotlib.h"
+
+#define ARENA_ALIGN 64          // Alignment of every arena allocation
+#define CHUNK_BYTES (1 << 20)   // Default chunk size of an arena
+#define SPAN_SIZE 300000        // Block size of the chunk boundary test, three fit in a chunk
+#define SPAN_BLOCKS 8           // Blocks of the chunk boundary test, enough for three chunks
+#define THREADS 4               // Threads of the scratch arena test
+#define SCRATCH_BYTES 4096      // Bytes each thread keeps in its scratch arena
+
+/*
+    Checks the stack-style arenas. Allocations under nested marks must be 64-byte aligned and keep their
+    contents, a release to the inner mark and then to the outer one must hand the same memory out again, and
+    so must a release behind a chunk boundary, without taking new chunks. The scratch arena of every thread
+    must be its own: threads fill theirs at the same time, run dot_limb_set_str on top, which uses the same
+    arena, and must find their memory untouched.
+*/
+
+// Function to check the alignment of an allocation
+static bool aligned(const void *ptr, size_t size)
+{
+    if ((uintptr_t)ptr % ARENA_ALIGN != 0)
+    {
+        printf("An allocation of %zu bytes at %p is not %d-byte aligned\n", size, ptr, ARENA_ALIGN);
+        return false;
+    }
+    return true;
+}
+
+// Function to check that size bytes at ptr all hold value
+static bool filled(const uint8_t *ptr, size_t size, uint8_t value)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (ptr[i] != value)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_nested_marks(void)
+{
+    bool ok = true;
+    dot_arena_t arena;
+    dot_arena_init(&arena);
+
+    uint8_t *base = (uint8_t *)dot_arena_alloc(&arena, 100);
+    memset(base, 1, 100);
+    dot_arena_mark_t outer = dot_arena_mark(&arena);
+    uint8_t *a = (uint8_t *)dot_arena_alloc(&arena, 200);
+    memset(a, 2, 200);
+    dot_arena_mark_t inner = dot_arena_mark(&arena);
+    uint8_t *b = (uint8_t *)dot_arena_alloc(&arena, 300);
+    memset(b, 3, 300);
+    ok = aligned(base, 100) && aligned(a, 200) && aligned(b, 300) && ok;
+    if (!filled(base, 100, 1) || !filled(a, 200, 2) || !filled(b, 300, 3))
+    {
+        printf("Allocations under nested marks overlap\n");
+        ok = false;
+    }
+
+    // Back to the inner mark, then to the outer one: the same memory comes back, what is older stays
+    dot_arena_release(&arena, inner);
+    if (dot_arena_alloc(&arena, 300) != b || !filled(a, 200, 2))
+    {
+        printf("A release to the inner mark did not rewind to it\n");
+        ok = false;
+    }
+    dot_arena_release(&arena, outer);
+    if (dot_arena_alloc(&arena, 200) != a || !filled(base, 100, 1))
+    {
+        printf("A release to the outer mark did not rewind to it\n");
+        ok = false;
+    }
+
+    // Every size rounds up to whole 64-byte units
+    for (size_t size = 1; size <= 3 * ARENA_ALIGN; size++)
+    {
+        ok = aligned(dot_arena_alloc(&arena, size), size) && ok;
+    }
+
+    dot_limb_t *num = dot_arena_limb_alloc(&arena, 9);
+    ok = aligned(num->dot_limbs, 9 * sizeof(uint64_t)) && ok;
+    if (num->size != 9 || !num->view)
+    {
+        printf("dot_arena_limb_alloc gave %zu limbs, view %d\n", num->size, num->view);
+        ok = false;
+    }
+    dot_arena_destroy(&arena);
+    return ok;
+}
+
+bool test_chunk_boundary(void)
+{
+    bool ok = true;
+    dot_arena_t arena;
+    dot_arena_init(&arena);
+    dot_arena_alloc(&arena, 64);
+    dot_arena_mark_t mark = dot_arena_mark(&arena);
+
+    // The blocks run over into new chunks, each tagged with its index
+    uint8_t *blocks[SPAN_BLOCKS];
+    size_t chunks = 1;
+    for (int i = 0; i < SPAN_BLOCKS; i++)
+    {
+        blocks[i] = (uint8_t *)dot_arena_alloc(&arena, SPAN_SIZE);
+        ok = aligned(blocks[i], SPAN_SIZE) && ok;
+        memset(blocks[i], i, SPAN_SIZE);
+        chunks += i > 0 && blocks[i] != blocks[i - 1] + (SPAN_SIZE + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    }
+    for (int i = 0; i < SPAN_BLOCKS; i++)
+    {
+        if (!filled(blocks[i], SPAN_SIZE, (uint8_t)i))
+        {
+            printf("Block %d was overwritten by another one\n", i);
+            ok = false;
+        }
+    }
+    if (chunks < 3)
+    {
+        printf("%d blocks of %d bytes fit in %zu chunks\n", SPAN_BLOCKS, SPAN_SIZE, chunks);
+        ok = false;
+    }
+
+    // Released behind the first chunk boundary, the kept chunks are reused in the same order
+    dot_arena_release(&arena, mark);
+    for (int i = 0; i < SPAN_BLOCKS; i++)
+    {
+        if (dot_arena_alloc(&arena, SPAN_SIZE) != blocks[i])
+        {
+            printf("Block %d was not reused after the release\n", i);
+            ok = false;
+        }
+    }
+
+    // An allocation larger than a chunk gets a chunk of its own
+    dot_arena_release(&arena, mark);
+    uint8_t *big = (uint8_t *)dot_arena_alloc(&arena, 2 * CHUNK_BYTES);
+    ok = aligned(big, 2 * CHUNK_BYTES) && ok;
+    memset(big, 0xA5, 2 * CHUNK_BYTES);
+    dot_arena_destroy(&arena);
+    return ok;
+}
+
+typedef struct
+{
+    pthread_barrier_t *barrier;
+    uint8_t id;
+    dot_arena_t *arena; // The thread's scratch arena
+    uint8_t *block;     // What it allocated there
+    bool ok;
+} scratch_thread_t;
+
+// Function of a thread that fills its scratch arena while the others fill theirs
+static void *fill_scratch(void *arg)
+{
+    scratch_thread_t *thread = (scratch_thread_t *)arg;
+    dot_arena_t *arena = dot_scratch_arena();
+    dot_arena_mark_t mark = dot_arena_mark(arena);
+    thread->arena = arena;
+    thread->block = (uint8_t *)dot_arena_alloc(arena, SCRATCH_BYTES);
+    memset(thread->block, thread->id, SCRATCH_BYTES);
+    pthread_barrier_wait(thread->barrier);
+
+    // The library takes its temporaries from the same arena and releases them to its own mark
+    dot_limb_t *num = dot_limb_set_str("123456789abcdef0123456789abcdef0123456789abcdef");
+    dot_limb_t_free(num);
+    pthread_barrier_wait(thread->barrier);
+
+    thread->ok = filled(thread->block, SCRATCH_BYTES, thread->id);
+    if (!thread->ok)
+    {
+        printf("Thread %d found its scratch memory changed\n", thread->id);
+    }
+    dot_arena_release(arena, mark);
+    return NULL;
+}
+
+bool test_scratch_threads(void)
+{
+    bool ok = true;
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, THREADS);
+    scratch_thread_t threads[THREADS];
+    pthread_t handles[THREADS];
+    for (int i = 0; i < THREADS; i++)
+    {
+        threads[i] = (scratch_thread_t){&barrier, (uint8_t)(i + 1), NULL, NULL, false};
+        if (pthread_create(&handles[i], NULL, fill_scratch, &threads[i]) != 0)
+        {
+            perror("Failed to create a scratch arena thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < THREADS; i++)
+    {
+        pthread_join(handles[i], NULL);
+        ok = threads[i].ok && ok;
+    }
+    pthread_barrier_destroy(&barrier);
+
+    dot_arena_t *own = dot_scratch_arena();
+    for (int i = 0; i < THREADS; i++)
+    {
+        if (threads[i].arena == own)
+        {
+            printf("Thread %d shares the scratch arena of the main thread\n", i + 1);
+            ok = false;
+        }
+        for (int j = 0; j < i; j++)
+        {
+            if (threads[i].arena == threads[j].arena || threads[i].block == threads[j].block)
+            {
+                printf("Threads %d and %d share a scratch arena\n", j + 1, i + 1);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+int main(void)
+{
+    int total_tests = 0, total_failures = 0;
+    init_memory_pool();
+
+    printf("Running nested mark tests\n");
+    total_tests++;
+    total_failures += !test_nested_marks();
+
+    printf("Running chunk boundary tests\n");
+    total_tests++;
+    total_failures += !test_chunk_boundary();
+
+    printf("Running scratch arena thread tests\n");
+    total_tests++;
+    total_failures += !test_scratch_threads();
+
+    destroy_memory_pool();
+
+    printf("\n===== TEST SUMMARY =====\n");
+    printf("Total test cases executed: %d\n", total_tests);
+    printf("Total test cases failed: %d\n", total_failures);
+    printf("Total test cases passed: %d\n", total_tests - total_failures);
+
+    return total_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
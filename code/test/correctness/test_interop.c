@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <unistd.h>
+#include <gmp.h>
+
+#include "dotlib.h"
+#include "dotlib_gmp.h"
+
+#define ITERATIONS 10000 // Number of random operand pairs per size
+#define MAX_LIMBS 2052   // Largest operand size in limbs
+
+/*
+    Checks the GMP interop layer in-process: dot_import/dot_export against mpz_import/mpz_export for every
+    word layout, dot_add_n/dot_sub_n run directly on mpz_t limbs through views against mpz_add/mpz_sub, the
+    streaming API fed in random chunks against the same results modulo 2^(64n), and dot_add_n from mapped
+    limb files into a mapped result, synced, reopened and checked against mpz_add.
+*/
+
+// Function to generate a random n-limb operand, with its top limb non-zero
+void random_operand(mpz_t z, gmp_randstate_t state, size_t n)
+{
+    mpz_urandomb(z, state, n * 64);
+    mpz_setbit(z, n * 64 - 1 - gmp_urandomm_ui(state, 64));
+    // Saturate a random run of limbs to exercise carry propagation
+    if (gmp_urandomm_ui(state, 4) == 0)
+    {
+        mp_limb_t *limbs = mpz_limbs_modify(z, n);
+        size_t start = gmp_urandomm_ui(state, n);
+        size_t len = 1 + gmp_urandomm_ui(state, n - start);
+        for (size_t i = start; i < start + len && i < n - 1; i++)
+        {
+            limbs[i] = ~(mp_limb_t)0;
+        }
+        mpz_limbs_finish(z, n);
+    }
+}
+
+bool test_import_export(mpz_t a)
+{
+    const int orders[] = {1, -1};
+    const int endians[] = {1, -1, 0};
+    const size_t sizes[] = {1, 3, 8, 16};
+    bool ok = true;
+
+    for (int o = 0; o < 2; o++)
+        for (int e = 0; e < 3; e++)
+            for (int s = 0; s < 4; s++)
+            {
+                size_t count, dot_count;
+                void *words = mpz_export(NULL, &count, orders[o], sizes[s], endians[e], 0, a);
+
+                dot_limb_t *num = dot_import(count, orders[o], sizes[s], endians[e], words);
+                mpz_t view;
+                if (mpz_cmp(dot_limb_mpz_view(view, num), a) != 0)
+                {
+                    printf("dot_import mismatch: order %d, endian %d, size %zu\n", orders[o], endians[e], sizes[s]);
+                    ok = false;
+                }
+
+                void *dot_words = dot_export(NULL, &dot_count, orders[o], sizes[s], endians[e], num);
+                if (dot_count != count || memcmp(dot_words, words, count * sizes[s]) != 0)
+                {
+                    printf("dot_export mismatch: order %d, endian %d, size %zu\n", orders[o], endians[e], sizes[s]);
+                    ok = false;
+                }
+                memory_pool_free(dot_words);
+
+                // A caller buffer at an odd address, the word copies must not assume alignment
+                uint8_t *unaligned = (uint8_t *)malloc(count * sizes[s] + 1);
+                if (dot_export(unaligned + 1, &dot_count, orders[o], sizes[s], endians[e], num) != unaligned + 1 ||
+                    memcmp(unaligned + 1, words, count * sizes[s]) != 0)
+                {
+                    printf("dot_export mismatch into an unaligned buffer: order %d, endian %d, size %zu\n", orders[o],
+                           endians[e], sizes[s]);
+                    ok = false;
+                }
+                free(unaligned);
+                dot_limb_t_free(num);
+                free(words);
+            }
+    return ok;
+}
+
+// Function to check that zero exports as no words into a buffer that is still returned
+bool test_export_zero(void)
+{
+    dot_limb_t *zero = dot_limb_t_alloc(1);
+    zero->dot_limbs[0] = 0;
+    dot_limb_normalize(zero);
+    size_t count = 1;
+    void *words = dot_export(NULL, &count, 1, 8, 1, zero);
+    bool ok = words != NULL && count == 0;
+    if (!ok)
+    {
+        printf("dot_export of zero: buffer %p, count %zu\n", words, count);
+    }
+    memory_pool_free(words);
+    dot_limb_t_free(zero);
+    return ok;
+}
+
+// Function to write the limbs of z to path as a limb file
+static bool write_limbs(const char *path, const mpz_t z)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    size_t n = mpz_size(z);
+    bool ok = fwrite(mpz_limbs_read(z), sizeof(mp_limb_t), n, file) == n;
+    return fclose(file) == 0 && ok;
+}
+
+bool test_mmap(mpz_t a, mpz_t b, size_t n)
+{
+    char dir[] = "/tmp/dot_interop_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Failed to create the directory of the limb files\n");
+        exit(EXIT_FAILURE);
+    }
+    char path_a[64], path_b[64], path_r[64];
+    snprintf(path_a, sizeof(path_a), "%s/a.limbs", dir);
+    snprintf(path_b, sizeof(path_b), "%s/b.limbs", dir);
+    snprintf(path_r, sizeof(path_r), "%s/r.limbs", dir);
+    bool ok = write_limbs(path_a, a) && write_limbs(path_b, b);
+
+    // One operand faulted in lazily, the other prefaulted, the sum written straight into a mapped file
+    dot_limb_t *num_a = dot_mmap_open(path_a, 0);
+    dot_limb_t *num_b = dot_mmap_open(path_b, DOT_MMAP_POPULATE);
+    dot_limb_t *num_r = dot_mmap_create(path_r, n + 1, 0);
+    if (!ok || num_a == NULL || num_b == NULL || num_r == NULL)
+    {
+        perror("Failed to map the limb files\n");
+        exit(EXIT_FAILURE);
+    }
+    dot_add_n(num_r, num_a, num_b);
+    if (dot_mmap_sync(num_r) != 0)
+    {
+        printf("dot_mmap_sync failed on %zu limbs\n", n);
+        ok = false;
+    }
+    dot_mmap_close(num_r);
+    dot_mmap_close(num_b);
+    dot_mmap_close(num_a);
+
+    // Reopened, the file holds the sum
+    mpz_t expected, view;
+    mpz_init(expected);
+    mpz_add(expected, a, b);
+    num_r = dot_mmap_open(path_r, DOT_MMAP_WRITE);
+    if (num_r == NULL || mpz_cmp(dot_limb_mpz_view(view, num_r), expected) != 0)
+    {
+        gmp_printf("dot_mmap round trip mismatch on %zu limbs\na = %Zx\nb = %Zx\n", n, a, b);
+        ok = false;
+    }
+
+    // Grown past the file it is detached: sync refuses, close frees the pool copy
+    if (num_r != NULL)
+    {
+        dot_limb_t_realloc(num_r, n + 9);
+        if (dot_mmap_sync(num_r) != -1)
+        {
+            printf("dot_mmap_sync of a detached number on %zu limbs did not fail\n", n);
+            ok = false;
+        }
+        dot_mmap_close(num_r);
+    }
+
+    mpz_clear(expected);
+    unlink(path_a);
+    unlink(path_b);
+    unlink(path_r);
+    rmdir(dir);
+    return ok;
+}
+
+bool test_views(mpz_t a, mpz_t b, size_t n)
+{
+    mpz_t r, expected;
+    mpz_inits(r, expected, NULL);
+    bool ok = true;
+
+    dot_limb_t a_view, b_view, r_view;
+    dot_limb_view_mpz(&a_view, a);
+    dot_limb_view_mpz(&b_view, b);
+
+    dot_limb_view_mpz_result(&r_view, r, n);
+    dot_add_n(&r_view, &a_view, &b_view);
+    dot_limb_mpz_finish(r, &r_view);
+    mpz_add(expected, a, b);
+    if (mpz_cmp(r, expected) != 0)
+    {
+        gmp_printf("dot_add_n mismatch on %zu limbs\na = %Zx\nb = %Zx\n", n, a, b);
+        ok = false;
+    }
+
+    dot_limb_view_mpz_result(&r_view, r, n);
+    dot_sub_n(&r_view, &a_view, &b_view);
+    dot_limb_mpz_finish(r, &r_view);
+    mpz_sub(expected, a, b);
+    if (mpz_cmp(r, expected) != 0)
+    {
+        gmp_printf("dot_sub_n mismatch on %zu limbs\na = %Zx\nb = %Zx\n", n, a, b);
+        ok = false;
+    }
+
+    mpz_clears(r, expected, NULL);
+    return ok;
+}
+
+bool test_stream(mpz_t a, mpz_t b, size_t n, gmp_randstate_t state)
+{
+    static uint64_t r[MAX_LIMBS];
+    const mp_limb_t *a_limbs = mpz_limbs_read(a);
+    const mp_limb_t *b_limbs = mpz_limbs_read(b);
+    mpz_t expected, view;
+    mpz_init(expected);
+    bool ok = true;
+
+    for (int op = DOT_STREAM_ADD; op <= DOT_STREAM_SUB; op++)
+    {
+        dot_stream_t stream;
+        dot_stream_init(&stream, (dot_stream_op_t)op);
+        for (size_t i = 0; i < n;)
+        {
+            size_t chunk = 1 + gmp_urandomm_ui(state, n - i < 20 ? n - i : 20);
+            dot_stream_update(&stream, r + i, (const uint64_t *)a_limbs + i, (const uint64_t *)b_limbs + i, chunk);
+            i += chunk;
+        }
+        uint64_t carry = dot_stream_finish(&stream);
+
+        // Both results are exact modulo 2^(64n), the carry or borrow is the bit above them
+        if (op == DOT_STREAM_ADD)
+        {
+            mpz_add(expected, a, b);
+        }
+        else
+        {
+            mpz_sub(expected, a, b);
+        }
+        uint64_t expected_carry = mpz_sgn(expected) < 0 || mpz_sizeinbase(expected, 2) > n * 64;
+        mpz_fdiv_r_2exp(expected, expected, n * 64);
+        if (carry != expected_carry || mpz_cmp(mpz_roinit_n(view, (const mp_limb_t *)r, (mp_size_t)n), expected) != 0)
+        {
+            printf("dot_stream_%s mismatch on %zu limbs\n", op == DOT_STREAM_ADD ? "add" : "sub", n);
+            ok = false;
+        }
+    }
+    mpz_clear(expected);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t limbs[] = {1, 4, 5, 8, 9, 16, 17, 33, 64, 65, 256, 257, 2048, MAX_LIMBS};
+    int iterations = argc > 1 ? atoi(argv[1]) : ITERATIONS;
+    assert(iterations > 0);
+
+    gmp_randstate_t state;
+    gmp_randinit_default(state);
+    gmp_randseed_ui(state, 0x5eed);
+
+    mpz_t a, b;
+    mpz_inits(a, b, NULL);
+
+    int total_tests = 0, total_failures = 0;
+    init_memory_pool();
+    total_tests++;
+    total_failures += !test_export_zero();
+    for (size_t s = 0; s < sizeof(limbs) / sizeof(limbs[0]); s++)
+    {
+        size_t n = limbs[s];
+        printf("Running interop tests with %zu limbs\n", n);
+        for (int i = 0; i < iterations; i++)
+        {
+            random_operand(a, state, n);
+            random_operand(b, state, n);
+
+            bool ok = test_views(a, b, n);
+            if (i % 10 == 0)
+            {
+                ok = test_stream(a, b, n, state) && ok;
+            }
+            if (i % 100 == 0)
+            {
+                ok = test_import_export(a) && ok;
+                ok = test_mmap(a, b, n) && ok;
+            }
+            total_tests++;
+            total_failures += !ok;
+        }
+        destroy_memory_pool();
+        init_memory_pool();
+    }
+    destroy_memory_pool();
+    mpz_clears(a, b, NULL);
+    gmp_randclear(state);
+
+    printf("\n===== TEST SUMMARY =====\n");
+    printf("Total test cases executed: %d\n", total_tests);
+    printf("Total test cases failed: %d\n", total_failures);
+    printf("Total test cases passed: %d\n", total_tests - total_failures);
+
+    return total_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
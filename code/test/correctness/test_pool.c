@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "dotlib.h"
+
+#define MIN_CLASS_SIZE 64       // Smallest size class, in bytes
+#define MAX_CLASS_SIZE 524288   // Largest size class, 512 KB
+#define GROWTH_SIZE 65536       // Block size of the growth test, 31 blocks fit in a slab
+#define GROWTH_BLOCKS 80        // Blocks of the growth test, enough for three slabs
+#define BLOCK_ALIGN 64          // Alignment of every block
+#define ROUNDS 20               // Producer/consumer rounds
+#define BLOCKS_PER_ROUND 4096   // Blocks handed over per round
+#define LARGE_EVERY 512         // One large block among this many
+#define LARGE_SIZE (1 << 20)    // Above the 512 KB largest size class, so it gets its own slabs
+#define MAX_SMALL_SIZE 8192     // Largest small block, in bytes
+#define UNUSED_CLASS_SIZE 65536 // A small size class no block of a round falls in
+#define SLAB_BYTES (2 << 20)    // Slab size of the pool
+#define RING_SIZE 256           // Blocks in flight between the two threads
+#define TAG 0x646f74706f6f6c21ULL // Written at the start of every block by its owner
+
+/*
+    Checks the memory pool on one thread, across threads and the context lifecycle. Every size class must
+    hand out 64-byte aligned blocks that do not overlap, round a request up to its class, and give a freed
+    block out again. Allocations past the end of a slab must grow the pool, and every block must keep what
+    was written to it. These checks run for every backing, with and without prefault and numa; without huge
+    pages reserved, DOT_POOL_HUGETLB must fall back to transparent huge pages and pass all the same.
+
+    Across threads, the owner thread allocates small and large blocks and hands them to a second thread that
+    frees them, so they go through the lock-free remote lists while the owner keeps allocating and draining
+    them. The owner must then get the remotely freed blocks back, and with make STATS=1 the large slabs must
+    have been returned to the system by the small refill path alone. A context created with dot_ctx_create
+    is used from a thread that exits, its block freed remotely and reused, then destroyed while current. A
+    block freed after the thread that owned it has exited must stop the process with a message, not fault.
+
+    Meant to be run under -fsanitize=address (leaks of contexts and slabs, use after free) and
+    -fsanitize=thread (the remote lists), with the library sources compiled in, see readme.md.
+*/
+
+// Function to check the alignment of a block
+static bool aligned(const void *ptr, size_t size)
+{
+    if ((uintptr_t)ptr % BLOCK_ALIGN != 0)
+    {
+        printf("A block of %zu bytes at %p is not %d-byte aligned\n", size, ptr, BLOCK_ALIGN);
+        return false;
+    }
+    return true;
+}
+
+// Single-producer single-consumer ring of blocks, NULL ends the stream
+typedef struct
+{
+    void *slots[RING_SIZE];
+    atomic_size_t head; // Next slot the consumer reads
+    atomic_size_t tail; // Next slot the producer writes
+} ring_t;
+
+static void ring_push(ring_t *ring, void *ptr)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == RING_SIZE)
+    {
+        sched_yield();
+    }
+    ring->slots[tail % RING_SIZE] = ptr;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+static void *ring_pop(ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (atomic_load_explicit(&ring->tail, memory_order_acquire) == head)
+    {
+        sched_yield();
+    }
+    void *ptr = ring->slots[head % RING_SIZE];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return ptr;
+}
+
+typedef struct
+{
+    ring_t ring;
+    atomic_size_t bad_tags; // Blocks that reached the freeing thread with a wrong tag
+} handoff_t;
+
+// Function of the freeing thread: checks the owner's tag and frees every block it is handed
+static void *free_blocks(void *arg)
+{
+    handoff_t *handoff = (handoff_t *)arg;
+    void *ptr;
+    while ((ptr = ring_pop(&handoff->ring)) != NULL)
+    {
+        uint64_t tag;
+        memcpy(&tag, ptr, sizeof(tag));
+        if (tag != TAG)
+        {
+            atomic_fetch_add(&handoff->bad_tags, 1);
+        }
+        memory_pool_free(ptr);
+    }
+    return NULL;
+}
+
+// Function to compare two pointers for qsort and bsearch
+static int compare_ptr(const void *x, const void *y)
+{
+    uintptr_t a = (uintptr_t) * (void *const *)x, b = (uintptr_t) * (void *const *)y;
+    return (a > b) - (a < b);
+}
+
+bool test_size_classes(void)
+{
+    bool ok = true;
+    init_memory_pool();
+    for (size_t size = MIN_CLASS_SIZE; size <= MAX_CLASS_SIZE; size *= 2)
+    {
+        // The smallest request of the class and the class size itself share its blocks
+        size_t small = size == MIN_CLASS_SIZE ? 1 : size / 2 + 1;
+        uint8_t *p = (uint8_t *)memory_pool_alloc(small);
+        uint8_t *q = (uint8_t *)memory_pool_alloc(size);
+        ok = aligned(p, small) && aligned(q, size) && ok;
+        memset(p, 0x5A, size);
+        memset(q, 0xA5, size);
+        if ((p < q ? (size_t)(q - p) : (size_t)(p - q)) < size || p[size - 1] != 0x5A)
+        {
+            printf("Blocks of %zu bytes at %p and %p overlap\n", size, (void *)p, (void *)q);
+            ok = false;
+        }
+
+        // The last block freed is the first one reused
+        memory_pool_free(q);
+        memory_pool_free(p);
+        void *again = memory_pool_alloc(size);
+        if (again != p)
+        {
+            printf("A freed block of %zu bytes was not reused\n", size);
+            ok = false;
+        }
+        memory_pool_free(again);
+    }
+
+    uint8_t *large = (uint8_t *)memory_pool_alloc(LARGE_SIZE);
+    ok = aligned(large, LARGE_SIZE) && ok;
+    memset(large, 0xA5, LARGE_SIZE);
+    memory_pool_free(large);
+    destroy_memory_pool();
+    return ok;
+}
+
+bool test_growth(void)
+{
+    bool ok = true;
+    void *blocks[GROWTH_BLOCKS];
+    init_memory_pool();
+
+    // More blocks than one slab holds, each tagged at both ends with its index
+    for (uint64_t i = 0; i < GROWTH_BLOCKS; i++)
+    {
+        uint64_t *block = (uint64_t *)memory_pool_alloc(GROWTH_SIZE);
+        ok = aligned(block, GROWTH_SIZE) && ok;
+        block[0] = block[GROWTH_SIZE / sizeof(uint64_t) - 1] = i;
+        blocks[i] = block;
+    }
+    for (uint64_t i = 0; i < GROWTH_BLOCKS; i++)
+    {
+        const uint64_t *block = (const uint64_t *)blocks[i];
+        if (block[0] != i || block[GROWTH_SIZE / sizeof(uint64_t) - 1] != i)
+        {
+            printf("Block %llu was overwritten by another one\n", (unsigned long long)i);
+            ok = false;
+        }
+    }
+
+    // Freed and allocated again, the pool hands out the same blocks rather than growing further
+    qsort(blocks, GROWTH_BLOCKS, sizeof(void *), compare_ptr);
+    for (int i = 0; i < GROWTH_BLOCKS; i++)
+    {
+        memory_pool_free(blocks[i]);
+    }
+    for (int i = 0; i < GROWTH_BLOCKS; i++)
+    {
+        void *ptr = memory_pool_alloc(GROWTH_SIZE);
+        if (bsearch(&ptr, blocks, GROWTH_BLOCKS, sizeof(void *), compare_ptr) == NULL)
+        {
+            printf("Block %d of the second round was not one of the freed blocks\n", i);
+            ok = false;
+        }
+    }
+    destroy_memory_pool();
+    return ok;
+}
+
+static const char *backing_names[] = {"malloc", "mmap", "hugetlb", "thp"};
+
+bool test_backings(void)
+{
+    bool ok = true;
+    for (int backing = DOT_POOL_MALLOC; backing <= DOT_POOL_THP; backing++)
+    {
+        for (int prefault = 0; prefault <= 1; prefault++)
+        {
+            for (int numa = 0; numa <= 1; numa++)
+            {
+                // The options outlive destroy_memory_pool, so both tests create their slabs with them
+                dot_pool_options_t options = {(dot_pool_backing_t)backing, prefault, numa};
+                init_memory_pool_ex(&options);
+                bool passed = test_size_classes();
+                passed = test_growth() && passed;
+                if (!passed)
+                {
+                    printf("Failed with backing %s, prefault %d, numa %d\n", backing_names[backing], prefault, numa);
+                    ok = false;
+                }
+            }
+        }
+    }
+    init_memory_pool_ex(&(dot_pool_options_t){DOT_POOL_MALLOC, false, false});
+    return ok;
+}
+
+bool test_remote_free(void)
+{
+    bool ok = true;
+    handoff_t *handoff = (handoff_t *)calloc(1, sizeof(handoff_t));
+    void **freed = (void **)malloc(BLOCKS_PER_ROUND * sizeof(void *));
+    if (handoff == NULL || freed == NULL)
+    {
+        perror("Memory allocation failed for the handoff\n");
+        exit(EXIT_FAILURE);
+    }
+    srand(1);
+    init_memory_pool();
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, free_blocks, handoff) != 0)
+        {
+            perror("Failed to create the freeing thread\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // The last block of a round is large, so a large free is still pending when the thread is joined
+        size_t small = 0;
+        for (int i = 0; i < BLOCKS_PER_ROUND; i++)
+        {
+            bool large = i % LARGE_EVERY == LARGE_EVERY - 1;
+            size_t size = large ? LARGE_SIZE : 1 + (size_t)rand() % MAX_SMALL_SIZE;
+            void *ptr = memory_pool_alloc(size);
+            memcpy(ptr, &(uint64_t){TAG}, sizeof(uint64_t));
+            if (!large)
+            {
+                freed[small++] = ptr;
+            }
+            ring_push(&handoff->ring, ptr);
+        }
+        ring_push(&handoff->ring, NULL);
+        pthread_join(thread, NULL);
+
+        dot_stats_t before, after;
+        dot_stats_get(&before);
+
+        // Every small block was freed remotely, so whether the owner already took them over into its own free
+        // lists or not, the first block of each class it allocates now must be one of them
+        qsort(freed, small, sizeof(void *), compare_ptr);
+        for (size_t size = 64; size <= MAX_SMALL_SIZE; size *= 2)
+        {
+            void *ptr = memory_pool_alloc(size);
+            if (bsearch(&ptr, freed, small, sizeof(void *), compare_ptr) == NULL)
+            {
+                printf("Round %d: a block of %zu bytes was not reused from the remote frees\n", round, size);
+                ok = false;
+            }
+        }
+        // A class the round never used has nothing to reuse, its refill returns the pending large slabs
+        memory_pool_alloc(UNUSED_CLASS_SIZE);
+        dot_stats_get(&after);
+
+        // Only counted with make STATS=1: the large slabs went back to the system with no large allocation, less
+        // the slab the unused class was carved from
+        if (before.pool_bytes > 0 && after.pool_bytes + LARGE_SIZE > before.pool_bytes + SLAB_BYTES)
+        {
+            printf("Round %d: pool holds %llu bytes after the refills, %llu before, the large slabs were kept\n",
+                   round, (unsigned long long)after.pool_bytes, (unsigned long long)before.pool_bytes);
+            ok = false;
+        }
+
+        // Start the next round from empty free lists
+        destroy_memory_pool();
+    }
+
+    if (atomic_load(&handoff->bad_tags) != 0)
+    {
+        printf("%zu blocks reached the freeing thread corrupted\n", (size_t)atomic_load(&handoff->bad_tags));
+        ok = false;
+    }
+    destroy_memory_pool();
+    free(freed);
+    free(handoff);
+    return ok;
+}
+
+// Function of a thread that allocates from a shared context, then exits with its own context alive
+static void *alloc_in_ctx(void *arg)
+{
+    dot_ctx_t *ctx = (dot_ctx_t *)arg;
+    // The thread's own context, destroyed at thread exit
+    memory_pool_free(memory_pool_alloc(LARGE_SIZE));
+    memory_pool_alloc(64); // Left allocated, the context releases it at thread exit
+
+    dot_ctx_set(ctx);
+    void *ptr = memory_pool_alloc(256);
+    memcpy(ptr, &(uint64_t){TAG}, sizeof(uint64_t));
+    return ptr;
+}
+
+bool test_ctx_lifecycle(void)
+{
+    bool ok = true;
+    dot_ctx_t *own = dot_ctx_get();
+    dot_ctx_t *ctx = dot_ctx_create(NULL);
+
+    pthread_t thread;
+    void *ptr;
+    if (pthread_create(&thread, NULL, alloc_in_ctx, ctx) != 0)
+    {
+        perror("Failed to create the allocating thread\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(thread, &ptr);
+
+    // ctx is not current here, so this is a remote free, taken back by the next allocation from ctx
+    memory_pool_free(ptr);
+    dot_ctx_set(ctx);
+    if (dot_ctx_get() != ctx)
+    {
+        printf("dot_ctx_set did not make the context current\n");
+        ok = false;
+    }
+    void *again = memory_pool_alloc(256);
+    if (again != ptr)
+    {
+        printf("A block freed remotely to a created context was not reused\n");
+        ok = false;
+    }
+
+    // Destroying the current context falls back to the thread's own
+    dot_ctx_destroy(ctx);
+    if (dot_ctx_get() != own)
+    {
+        printf("dot_ctx_destroy of the current context did not fall back to the thread's own\n");
+        ok = false;
+    }
+
+    ctx = dot_ctx_create(NULL);
+    dot_ctx_set(ctx);
+    dot_ctx_set(NULL);
+    if (dot_ctx_get() != own)
+    {
+        printf("dot_ctx_set(NULL) did not fall back to the thread's own context\n");
+        ok = false;
+    }
+    dot_ctx_destroy(ctx);
+    return ok;
+}
+
+// Function of a thread that allocates a block in its own context and exits, which destroys the context
+static void *alloc_and_exit(void *arg)
+{
+    return memory_pool_alloc((size_t)arg == 0 ? 256 : LARGE_SIZE);
+}
+
+bool test_dead_ctx_free(void)
+{
+    bool ok = true;
+    for (size_t large = 0; large <= 1; large++)
+    {
+        pthread_t thread;
+        void *ptr;
+        if (pthread_create(&thread, NULL, alloc_and_exit, (void *)large) != 0)
+        {
+            perror("Failed to create the allocating thread\n");
+            exit(EXIT_FAILURE);
+        }
+        pthread_join(thread, &ptr);
+
+        // The free must end the process with EXIT_FAILURE, so it runs in a child
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0)
+        {
+            freopen("/dev/null", "w", stderr);
+            memory_pool_free(ptr);
+            _exit(EXIT_SUCCESS);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_FAILURE)
+        {
+            printf("Freeing a %s block of an exited thread was not stopped, %s %d\n", large ? "large" : "small",
+                   WIFEXITED(status) ? "exit status" : "signal", WIFEXITED(status) ? WEXITSTATUS(status) : WTERMSIG(status));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(void)
+{
+    int total_tests = 0, total_failures = 0;
+
+    printf("Running size class and pool growth tests for every backing\n");
+    total_tests++;
+    total_failures += !test_backings();
+
+    printf("Running cross-thread free tests\n");
+    total_tests++;
+    total_failures += !test_remote_free();
+
+    printf("Running context lifecycle tests\n");
+    total_tests++;
+    total_failures += !test_ctx_lifecycle();
+
+    printf("Running destroyed context free tests\n");
+    total_tests++;
+    total_failures += !test_dead_ctx_free();
+
+    dot_ctx_destroy(dot_ctx_get());
+
+    printf("\n===== TEST SUMMARY =====\n");
+    printf("Total test cases executed: %d\n", total_tests);
+    printf("Total test cases failed: %d\n", total_failures);
+    printf("Total test cases passed: %d\n", total_tests - total_failures);
+
+    return total_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
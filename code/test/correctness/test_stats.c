@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dotlib.h"
+
+#define LIMBS 64             // Operand size, 8 blocks of 8 limbs
+#define CALLS 100            // Calls of each kernel
+#define LARGE_SIZE (1 << 20) // Above the largest size class, so it gets a slab of its own
+#define SLAB_BYTES (2 << 20) // Slab size of the pool
+
+/*
+    Checks the dot_stats_get counters of a libdot built with make STATS=1. The operands make the carry or
+    borrow ripple through every block, so each call takes the slow path once per block: all ones plus one
+    for dot_add_n, and 2^(64(LIMBS-1)) minus one for dot_sub_n. The pool counters are checked around a large
+    allocation, and dot_stats_reset must zero the counters but keep pool_bytes.
+*/
+
+// Function to compare a counter with its expected value
+static bool check(const char *name, uint64_t got, uint64_t expected)
+{
+    if (got != expected)
+    {
+        printf("%s is %llu, expected %llu\n", name, (unsigned long long)got, (unsigned long long)expected);
+        return false;
+    }
+    return true;
+}
+
+// Function to allocate a number of size limbs equal to zero, left with used equal to size until normalised
+static dot_limb_t *zero_operand(size_t size)
+{
+    dot_limb_t *num = dot_limb_t_alloc(size);
+    memset(num->dot_limbs, 0, size * sizeof(uint64_t));
+    return num;
+}
+
+bool test_kernel_counters(void)
+{
+    dot_limb_t *ones = zero_operand(LIMBS), *one = zero_operand(LIMBS), *power = zero_operand(LIMBS);
+    dot_limb_t *result = zero_operand(LIMBS + 1);
+    memset(ones->dot_limbs, 0xFF, LIMBS * sizeof(uint64_t));
+    one->dot_limbs[0] = 1;
+    power->dot_limbs[LIMBS - 1] = 1;
+    dot_limb_normalize(ones);
+    dot_limb_normalize(one);
+    dot_limb_normalize(power);
+
+    dot_stats_reset();
+    for (int i = 0; i < CALLS; i++)
+    {
+        dot_add_n(result, ones, one);
+    }
+    for (int i = 0; i < CALLS; i++)
+    {
+        dot_sub_n(result, power, one);
+    }
+
+    dot_stats_t stats;
+    dot_stats_get(&stats);
+    bool ok = check("calls[DOT_STATS_ADD]", stats.calls[DOT_STATS_ADD], CALLS);
+    ok = check("limbs[DOT_STATS_ADD]", stats.limbs[DOT_STATS_ADD], CALLS * LIMBS) && ok;
+    ok = check("slow_path[DOT_STATS_ADD]", stats.slow_path[DOT_STATS_ADD], CALLS * LIMBS / 8) && ok;
+    ok = check("calls[DOT_STATS_SUB]", stats.calls[DOT_STATS_SUB], CALLS) && ok;
+    ok = check("limbs[DOT_STATS_SUB]", stats.limbs[DOT_STATS_SUB], CALLS * LIMBS) && ok;
+    ok = check("slow_path[DOT_STATS_SUB]", stats.slow_path[DOT_STATS_SUB], CALLS * LIMBS / 8) && ok;
+    ok = check("calls[DOT_STATS_ADD_APPROX]", stats.calls[DOT_STATS_ADD_APPROX], 0) && ok;
+
+    dot_limb_t_free(result);
+    dot_limb_t_free(power);
+    dot_limb_t_free(one);
+    dot_limb_t_free(ones);
+    return ok;
+}
+
+bool test_pool_counters(void)
+{
+    dot_stats_t before, peak, after;
+    dot_stats_reset();
+    dot_stats_get(&before);
+    if (before.pool_bytes == 0)
+    {
+        // The slabs of the operands freed above stay with the pool, so only a build without stats shows 0
+        printf("pool_bytes is 0, libdot was not built with make STATS=1\n");
+        return false;
+    }
+    bool ok = check("pool_high_water after reset", before.pool_high_water, before.pool_bytes);
+
+    void *large = memory_pool_alloc(LARGE_SIZE);
+    dot_stats_get(&peak);
+    memory_pool_free(large);
+    dot_stats_get(&after);
+    ok = check("pool_bytes with a large block", peak.pool_bytes, before.pool_bytes + SLAB_BYTES) && ok;
+    ok = check("pool_bytes after freeing it", after.pool_bytes, before.pool_bytes) && ok;
+    ok = check("pool_high_water after freeing it", after.pool_high_water, before.pool_bytes + SLAB_BYTES) && ok;
+
+    // Reset zeroes the counters and the high water mark, but the pool still holds its memory
+    dot_stats_reset();
+    dot_stats_get(&after);
+    ok = check("calls[DOT_STATS_ADD] after reset", after.calls[DOT_STATS_ADD], 0) && ok;
+    ok = check("slow_path[DOT_STATS_SUB] after reset", after.slow_path[DOT_STATS_SUB], 0) && ok;
+    ok = check("pool_bytes after reset", after.pool_bytes, before.pool_bytes) && ok;
+    ok = check("pool_high_water after reset", after.pool_high_water, before.pool_bytes) && ok;
+
+    destroy_memory_pool();
+    dot_stats_get(&after);
+    ok = check("pool_resets", after.pool_resets, 1) && ok;
+    ok = check("pool_bytes after destroy_memory_pool", after.pool_bytes, 0) && ok;
+    return ok;
+}
+
+int main(void)
+{
+    int total_tests = 0, total_failures = 0;
+    init_memory_pool();
+
+    printf("Running kernel counter tests\n");
+    total_tests++;
+    total_failures += !test_kernel_counters();
+
+    printf("Running pool counter tests\n");
+    total_tests++;
+    total_failures += !test_pool_counters();
+
+    printf("\n===== TEST SUMMARY =====\n");
+    printf("Total test cases executed: %d\n", total_tests);
+    printf("Total test cases failed: %d\n", total_failures);
+    printf("Total test cases passed: %d\n", total_tests - total_failures);
+
+    return total_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "dotlib.h"
+#include "vectors.h"
+
+#define MAX_FAILURES 1000 // Maximum number of failures to track
+
+/*
+    Runs the binary vectors written by convert_cases.c. The records are loaded once, split into contiguous
+    shards, one per thread, and every thread runs the kernel on limb buffers of its own and compares the
+    limbs, carry and sign with the record directly, with no hex parsing or formatting on the way.
+*/
+
+typedef void (*dot_operation_func)(dot_limb_t *, dot_limb_t *, dot_limb_t *);
+
+typedef struct
+{
+    dot_operation_func func;
+    int op;
+    uint64_t *records;
+    size_t limbs;
+    uint64_t first, last; // Records [first, last) of the shard
+    uint64_t failures;    // Failed records of the shard
+    uint64_t failed_cases[MAX_FAILURES];
+} shard_t;
+
+// Function to print the limbs of a number, most significant first
+static void print_limbs(const char *label, const uint64_t *limbs, size_t n)
+{
+    printf("%s:", label);
+    for (size_t j = n; j-- > 0;)
+    {
+        printf(" %016lx", limbs[j]);
+    }
+    printf("\n");
+}
+
+// Function to check the result of a record against the kernel output
+static bool check_record(int op, uint64_t *record, size_t n, const dot_limb_t *s)
+{
+    const uint64_t *expected = dotv_result(record, n);
+    bool negative = *dotv_flags(record, n) & DOTV_NEGATIVE;
+    if (op % 2 == 0)
+    {
+        // The carry out of an n-limb sum is the extra limb of the record
+        return memcmp(s->dot_limbs, expected, n * sizeof(uint64_t)) == 0 && expected[n] == (uint64_t)s->carry;
+    }
+    // The magnitude of a difference fits in n limbs, a zero difference has no sign
+    return memcmp(s->dot_limbs, expected, n * sizeof(uint64_t)) == 0 && expected[n] == 0 &&
+           s->sign == negative;
+}
+
+static void *run_shard(void *arg)
+{
+    shard_t *shard = (shard_t *)arg;
+    size_t n = shard->limbs;
+    // The approx kernels work in whole blocks of 8 limbs, the buffers are padded to them
+    size_t padded = (n + 7) & ~(size_t)7;
+    uint64_t *buffers = (uint64_t *)aligned_alloc(64, 3 * padded * sizeof(uint64_t));
+    if (buffers == NULL)
+    {
+        perror("Memory allocation failed for the shard buffers\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(buffers, 0, 3 * padded * sizeof(uint64_t));
+    dot_limb_t a, b, s;
+
+    for (uint64_t i = shard->first; i < shard->last; i++)
+    {
+        uint64_t *record = shard->records + i * dotv_record_limbs(n);
+        memcpy(buffers, dotv_a(record, n), n * sizeof(uint64_t));
+        memcpy(buffers + padded, dotv_b(record, n), n * sizeof(uint64_t));
+        dot_limb_init_buffer(&a, buffers, n);
+        dot_limb_init_buffer(&b, buffers + padded, n);
+        dot_limb_init_buffer(&s, buffers + 2 * padded, n);
+        dot_limb_normalize(&a);
+        dot_limb_normalize(&b);
+
+        shard->func(&s, &a, &b);
+
+        if (!check_record(shard->op, record, n, &s))
+        {
+            printf("Test case failed, at iteration %lu\n", (unsigned long)i);
+            print_limbs("a", dotv_a(record, n), n);
+            print_limbs("b", dotv_b(record, n), n);
+            print_limbs("expected", dotv_result(record, n), n + 1);
+            print_limbs("result", s.dot_limbs, n);
+            printf("carry = %d, sign = %d\n", s.carry, s.sign);
+            if (shard->failures < MAX_FAILURES)
+            {
+                shard->failed_cases[shard->failures] = i;
+            }
+            shard->failures++;
+        }
+    }
+
+    free(buffers);
+    return NULL;
+}
+
+/*
+    op: 0 -> addition,
+        1 -> subtraction
+        2 -> approximated addition
+        3 -> approximated subtraction
+    case_type: 0 -> random cases
+               1 -> special cases
+*/
+void run_test(int op, int NUM_BITS, int case_type, int num_threads)
+{
+    const char *file_type = (case_type == 0) ? "random" : "special";
+    printf("Running %s test with %d bits on %s test vectors with %d threads\n",
+           op == 0 ? "addition" : (op == 1 ? "subtraction" : (op == 2 ? "approximated addition" : "approximated subtraction")),
+           NUM_BITS, file_type, num_threads);
+
+    char test_filename[100];
+    dotv_filename(test_filename, sizeof(test_filename), op, NUM_BITS, case_type);
+    dotv_header_t header;
+    uint64_t *records = dotv_read(test_filename, &header);
+    if ((int)header.op != op % 2)
+    {
+        fprintf(stderr, "Error: %s holds %s cases\n", test_filename, header.op ? "subtraction" : "addition");
+        exit(EXIT_FAILURE);
+    }
+
+    // if op == 0, addition, 1 == subtraction, 2 == approximated addition, 3 == approximated subtraction
+    dot_operation_func func = op == 0 ? dot_add_n : (op == 1 ? dot_sub_n : (op == 2 ? dot_add_n_approx : dot_sub_n_approx));
+
+    shard_t *shards = (shard_t *)calloc(num_threads, sizeof(shard_t));
+    pthread_t *threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+    if (shards == NULL || threads == NULL)
+    {
+        perror("Memory allocation failed for the shards\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < num_threads; t++)
+    {
+        shards[t].func = func;
+        shards[t].op = op;
+        shards[t].records = records;
+        shards[t].limbs = header.limbs;
+        shards[t].first = header.count * t / num_threads;
+        shards[t].last = header.count * (t + 1) / num_threads;
+        if (pthread_create(&threads[t], NULL, run_shard, &shards[t]) != 0)
+        {
+            perror("Failed to create a test thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    uint64_t total_failures = 0;
+    for (int t = 0; t < num_threads; t++)
+    {
+        pthread_join(threads[t], NULL);
+        total_failures += shards[t].failures;
+    }
+
+    // Print summary of results
+    printf("\n===== TEST SUMMARY =====\n");
+    printf("Total test cases executed: %lu\n", (unsigned long)header.count);
+    printf("Total test cases failed: %lu\n", (unsigned long)total_failures);
+    printf("Total test cases passed: %lu\n", (unsigned long)(header.count - total_failures));
+
+    if (total_failures > 0)
+    {
+        // Shards are contiguous and in order, so the numbers come out sorted
+        printf("\nFailed test case numbers: ");
+        uint64_t displayed = 0;
+        for (int t = 0; t < num_threads; t++)
+        {
+            uint64_t kept = shards[t].failures < MAX_FAILURES ? shards[t].failures : MAX_FAILURES;
+            for (uint64_t i = 0; i < kept && displayed < MAX_FAILURES; i++, displayed++)
+            {
+                printf("%s%lu", displayed ? ", " : "", (unsigned long)shards[t].failed_cases[i]);
+            }
+        }
+        if (total_failures > displayed)
+        {
+            printf(", ... (and %lu more)", (unsigned long)(total_failures - displayed));
+        }
+        printf("\n");
+
+        // Exit with failure status if any tests failed
+        exit(EXIT_FAILURE);
+    }
+
+    free(shards);
+    free(threads);
+    free(records);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4 && argc != 5)
+    {
+        fprintf(stderr, "Usage: %s <operation> <number_of_bits> <case_type> [threads]\n", argv[0]);
+        fprintf(stderr, "operation: 0 for addition, 1 for subtraction, 2 for approximated addition, 3 for approximated subtraction\n");
+        fprintf(stderr, "number_of_bits: number of bits for the test cases\n");
+        fprintf(stderr, "case_type: 0 for random test cases, 1 for special test cases\n");
+        fprintf(stderr, "threads: number of test threads, all online CPUs by default\n");
+        fprintf(stderr, "Note: The test vectors are stored in the ./cases directory, convert them with convert_cases\n");
+        return EXIT_FAILURE;
+    }
+
+    int op = atoi(argv[1]);
+    int NUM_BITS = atoi(argv[2]);
+    int case_type = atoi(argv[3]);
+    int num_threads = argc == 5 ? atoi(argv[4]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    assert(op >= 0 && op <= 3);
+    assert(NUM_BITS > 0 && NUM_BITS <= 131072);
+    assert(case_type == 0 || case_type == 1);
+    assert(num_threads > 0);
+
+    run_test(op, NUM_BITS, case_type, num_threads);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#ifndef VECTORS_H
+#define VECTORS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <zlib.h>
+
+/*
+    Binary test vectors (.dotv).
+
+    A header followed by count fixed-width records of little-endian 64-bit limbs, least significant first:
+        a[limbs], b[limbs], result[limbs + 1], flags
+    Every operand is zero-extended to the width of the header, the extra result limb holds the carry out of
+    an addition, and bit 0 of flags is the sign of a subtraction result, whose limbs are the magnitude.
+    Files are written through zlib, compressed by default or stored as-is, and gzread reads both kinds.
+*/
+
+#define DOTV_MAGIC 0x56544f44u // "DOTV" read as a little-endian 32-bit word
+#define DOTV_VERSION 1
+#define DOTV_NEGATIVE 0x1 // Flags bit, the result is negative
+
+typedef struct
+{
+    uint32_t magic;   // DOTV_MAGIC
+    uint32_t version; // DOTV_VERSION
+    uint32_t op;      // 0 for addition, 1 for subtraction
+    uint32_t bits;    // Bit size the cases were generated for
+    uint64_t limbs;   // Limbs of each operand
+    uint64_t count;   // Number of records
+} dotv_header_t;
+
+// Function to get the number of limbs in a record
+static inline size_t dotv_record_limbs(size_t limbs)
+{
+    return 3 * limbs + 2;
+}
+
+// Function to get the first operand of a record
+static inline uint64_t *dotv_a(uint64_t *record, size_t limbs)
+{
+    (void)limbs;
+    return record;
+}
+
+// Function to get the second operand of a record
+static inline uint64_t *dotv_b(uint64_t *record, size_t limbs)
+{
+    return record + limbs;
+}
+
+// Function to get the expected result of a record, limbs + 1 limbs
+static inline uint64_t *dotv_result(uint64_t *record, size_t limbs)
+{
+    return record + 2 * limbs;
+}
+
+// Function to get the flags limb of a record
+static inline uint64_t *dotv_flags(uint64_t *record, size_t limbs)
+{
+    return record + 3 * limbs + 1;
+}
+
+// Function to build the vector file name of an operation, bit size and case type
+static inline void dotv_filename(char *name, size_t size, int op, int bits, int case_type)
+{
+    snprintf(name, size, "./cases/%s/%d/%s.dotv", (op % 2) ? "sub" : "add", bits,
+             case_type == 0 ? "random" : "special");
+}
+
+// Function to read a vector file, returns the records and fills the header
+static inline uint64_t *dotv_read(const char *filename, dotv_header_t *header)
+{
+    gzFile file = gzopen(filename, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file %s: %s\n", filename, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    gzbuffer(file, 1 << 20);
+    if (gzread(file, header, sizeof(*header)) != (int)sizeof(*header) || header->magic != DOTV_MAGIC ||
+        header->version != DOTV_VERSION || header->limbs == 0)
+    {
+        fprintf(stderr, "Error reading file %s: not a version %d vector file\n", filename, DOTV_VERSION);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t bytes = header->count * dotv_record_limbs(header->limbs) * sizeof(uint64_t);
+    uint64_t *records = (uint64_t *)malloc(bytes ? bytes : 1);
+    if (records == NULL)
+    {
+        perror("Memory allocation failed for the records\n");
+        exit(EXIT_FAILURE);
+    }
+    // gzread takes an unsigned length, read in bounded pieces
+    for (size_t done = 0; done < bytes;)
+    {
+        unsigned piece = bytes - done < (1u << 30) ? (unsigned)(bytes - done) : (1u << 30);
+        int got = gzread(file, (char *)records + done, piece);
+        if (got <= 0)
+        {
+            fprintf(stderr, "Error reading file %s: truncated after %zu bytes\n", filename, done);
+            exit(EXIT_FAILURE);
+        }
+        done += got;
+    }
+    gzclose(file);
+    return records;
+}
+
+#endif // VECTORS_H
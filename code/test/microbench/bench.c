@@ -0,0 +1,733 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cpuid.h>
+#include <sys/utsname.h>
+#include <gmp.h>
+#include "dotlib.h"
+#include "timing_utils.h"
+
+/*
+    Benchmark driver for the libdot kernels.
+
+    Every selected kernel is timed at every selected size, in two modes:
+      latency    - a dependent chain, each call takes the previous result as its first operand
+      throughput - independent calls cycling through THROUGHPUT_SETS operand sets, free to overlap
+    After an untimed warm-up, each trial times a batch of calls with RDTSC, the batch being sized once so it
+    lasts at least MIN_BATCH_TICKS. The per-call times of all trials are summarised as min/median/mean/p99/
+    stddev and written as text, CSV or JSON, so runs on different builds and hosts can be compared directly.
+
+    Each kernel is followed by its GMP baseline (mpn_add_n or mpn_sub_n) on the same operands, sizes and mode,
+    and the ratio of the two medians is reported as the speedup of libdot over GMP.
+
+    The TSC is calibrated at startup and the cost of an empty RDTSC pair is subtracted from every timing. With
+    -H, the latency mode also times that many single calls into an HDR-style histogram, for the tail latency
+    the batch medians average away. Single calls start from a drained pipeline, so their medians sit above
+    the batch medians; compare their shape and tails across builds rather than against the batches.
+
+    By default operands are uniformly random, so carries almost never ripple past a limb. With -C or -S the
+    operands follow a carry pattern instead: a fraction of limb pairs propagates a carry (a borrow when
+    subtracting), in runs of a given length, and of the other pairs a fraction generates one and the rest
+    kill it. -S sweeps each knob around a base point to chart how the kernels degrade as their slow path
+    fires more often. Carry patterns are measured in throughput mode only, the latency chain would overwrite
+    them after one call.
+*/
+
+#define DEFAULT_TRIALS 101     // Timed batches per kernel, size and mode
+#define DEFAULT_WARMUP 1000    // Untimed calls before the first batch
+#define MIN_BATCH_TICKS 100000 // Shortest batch, keeps the serialising RDTSC pair below 1%
+#define THROUGHPUT_SETS 16     // Independent operand sets of the throughput mode, a power of two
+#define MAX_SIZES 64           // Longest list of sizes on the command line
+#define MAX_DENSITIES 64       // Most carry patterns in one run
+
+typedef void (*dot_operation_func)(dot_limb_t *, dot_limb_t *, dot_limb_t *);
+
+// GMP baselines, same signature as the kernels so they run through the same batches
+static void gmp_add_n(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    result->carry = mpn_add_n(result->dot_limbs, a->dot_limbs, b->dot_limbs, a->size);
+}
+
+// Raw n-limb difference, the magnitude compare of dot_sub is not part of mpn_sub_n
+static void gmp_sub_n(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    result->sign = mpn_sub_n(result->dot_limbs, a->dot_limbs, b->dot_limbs, a->size);
+}
+
+typedef struct
+{
+    const char *name;
+    dot_operation_func func;
+    const char *baseline_name;
+    dot_operation_func baseline; // Matching GMP routine
+    bool sub;                    // Carry patterns are built for a borrow chain
+    bool jit;                    // func is replaced by the kernel dot_jit_get generates for each size
+} bench_op_t;
+
+static const bench_op_t OPERATIONS[] = {
+    {"dot_add", dot_add_n, "mpn_add_n", gmp_add_n, false, false},
+    {"dot_sub", dot_sub_n, "mpn_sub_n", gmp_sub_n, true, false},
+    {"dot_add_approx", dot_add_n_approx, "mpn_add_n", gmp_add_n, false, false},
+    {"dot_sub_approx", dot_sub_n_approx, "mpn_sub_n", gmp_sub_n, true, false},
+    {"dot_add_jit", dot_add_n, "mpn_add_n", gmp_add_n, false, true},
+    {"dot_sub_jit", dot_sub_n, "mpn_sub_n", gmp_sub_n, true, true},
+};
+#define NUM_OPERATIONS (int)(sizeof(OPERATIONS) / sizeof(OPERATIONS[0]))
+
+typedef enum
+{
+    MODE_LATENCY = 0,
+    MODE_THROUGHPUT,
+    NUM_MODES,
+} bench_mode_t;
+
+static const char *MODE_NAMES[NUM_MODES] = {"latency", "throughput"};
+
+typedef enum
+{
+    FORMAT_TEXT = 0,
+    FORMAT_CSV,
+    FORMAT_JSON,
+} bench_format_t;
+
+// Carry pattern of the operands
+typedef struct
+{
+    double gen;  // Fraction of the limb pairs outside the propagate runs that generate a carry or borrow
+    double prop; // Fraction of limb pairs that propagate one, the result limb is all ones when it arrives
+    int run;     // Length of the propagate runs, in limbs
+} bench_density_t;
+
+// Sweep of -S, each knob in turn around gen 0.25, prop 0.5, run 8
+static const bench_density_t DENSITY_SWEEP[] = {
+    {0, 0.5, 8}, {0.1, 0.5, 8}, {0.25, 0.5, 8}, {0.5, 0.5, 8},
+    {0.25, 0, 8}, {0.25, 0.1, 8}, {0.25, 0.25, 8}, {0.25, 0.75, 8}, {0.25, 0.9, 8}, {0.25, 0.99, 8},
+    {0.25, 0.5, 1}, {0.25, 0.5, 2}, {0.25, 0.5, 4}, {0.25, 0.5, 16}, {0.25, 0.5, 64}, {0.25, 0.5, 256},
+};
+#define NUM_DENSITY_SWEEP (int)(sizeof(DENSITY_SWEEP) / sizeof(DENSITY_SWEEP[0]))
+
+// Summary of the trials of one kernel, size and mode, times in TSC ticks per call
+typedef struct
+{
+    const char *op;
+    int bits;
+    size_t limbs;
+    bench_mode_t mode;
+    int trials;
+    long reps;
+    double min, median, mean, p99, stddev;
+    double median_ns;       // Wall-clock median per call, from CLOCK_MONOTONIC_RAW
+    const char *baseline;   // GMP routine timed on the same operands, NULL when skipped
+    double baseline_median; // Its median ticks per call
+    double speedup;         // baseline_median / median, above 1 when libdot is faster
+    latency_hist_t *hist;   // Single-call latencies in ticks, NULL when not recorded
+    const bench_density_t *density; // Carry pattern of the operands, NULL for uniform random ones
+} bench_result_t;
+
+typedef struct
+{
+    bool ops[NUM_OPERATIONS];
+    bool modes[NUM_MODES];
+    int bits[MAX_SIZES];
+    int num_bits;
+    bench_density_t densities[MAX_DENSITIES];
+    int num_densities;
+    int trials;
+    int warmup;
+    long hist_calls;
+    uint64_t seed;
+    bool baseline;
+    bench_format_t format;
+    const char *output;
+} bench_config_t;
+
+static uint64_t rng_state;
+
+// Function to get the next pseudo-random 64-bit value (xorshift64*)
+static inline uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Function to allocate a random number of limbs, with room for the full blocks the approx kernels write
+static dot_limb_t *random_operand(size_t limbs)
+{
+    dot_limb_t *num = dot_limb_t_alloc((limbs + 7) & ~(size_t)7);
+    for (size_t i = 0; i < num->alloc; i++)
+    {
+        num->dot_limbs[i] = i < limbs ? rng_next() : 0;
+    }
+    num->size = limbs;
+    num->used = limbs;
+    return num;
+}
+
+// Function to get a pseudo-random double in [0, 1)
+static inline double rng_uniform(void)
+{
+    return (rng_next() >> 11) * 0x1.0p-53;
+}
+
+// Function to fill a and b with limb pairs following a carry pattern
+static void density_operands(dot_limb_t *a, dot_limb_t *b, size_t limbs, const bench_density_t *d, bool sub)
+{
+    const uint64_t top = 1ULL << 63;
+    // Chance that a propagate run starts at a limb outside a run, so that a fraction prop of limbs is in one
+    double start = d->prop >= 1 ? 1 : d->prop / (d->prop + d->run * (1 - d->prop));
+    size_t run_left = 0;
+
+    for (size_t i = 0; i < limbs; i++)
+    {
+        uint64_t x = rng_next(), y = rng_next();
+        if (run_left == 0 && rng_uniform() < start)
+        {
+            run_left = d->run;
+        }
+        if (run_left > 0)
+        {
+            // a + ~a and a - a pass an incoming carry or borrow straight through
+            run_left--;
+            a->dot_limbs[i] = x;
+            b->dot_limbs[i] = sub ? x : ~x;
+        }
+        else if (rng_uniform() < d->gen)
+        {
+            // Both top bits set overflow, a below b borrows
+            a->dot_limbs[i] = sub ? x >> 1 : x | top;
+            b->dot_limbs[i] = y | top;
+        }
+        else
+        {
+            // Both top bits clear cannot overflow, a above b cannot borrow
+            a->dot_limbs[i] = sub ? x | top : x >> 1;
+            b->dot_limbs[i] = y >> 1;
+        }
+    }
+    if (sub && limbs > 0)
+    {
+        // A killing top limb keeps a above b, so dot_sub_n subtracts in the order the pattern was built for
+        a->dot_limbs[limbs - 1] = rng_next() | top;
+        b->dot_limbs[limbs - 1] = rng_next() >> 1;
+    }
+}
+
+static int compare_double(const void *x, const void *y)
+{
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+// Function to run count calls of func in the given mode, r/a/b hold THROUGHPUT_SETS operand sets
+static inline void run_batch(dot_operation_func func, bench_mode_t mode, dot_limb_t **r, dot_limb_t **a,
+                             dot_limb_t **b, long count)
+{
+    if (mode == MODE_LATENCY)
+    {
+        // The result overwrites the first operand, so every call waits for the previous one
+        for (long i = 0; i < count; i++)
+        {
+            func(a[0], a[0], b[0]);
+        }
+    }
+    else
+    {
+        for (long i = 0; i < count; i++)
+        {
+            unsigned k = (unsigned)i & (THROUGHPUT_SETS - 1);
+            func(r[k], a[k], b[k]);
+        }
+    }
+}
+
+// Function to time func on operands drawn from seed, in the carry pattern of result->density if set
+static void run_benchmark(const bench_config_t *config, dot_operation_func func, bool sub, int bits,
+                          bench_mode_t mode, bench_result_t *result)
+{
+    size_t limbs = ((size_t)bits + 63) / 64;
+    dot_limb_t *r[THROUGHPUT_SETS], *a[THROUGHPUT_SETS], *b[THROUGHPUT_SETS];
+
+    rng_state = config->seed ? config->seed : 1;
+    init_memory_pool();
+    for (int k = 0; k < THROUGHPUT_SETS; k++)
+    {
+        r[k] = random_operand(limbs);
+        a[k] = random_operand(limbs);
+        b[k] = random_operand(limbs);
+        if (result->density != NULL)
+        {
+            density_operands(a[k], b[k], limbs, result->density, sub);
+        }
+    }
+
+    run_batch(func, mode, r, a, b, config->warmup);
+
+    // Size the batch once, so every trial times the same number of calls
+    long reps = 1;
+    for (;;)
+    {
+        unsigned long long t0 = measure_rdtsc_start();
+        run_batch(func, mode, r, a, b, reps);
+        unsigned long long t1 = measure_rdtscp_end();
+        if (t1 - t0 >= MIN_BATCH_TICKS)
+        {
+            break;
+        }
+        reps <<= 1;
+    }
+
+    double *ticks = (double *)malloc(config->trials * sizeof(double));
+    double *ns = (double *)malloc(config->trials * sizeof(double));
+    if (ticks == NULL || ns == NULL)
+    {
+        perror("Memory allocation failed for samples\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < config->trials; t++)
+    {
+        struct timespec ts0 = get_timespec();
+        unsigned long long t0 = measure_rdtsc_start();
+        run_batch(func, mode, r, a, b, reps);
+        unsigned long long t1 = measure_rdtscp_end();
+        struct timespec ts1 = get_timespec();
+        ticks[t] = (double)(t1 - t0 - tsc_overhead) / reps;
+        ns[t] = ((ts1.tv_sec - ts0.tv_sec) * 1e9 + (ts1.tv_nsec - ts0.tv_nsec)) / reps;
+    }
+
+    double sum = 0, sum_sq = 0;
+    for (int t = 0; t < config->trials; t++)
+    {
+        sum += ticks[t];
+    }
+    double mean = sum / config->trials;
+    for (int t = 0; t < config->trials; t++)
+    {
+        sum_sq += (ticks[t] - mean) * (ticks[t] - mean);
+    }
+    qsort(ticks, config->trials, sizeof(double), compare_double);
+    qsort(ns, config->trials, sizeof(double), compare_double);
+
+    int p99 = (int)ceil(0.99 * config->trials) - 1;
+    result->bits = bits;
+    result->limbs = limbs;
+    result->mode = mode;
+    result->trials = config->trials;
+    result->reps = reps;
+    result->min = ticks[0];
+    result->median = ticks[config->trials / 2];
+    result->mean = mean;
+    result->p99 = ticks[p99 < 0 ? 0 : p99];
+    result->stddev = config->trials > 1 ? sqrt(sum_sq / (config->trials - 1)) : 0;
+    result->median_ns = ns[config->trials / 2];
+
+    if (result->hist != NULL && mode == MODE_LATENCY)
+    {
+        HIST_RDTSC(result->hist, config->hist_calls, func(a[0], a[0], b[0]));
+    }
+
+    free(ticks);
+    free(ns);
+    destroy_memory_pool();
+}
+
+// Function to get the CPU brand string, for telling hosts apart in the output
+static void cpu_brand(char brand[49])
+{
+    unsigned regs[12];
+    memset(brand, 0, 49);
+    if (__get_cpuid_max(0x80000000, NULL) < 0x80000004)
+    {
+        strcpy(brand, "unknown");
+        return;
+    }
+    for (unsigned i = 0; i < 3; i++)
+    {
+        __get_cpuid(0x80000002 + i, &regs[4 * i], &regs[4 * i + 1], &regs[4 * i + 2], &regs[4 * i + 3]);
+    }
+    memcpy(brand, regs, 48);
+    // Drop the padding some vendors put in front
+    char *start = brand;
+    while (*start == ' ')
+    {
+        start++;
+    }
+    memmove(brand, start, strlen(start) + 1);
+}
+
+static void print_header(FILE *out, const bench_config_t *config)
+{
+    char brand[49];
+    struct utsname host;
+    cpu_brand(brand);
+    uname(&host);
+
+    if (config->format == FORMAT_JSON)
+    {
+        fprintf(out, "{\n  \"host\": \"%s\",\n  \"cpu\": \"%s\",\n", host.nodename, brand);
+        fprintf(out, "  \"seed\": %llu,\n  \"trials\": %d,\n  \"warmup\": %d,\n  \"unit\": \"ticks\",\n",
+                (unsigned long long)config->seed, config->trials, config->warmup);
+        fprintf(out, "  \"tsc_ghz\": %.4f,\n  \"tsc_source\": \"%s\",\n  \"overhead_ticks\": %llu,\n", tsc_ghz,
+                tsc_source, tsc_overhead);
+        fprintf(out, "  \"results\": [");
+    }
+    else if (config->format == FORMAT_CSV)
+    {
+        fprintf(out, "op,bits,limbs,mode,trials,reps,min,median,mean,p99,stddev,median_ns,median_per_limb,"
+                     "baseline,baseline_median,speedup,hist_calls,hist_p50,hist_p90,hist_p99,hist_p999,hist_max,"
+                     "carry_gen,carry_prop,run_len\n");
+    }
+    else
+    {
+        fprintf(out, "# %s, %s, seed %llu, %d trials, %d warm-up calls, times in TSC ticks per call\n",
+                host.nodename, brand, (unsigned long long)config->seed, config->trials, config->warmup);
+        fprintf(out, "# TSC %.4f GHz (%s), %llu ticks of measurement overhead subtracted\n", tsc_ghz, tsc_source,
+                tsc_overhead);
+        fprintf(out, "%-16s %7s %6s %-10s %10s %10s %10s %10s %9s %10s %9s %-10s %10s %8s\n", "op", "bits",
+                "limbs", "mode", "min", "median", "mean", "p99", "stddev", "median_ns", "per_limb", "baseline",
+                "median", "speedup");
+    }
+}
+
+static void print_result(FILE *out, const bench_config_t *config, const bench_result_t *r, bool first)
+{
+    double per_limb = r->median / r->limbs;
+    if (config->format == FORMAT_JSON)
+    {
+        fprintf(out, "%s\n    {\"op\": \"%s\", \"bits\": %d, \"limbs\": %zu, \"mode\": \"%s\", \"trials\": %d, "
+                     "\"reps\": %ld, \"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"p99\": %.3f, "
+                     "\"stddev\": %.3f, \"median_ns\": %.3f, \"median_per_limb\": %.4f",
+                first ? "" : ",", r->op, r->bits, r->limbs, MODE_NAMES[r->mode], r->trials, r->reps, r->min,
+                r->median, r->mean, r->p99, r->stddev, r->median_ns, per_limb);
+        if (r->baseline != NULL)
+        {
+            fprintf(out, ", \"baseline\": \"%s\", \"baseline_median\": %.3f, \"speedup\": %.3f", r->baseline,
+                    r->baseline_median, r->speedup);
+        }
+        if (r->hist != NULL)
+        {
+            // Percentiles, then the non-empty buckets as [lowest value, count]
+            fprintf(out, ", \"hist\": {\"calls\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, "
+                         "\"p999\": %llu, \"max\": %llu, \"buckets\": [",
+                    (unsigned long long)r->hist->total, (unsigned long long)hist_percentile(r->hist, 50),
+                    (unsigned long long)hist_percentile(r->hist, 90), (unsigned long long)hist_percentile(r->hist, 99),
+                    (unsigned long long)hist_percentile(r->hist, 99.9), (unsigned long long)r->hist->max);
+            bool first_bucket = true;
+            for (int i = 0; i < HIST_BUCKETS; i++)
+            {
+                if (r->hist->counts[i] != 0)
+                {
+                    fprintf(out, "%s[%llu, %llu]", first_bucket ? "" : ", ", (unsigned long long)hist_bucket_low(i),
+                            (unsigned long long)r->hist->counts[i]);
+                    first_bucket = false;
+                }
+            }
+            fprintf(out, "]}");
+        }
+        if (r->density != NULL)
+        {
+            fprintf(out, ", \"carry_gen\": %.3f, \"carry_prop\": %.3f, \"run_len\": %d", r->density->gen,
+                    r->density->prop, r->density->run);
+        }
+        fprintf(out, "}");
+    }
+    else if (config->format == FORMAT_CSV)
+    {
+        fprintf(out, "%s,%d,%zu,%s,%d,%ld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f,", r->op, r->bits, r->limbs,
+                MODE_NAMES[r->mode], r->trials, r->reps, r->min, r->median, r->mean, r->p99, r->stddev,
+                r->median_ns, per_limb);
+        if (r->baseline != NULL)
+        {
+            fprintf(out, "%s,%.3f,%.3f,", r->baseline, r->baseline_median, r->speedup);
+        }
+        else
+        {
+            fprintf(out, ",,,");
+        }
+        if (r->hist != NULL)
+        {
+            fprintf(out, "%llu,%llu,%llu,%llu,%llu,%llu,", (unsigned long long)r->hist->total,
+                    (unsigned long long)hist_percentile(r->hist, 50), (unsigned long long)hist_percentile(r->hist, 90),
+                    (unsigned long long)hist_percentile(r->hist, 99), (unsigned long long)hist_percentile(r->hist, 99.9),
+                    (unsigned long long)r->hist->max);
+        }
+        else
+        {
+            fprintf(out, ",,,,,,");
+        }
+        if (r->density != NULL)
+        {
+            fprintf(out, "%.3f,%.3f,%d\n", r->density->gen, r->density->prop, r->density->run);
+        }
+        else
+        {
+            fprintf(out, ",,\n");
+        }
+    }
+    else
+    {
+        fprintf(out, "%-16s %7d %6zu %-10s %10.1f %10.1f %10.1f %10.1f %9.2f %10.1f %9.3f", r->op, r->bits,
+                r->limbs, MODE_NAMES[r->mode], r->min, r->median, r->mean, r->p99, r->stddev, r->median_ns,
+                per_limb);
+        if (r->baseline != NULL)
+        {
+            fprintf(out, " %-10s %10.1f %7.2fx", r->baseline, r->baseline_median, r->speedup);
+        }
+        if (r->density != NULL)
+        {
+            fprintf(out, "  gen %.2f prop %.2f run %d", r->density->gen, r->density->prop, r->density->run);
+        }
+        fprintf(out, "\n");
+        if (r->hist != NULL)
+        {
+            fprintf(out, "%-16s single calls: %llu, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n", "",
+                    (unsigned long long)r->hist->total, (unsigned long long)hist_percentile(r->hist, 50),
+                    (unsigned long long)hist_percentile(r->hist, 90), (unsigned long long)hist_percentile(r->hist, 99),
+                    (unsigned long long)hist_percentile(r->hist, 99.9), (unsigned long long)r->hist->max);
+        }
+    }
+    fflush(out);
+}
+
+static void print_footer(FILE *out, const bench_config_t *config)
+{
+    if (config->format == FORMAT_JSON)
+    {
+        fprintf(out, "\n  ]\n}\n");
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-o ops] [-b bits] [-m mode] [-t trials] [-w warmup] [-s seed] [-f format] [-O file] [-G] [-H calls] [-C gen,prop,run] [-S]\n", prog);
+    fprintf(stderr, "  -o ops     comma-separated kernels: dot_add,dot_sub,dot_add_approx,dot_sub_approx,\n"
+                    "             dot_add_jit,dot_sub_jit or all (default)\n");
+    fprintf(stderr, "  -b bits    comma-separated operand sizes in bits (default 256,512,...,131072)\n");
+    fprintf(stderr, "  -m mode    latency, throughput or both (default)\n");
+    fprintf(stderr, "  -t trials  timed batches per measurement (default %d)\n", DEFAULT_TRIALS);
+    fprintf(stderr, "  -w warmup  untimed calls before timing (default %d)\n", DEFAULT_WARMUP);
+    fprintf(stderr, "  -s seed    operand seed (default 1)\n");
+    fprintf(stderr, "  -f format  text (default), csv or json\n");
+    fprintf(stderr, "  -O file    write the results to file instead of stdout\n");
+    fprintf(stderr, "  -G         skip the GMP baseline\n");
+    fprintf(stderr, "  -H calls   also time this many single calls into a latency histogram (latency mode)\n");
+    fprintf(stderr, "  -C g,p,r   carry pattern: fraction of limbs propagating, in runs of r limbs, and fraction of the\n");
+    fprintf(stderr, "             others generating; may be repeated, throughput mode only\n");
+    fprintf(stderr, "  -S         sweep the carry pattern knobs one at a time around gen 0.25, prop 0.5, run 8\n");
+}
+
+static void parse_ops(bench_config_t *config, char *list)
+{
+    memset(config->ops, 0, sizeof(config->ops));
+    for (char *name = strtok(list, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        bool found = false;
+        for (int op = 0; op < NUM_OPERATIONS; op++)
+        {
+            if (strcmp(name, "all") == 0 || strcmp(name, OPERATIONS[op].name) == 0)
+            {
+                config->ops[op] = true;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            fprintf(stderr, "Unknown operation: %s\n", name);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void add_density(bench_config_t *config, const bench_density_t *density)
+{
+    if (config->num_densities == MAX_DENSITIES || density->gen < 0 || density->gen > 1 ||
+        density->prop < 0 || density->prop > 1 || density->run <= 0)
+    {
+        fprintf(stderr, "Invalid carry pattern: gen %g, prop %g, run %d\n", density->gen, density->prop, density->run);
+        exit(EXIT_FAILURE);
+    }
+    config->densities[config->num_densities++] = *density;
+}
+
+static void parse_bits(bench_config_t *config, char *list)
+{
+    config->num_bits = 0;
+    for (char *size = strtok(list, ","); size != NULL; size = strtok(NULL, ","))
+    {
+        int bits = atoi(size);
+        if (bits <= 0 || config->num_bits == MAX_SIZES)
+        {
+            fprintf(stderr, "Invalid size list at: %s\n", size);
+            exit(EXIT_FAILURE);
+        }
+        config->bits[config->num_bits++] = bits;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench_config_t config = {.trials = DEFAULT_TRIALS, .warmup = DEFAULT_WARMUP, .seed = 1, .baseline = true,
+                             .format = FORMAT_TEXT};
+    for (int op = 0; op < NUM_OPERATIONS; op++)
+    {
+        config.ops[op] = true;
+    }
+    config.modes[MODE_LATENCY] = config.modes[MODE_THROUGHPUT] = true;
+    for (int bits = 256; bits <= 131072; bits <<= 1)
+    {
+        config.bits[config.num_bits++] = bits;
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:b:m:t:w:s:f:O:GH:C:Sh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o':
+            parse_ops(&config, optarg);
+            break;
+        case 'b':
+            parse_bits(&config, optarg);
+            break;
+        case 'm':
+            config.modes[MODE_LATENCY] = strcmp(optarg, "latency") == 0 || strcmp(optarg, "both") == 0;
+            config.modes[MODE_THROUGHPUT] = strcmp(optarg, "throughput") == 0 || strcmp(optarg, "both") == 0;
+            break;
+        case 't':
+            config.trials = atoi(optarg);
+            break;
+        case 'w':
+            config.warmup = atoi(optarg);
+            break;
+        case 's':
+            config.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'f':
+            config.format = strcmp(optarg, "json") == 0 ? FORMAT_JSON : (strcmp(optarg, "csv") == 0 ? FORMAT_CSV : FORMAT_TEXT);
+            break;
+        case 'O':
+            config.output = optarg;
+            break;
+        case 'G':
+            config.baseline = false;
+            break;
+        case 'H':
+            config.hist_calls = atol(optarg);
+            break;
+        case 'C':
+        {
+            bench_density_t density;
+            if (sscanf(optarg, "%lf,%lf,%d", &density.gen, &density.prop, &density.run) != 3)
+            {
+                fprintf(stderr, "Invalid carry pattern: %s, expected gen,prop,run\n", optarg);
+                return EXIT_FAILURE;
+            }
+            add_density(&config, &density);
+            break;
+        }
+        case 'S':
+            for (int d = 0; d < NUM_DENSITY_SWEEP; d++)
+            {
+                add_density(&config, &DENSITY_SWEEP[d]);
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (config.trials <= 0 || config.warmup < 0 || config.hist_calls < 0 || (!config.modes[MODE_LATENCY] && !config.modes[MODE_THROUGHPUT]))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (config.num_densities > 0)
+    {
+        if (!config.modes[MODE_THROUGHPUT])
+        {
+            fprintf(stderr, "Carry patterns are measured in throughput mode only\n");
+            return EXIT_FAILURE;
+        }
+        config.modes[MODE_LATENCY] = false;
+    }
+
+    FILE *out = stdout;
+    if (config.output != NULL && (out = fopen(config.output, "w")) == NULL)
+    {
+        fprintf(stderr, "Error opening file %s: %s\n", config.output, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    calibrate_tsc();
+
+    // The same seed gives the same operands for every kernel and size, across builds and hosts
+    bool first = true;
+    print_header(out, &config);
+    for (int op = 0; op < NUM_OPERATIONS; op++)
+    {
+        if (!config.ops[op])
+        {
+            continue;
+        }
+        for (int s = 0; s < config.num_bits; s++)
+        {
+            // One pass with uniform operands, or one per carry pattern
+            for (int d = 0; d < (config.num_densities > 0 ? config.num_densities : 1); d++)
+            {
+                const bench_density_t *density = config.num_densities > 0 ? &config.densities[d] : NULL;
+                for (int mode = 0; mode < NUM_MODES; mode++)
+                {
+                    if (!config.modes[mode])
+                    {
+                        continue;
+                    }
+                    bench_result_t result = {.op = OPERATIONS[op].name, .density = density};
+                    if (config.hist_calls > 0 && mode == MODE_LATENCY)
+                    {
+                        if ((result.hist = (latency_hist_t *)malloc(sizeof(latency_hist_t))) == NULL)
+                        {
+                            perror("Memory allocation failed for the histogram\n");
+                            exit(EXIT_FAILURE);
+                        }
+                        hist_init(result.hist);
+                    }
+                    dot_operation_func func = OPERATIONS[op].func;
+                    if (OPERATIONS[op].jit)
+                    {
+                        // Generated once per size outside the timed loop, dot_add_n/dot_sub_n if it fails
+                        size_t limbs = ((size_t)config.bits[s] + 63) / 64;
+                        dot_jit_func_t jit = dot_jit_get(OPERATIONS[op].sub ? DOT_JIT_SUB : DOT_JIT_ADD, limbs);
+                        func = jit != NULL ? jit : func;
+                    }
+                    run_benchmark(&config, func, OPERATIONS[op].sub, config.bits[s],
+                                  (bench_mode_t)mode, &result);
+                    if (config.baseline)
+                    {
+                        bench_result_t baseline = {.density = density};
+                        run_benchmark(&config, OPERATIONS[op].baseline, OPERATIONS[op].sub, config.bits[s],
+                                      (bench_mode_t)mode, &baseline);
+                        result.baseline = OPERATIONS[op].baseline_name;
+                        result.baseline_median = baseline.median;
+                        result.speedup = baseline.median / result.median;
+                    }
+                    print_result(out, &config, &result, first);
+                    first = false;
+                    free(result.hist);
+                }
+            }
+        }
+    }
+    print_footer(out, &config);
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return EXIT_SUCCESS;
+}
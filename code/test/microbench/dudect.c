@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "dotlib.h"
+#include "timing_utils.h"
+
+/*
+    dudect-style leakage test of the constant-time kernels, next to the exact kernels they replace.
+
+    Every call is timed on its own, with operands of one of two classes picked at random: a fixed class that
+    sends the exact kernels down their data-dependent paths (carries rippling through every chunk, operands
+    equal to the last limb for the magnitude compare) and a class of uniformly random operands. Both classes
+    are copied into the same buffers by the same code just before the call, so they start from the same cache
+    and predictor state. A Welch t-test then compares the two timing distributions, on the raw times and on
+    times cropped at a range of percentiles, which drops the interrupts and migrations that would otherwise
+    hide a small difference.
+
+    A |t| above T_THRESHOLD means the classes are told apart by timing. The exact kernels are expected to
+    cross it, the _ct kernels must not: the exit status is non-zero if one does. Between T_NOISE and
+    T_THRESHOLD the result is reported as inconclusive, the level that noise alone reaches on a busy or
+    virtualised host over the 17 tests. The first batch only sets the crop percentiles, as in dudect.
+*/
+
+#define DEFAULT_LIMBS 64            // Operand size, enough chunks for a ripple to show
+#define DEFAULT_MEASUREMENTS 400000 // Timed calls per kernel, both classes together
+#define BATCH 10000                 // Calls between two updates of the statistics
+#define NUM_CROPS 16                // Percentile crops tested besides the raw times
+#define T_NOISE 4.5                 // |t| below which nothing is seen
+#define T_THRESHOLD 10              // |t| from which the two classes count as distinguishable, dudect's level
+
+typedef enum
+{
+    KIND_ADD = 0, // Fixed class a = 2^64n - 1, b = 1, the carry ripples through every limb
+    KIND_SUB_NC,  // Fixed class x = 0, y = 1, the borrow ripples through every limb
+    KIND_SUB_N,   // Fixed class x = y, the magnitude compare walks every limb
+} dudect_kind_t;
+
+typedef struct
+{
+    const char *name;
+    dudect_kind_t kind;
+    bool ct; // Must not leak
+    void (*run)(dot_limb_t *, dot_limb_t *, dot_limb_t *);
+} dudect_kernel_t;
+
+static void run_add_nc(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    result->carry = dot_add_nc(result->dot_limbs, a->dot_limbs, b->dot_limbs, a->size, 0);
+}
+
+static void run_sub_nc(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    result->carry = dot_sub_nc(result->dot_limbs, a->dot_limbs, b->dot_limbs, a->size, 0);
+}
+
+static void run_add_nc_ct(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    result->carry = dot_add_nc_ct(result->dot_limbs, a->dot_limbs, b->dot_limbs, a->size, 0);
+}
+
+static void run_sub_nc_ct(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b)
+{
+    result->carry = dot_sub_nc_ct(result->dot_limbs, a->dot_limbs, b->dot_limbs, a->size, 0);
+}
+
+static const dudect_kernel_t KERNELS[] = {
+    {"dot_add_nc", KIND_ADD, false, run_add_nc},
+    {"dot_add_nc_ct", KIND_ADD, true, run_add_nc_ct},
+    {"dot_sub_nc", KIND_SUB_NC, false, run_sub_nc},
+    {"dot_sub_nc_ct", KIND_SUB_NC, true, run_sub_nc_ct},
+    {"dot_add_n", KIND_ADD, false, dot_add_n},
+    {"dot_add_n_ct", KIND_ADD, true, dot_add_n_ct},
+    {"dot_sub_n", KIND_SUB_N, false, dot_sub_n},
+    {"dot_sub_n_ct", KIND_SUB_N, true, dot_sub_n_ct},
+};
+
+#define NUM_KERNELS (int)(sizeof(KERNELS) / sizeof(KERNELS[0]))
+
+// Running mean and variance of one class (Welford)
+typedef struct
+{
+    double n;
+    double mean;
+    double m2;
+} welford_t;
+
+// One t-test: both classes, on the times below a crop
+typedef struct
+{
+    welford_t cls[2];
+} ttest_t;
+
+static uint64_t rng_state;
+
+// Function to get the next pseudo-random 64-bit value (xorshift64*)
+static inline uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void welford_push(welford_t *w, double x)
+{
+    w->n++;
+    double delta = x - w->mean;
+    w->mean += delta / w->n;
+    w->m2 += delta * (x - w->mean);
+}
+
+// Function to get Welch's t of a test, 0 until both classes have two samples
+static double welch_t(const ttest_t *t)
+{
+    const welford_t *x = &t->cls[0], *y = &t->cls[1];
+    if (x->n < 2 || y->n < 2)
+    {
+        return 0;
+    }
+    double se = sqrt(x->m2 / (x->n - 1) / x->n + y->m2 / (y->n - 1) / y->n);
+    return se > 0 ? (x->mean - y->mean) / se : 0;
+}
+
+static int compare_ticks(const void *x, const void *y)
+{
+    uint64_t a = *(const uint64_t *)x, b = *(const uint64_t *)y;
+    return (a > b) - (a < b);
+}
+
+// Function to build the fixed operands of kind
+static void fixed_class(dudect_kind_t kind, uint64_t *a, uint64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (kind == KIND_ADD)
+        {
+            a[i] = ~0ULL;
+            b[i] = i == 0;
+        }
+        else if (kind == KIND_SUB_NC)
+        {
+            a[i] = 0;
+            b[i] = i == 0;
+        }
+        else
+        {
+            a[i] = b[i] = rng_next();
+        }
+    }
+}
+
+// Function to run the test on one kernel, returns the largest |t| and stores where it was found
+static double test_kernel(const dudect_kernel_t *kernel, size_t limbs, long measurements, int *worst, double means[2])
+{
+    dot_limb_t *a = dot_limb_t_alloc(limbs), *b = dot_limb_t_alloc(limbs), *r = dot_limb_t_alloc(limbs + 1);
+    uint64_t *operands = (uint64_t *)malloc(4 * limbs * sizeof(uint64_t));
+    uint64_t *ticks = (uint64_t *)malloc(BATCH * sizeof(uint64_t));
+    uint64_t *sorted = (uint64_t *)malloc(BATCH * sizeof(uint64_t));
+    unsigned char *classes = (unsigned char *)malloc(BATCH);
+    if (a == NULL || b == NULL || r == NULL || operands == NULL || ticks == NULL || sorted == NULL || classes == NULL)
+    {
+        perror("Memory allocation failed for the measurements\n");
+        exit(EXIT_FAILURE);
+    }
+    a->size = b->size = a->used = b->used = limbs;
+
+    // The operands of each call are copied from the fixed pair or from a random pair drawn for every call of
+    // both classes, so the code run before the kernel is the same whatever the class
+    const uint64_t *source[2][2] = {{operands, operands + limbs}, {operands + 2 * limbs, operands + 3 * limbs}};
+    fixed_class(kernel->kind, operands, operands + limbs, limbs);
+
+    ttest_t tests[NUM_CROPS + 1];
+    uint64_t crops[NUM_CROPS];
+    memset(tests, 0, sizeof(tests));
+
+    long batches = (measurements + BATCH - 1) / BATCH;
+    for (long batch = 0; batch <= batches; batch++)
+    {
+        for (int i = 0; i < BATCH; i++)
+        {
+            classes[i] = rng_next() & 1;
+        }
+        for (int i = 0; i < BATCH; i++)
+        {
+            for (size_t j = 0; j < 2 * limbs; j++)
+            {
+                operands[2 * limbs + j] = rng_next();
+            }
+            memcpy(a->dot_limbs, source[classes[i]][0], limbs * sizeof(uint64_t));
+            memcpy(b->dot_limbs, source[classes[i]][1], limbs * sizeof(uint64_t));
+            unsigned long long start = measure_rdtsc_start();
+            kernel->run(r, a, b);
+            unsigned long long end = measure_rdtscp_end();
+            ticks[i] = end - start;
+        }
+
+        if (batch == 0)
+        {
+            // Crops at 1 - 2^(-10 (c + 1) / NUM_CROPS), dense towards the tail like dudect's
+            memcpy(sorted, ticks, BATCH * sizeof(uint64_t));
+            qsort(sorted, BATCH, sizeof(uint64_t), compare_ticks);
+            for (int c = 0; c < NUM_CROPS; c++)
+            {
+                double p = 1 - pow(0.5, 10.0 * (c + 1) / NUM_CROPS);
+                crops[c] = sorted[(size_t)(p * (BATCH - 1))];
+            }
+            continue;
+        }
+        for (int i = 0; i < BATCH; i++)
+        {
+            welford_push(&tests[0].cls[classes[i]], (double)ticks[i]);
+            for (int c = 0; c < NUM_CROPS; c++)
+            {
+                if (ticks[i] < crops[c])
+                {
+                    welford_push(&tests[c + 1].cls[classes[i]], (double)ticks[i]);
+                }
+            }
+        }
+    }
+
+    double max_t = 0;
+    *worst = 0;
+    for (int c = 0; c <= NUM_CROPS; c++)
+    {
+        double t = fabs(welch_t(&tests[c]));
+        if (t > max_t)
+        {
+            max_t = t;
+            *worst = c;
+        }
+    }
+    means[0] = tests[0].cls[0].mean;
+    means[1] = tests[0].cls[1].mean;
+
+    dot_limb_t_free(a);
+    dot_limb_t_free(b);
+    dot_limb_t_free(r);
+    free(operands);
+    free(ticks);
+    free(sorted);
+    free(classes);
+    return max_t;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-n limbs] [-m measurements] [-s seed] [-k kernel]\n", prog);
+    fprintf(stderr, "  -n limbs         operand size in limbs (default %d)\n", DEFAULT_LIMBS);
+    fprintf(stderr, "  -m measurements  timed calls per kernel (default %d)\n", DEFAULT_MEASUREMENTS);
+    fprintf(stderr, "  -s seed          operand and class seed (default 1)\n");
+    fprintf(stderr, "  -k kernel        test only this kernel, may be repeated (default all)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t limbs = DEFAULT_LIMBS;
+    long measurements = DEFAULT_MEASUREMENTS;
+    uint64_t seed = 1;
+    bool selected[NUM_KERNELS] = {false};
+    bool any = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:s:k:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            limbs = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            measurements = atol(optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'k':
+        {
+            bool found = false;
+            for (int k = 0; k < NUM_KERNELS; k++)
+            {
+                if (strcmp(optarg, KERNELS[k].name) == 0)
+                {
+                    selected[k] = found = any = true;
+                }
+            }
+            if (!found)
+            {
+                fprintf(stderr, "Unknown kernel: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (limbs == 0 || measurements <= 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    rng_state = seed ? seed : 1;
+
+    printf("%zu limbs, %ld measurements per kernel, |t| > %.1f leaks\n", limbs, measurements, (double)T_THRESHOLD);
+    printf("%-14s %12s %12s %8s %6s  %s\n", "kernel", "fixed_ticks", "random_ticks", "max_t", "crop", "verdict");
+    bool failed = false;
+    for (int k = 0; k < NUM_KERNELS; k++)
+    {
+        if (any && !selected[k])
+        {
+            continue;
+        }
+        int worst;
+        double means[2];
+        double t = test_kernel(&KERNELS[k], limbs, measurements, &worst, means);
+        bool leaks = t > T_THRESHOLD;
+        printf("%-14s %12.1f %12.1f %8.2f %6d  %s\n", KERNELS[k].name, means[0], means[1], t, worst,
+               leaks ? "leaks" : (t > T_NOISE ? "inconclusive" : "no leak found"));
+        failed |= leaks && KERNELS[k].ct;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
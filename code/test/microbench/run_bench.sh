@@ -0,0 +1,13 @@
+#!/bin/bash
+
+# Compile bench.c against the installed libdot
+gcc -O2 bench.c -o bench -ldot -lgmp -lz -lm -I../../utils/
+
+# Pinned to one core, results go to bench_results.json unless a file is given
+output=${1:-bench_results.json}
+taskset -c 0 ./bench -f json -O "$output" "${@:2}"
+if [ $? -ne 0 ]; then
+    echo "Benchmark failed"
+    exit 1
+fi
+echo "Results written to $output"
@@ -14,6 +14,7 @@
 #define RANDOM_ITERATIONS 100000 // Number of random test cases
 #define SPECIAL_ITERATIONS 1000  // Number of special test cases
 #define CHUNK 655360             // Chunk size for reading the file
+#define CORPUS_PASSES 5          // Sweeps over the corpus, every case keeps its median time
 int CORE_NO = 0;                 // CPU core number for performance measurement
 
 // Function to trim leading zeros and whitespace characters
@@ -171,7 +172,11 @@ void run_perf_test(int op, int NUM_BITS, int test_case_type)
 
     read_perf(values);
 
-    printf("User instructions: %lld\n", values[0] - values_overhead[0]);
+    for (int i = 0; i < num_events; i++)
+    {
+        values[i] -= values_overhead[i];
+    }
+    print_perf(stdout, values, n);
 
     func(s, a, b);
 
@@ -315,15 +320,200 @@ void run_timing_test(int op, int NUM_BITS, int test_case_type)
     gzclose(test_file);
 }
 
+// Test cases of one file, loaded up front with a result sized for each
+typedef struct
+{
+    dot_limb_t **a;
+    dot_limb_t **b;
+    dot_limb_t **s;
+    int count;
+} corpus_t;
+
+static int compare_double(const void *x, const void *y)
+{
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+// Function to load a whole case file, or a sample of sample cases spread evenly over it when sample > 0
+void load_corpus(int op, int NUM_BITS, int case_type, int sample, corpus_t *corpus)
+{
+    char test_filename[100];
+    const char *file_type = (case_type == 0) ? "random" : "special";
+    snprintf(test_filename, sizeof(test_filename), "../correctness/cases/%s/%d/%s.csv.gz",
+             op % 2 ? "sub" : "add", NUM_BITS, file_type);
+
+    gzFile test_file = open_gzfile(test_filename, "rb");
+    char *buffer = (char *)malloc(CHUNK);
+    if (buffer == NULL)
+    {
+        perror("Memory allocation failed for the line buffer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Count the cases first, so a sample can take every k-th one
+    skip_first_line(test_file);
+    int total = 0;
+    while (gzgets(test_file, buffer, CHUNK) != NULL)
+    {
+        total++;
+    }
+    int stride = (sample > 0 && sample < total) ? (total + sample - 1) / sample : 1;
+    gzrewind(test_file);
+    skip_first_line(test_file);
+
+    corpus->count = 0;
+    corpus->a = (dot_limb_t **)malloc(((total + stride - 1) / stride + 1) * sizeof(dot_limb_t *));
+    corpus->b = (dot_limb_t **)malloc(((total + stride - 1) / stride + 1) * sizeof(dot_limb_t *));
+    corpus->s = (dot_limb_t **)malloc(((total + stride - 1) / stride + 1) * sizeof(dot_limb_t *));
+    if (corpus->a == NULL || corpus->b == NULL || corpus->s == NULL)
+    {
+        perror("Memory allocation failed for the corpus\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < total && gzgets(test_file, buffer, CHUNK) != NULL; i++)
+    {
+        if (i % stride != 0)
+        {
+            continue;
+        }
+        char *a_str = strtok(buffer, ",");
+        char *b_str = strtok(NULL, ",");
+        if (a_str == NULL || b_str == NULL)
+        {
+            fprintf(stderr, "Error parsing line: %s\n", buffer);
+            gzclose(test_file);
+            exit(EXIT_FAILURE);
+        }
+        dot_limb_t *a = dot_limb_set_str(a_str);
+        dot_limb_t *b = dot_limb_set_str(b_str);
+        dot_limb_t_adjust_sizes(a, b);
+        corpus->a[corpus->count] = a;
+        corpus->b[corpus->count] = b;
+        corpus->s[corpus->count] = dot_limb_t_alloc(a->size);
+        corpus->count++;
+    }
+
+    free(buffer);
+    gzclose(test_file);
+}
+
+// Function to free the cases and results of a corpus
+void free_corpus(corpus_t *corpus)
+{
+    for (int i = 0; i < corpus->count; i++)
+    {
+        dot_limb_t_free(corpus->a[i]);
+        dot_limb_t_free(corpus->b[i]);
+        dot_limb_t_free(corpus->s[i]);
+    }
+    free(corpus->a);
+    free(corpus->b);
+    free(corpus->s);
+}
+
+/*
+    Times the kernel over a whole case file. One untimed and CORPUS_PASSES timed sweeps run the cases in file
+    order, one serialised call each, so the branch predictor sees the data of the corpus rather than one case
+    over and over; each case keeps the median of its passes, with the measurement overhead removed. A sweep
+    of back-to-back calls over all cases then gives the exact mean, which the per-case times only estimate.
+*/
+void run_corpus_test(int op, int NUM_BITS, int case_type, int sample)
+{
+    const char *file_type = (case_type == 0) ? "random" : "special";
+    printf("Running corpus test on %s test cases for %s with %d bits\n",
+           file_type, op <= 1 ? (op == 0 ? "addition" : "subtraction") : (op == 2 ? "approximated addition" : "approximated subtraction"), NUM_BITS);
+
+    init_memory_pool();
+    corpus_t corpus;
+    load_corpus(op, NUM_BITS, case_type, sample, &corpus);
+    if (corpus.count == 0)
+    {
+        fprintf(stderr, "No test cases found\n");
+        exit(EXIT_FAILURE);
+    }
+
+    typedef void (*dot_operation_func)(dot_limb_t *, dot_limb_t *, dot_limb_t *);
+    dot_operation_func func = op == 0 ? dot_add_n : (op == 1 ? dot_sub_n : (op == 2 ? dot_add_n_approx : dot_sub_n_approx));
+
+    // Every case writes its own result, so no resizing falls inside the timed calls or the sweep
+    double *samples = (double *)malloc((size_t)corpus.count * CORPUS_PASSES * sizeof(double));
+    double *per_limb = (double *)malloc((size_t)corpus.count * sizeof(double));
+    if (samples == NULL || per_limb == NULL)
+    {
+        perror("Memory allocation failed for the corpus samples\n");
+        exit(EXIT_FAILURE);
+    }
+    calibrate_tsc();
+
+    size_t total_limbs = 0;
+    for (int pass = -1; pass < CORPUS_PASSES; pass++)
+    {
+        for (int i = 0; i < corpus.count; i++)
+        {
+            unsigned long long t0 = measure_rdtsc_start();
+            func(corpus.s[i], corpus.a[i], corpus.b[i]);
+            unsigned long long t1 = measure_rdtscp_end();
+            if (pass >= 0)
+            {
+                double ticks = t1 - t0 > tsc_overhead ? (double)(t1 - t0 - tsc_overhead) : 0;
+                samples[(size_t)i * CORPUS_PASSES + pass] = ticks / corpus.a[i]->size;
+            }
+            else
+            {
+                total_limbs += corpus.a[i]->size;
+            }
+        }
+    }
+    for (int i = 0; i < corpus.count; i++)
+    {
+        qsort(samples + (size_t)i * CORPUS_PASSES, CORPUS_PASSES, sizeof(double), compare_double);
+        per_limb[i] = samples[(size_t)i * CORPUS_PASSES + CORPUS_PASSES / 2];
+    }
+
+    unsigned long long t0 = measure_rdtsc_start();
+    for (int i = 0; i < corpus.count; i++)
+    {
+        func(corpus.s[i], corpus.a[i], corpus.b[i]);
+    }
+    unsigned long long t1 = measure_rdtscp_end();
+
+    double sum = 0;
+    for (int i = 0; i < corpus.count; i++)
+    {
+        sum += per_limb[i];
+    }
+    qsort(per_limb, corpus.count, sizeof(double), compare_double);
+    double median = per_limb[corpus.count / 2];
+    int slow = 0;
+    for (int i = 0; i < corpus.count; i++)
+    {
+        slow += per_limb[i] > 2 * median;
+    }
+
+    printf("Cases: %d, %.1f limbs on average\n", corpus.count, (double)total_limbs / corpus.count);
+    printf("Sweep RDTSC Ticks per limb: %f\n", (double)(t1 - t0 - tsc_overhead) / total_limbs);
+    printf("Per-case RDTSC Ticks per limb: min %.3f, p10 %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f, mean %.3f\n",
+           per_limb[0], per_limb[corpus.count / 10], median, per_limb[(int)(corpus.count * 0.9)],
+           per_limb[(int)(corpus.count * 0.99)], per_limb[corpus.count - 1], sum / corpus.count);
+    printf("Cases above twice the median: %d (%.2f%%)\n", slow, 100.0 * slow / corpus.count);
+
+    free(samples);
+    free(per_limb);
+    free_corpus(&corpus);
+    destroy_memory_pool();
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 5)
+    if (argc != 5 && argc != 6)
     {
-        fprintf(stderr, "Usage: %s <operation> <number_of_bits> <test_type> <case_type>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <operation> <number_of_bits> <test_type> <case_type> [sample]\n", argv[0]);
         fprintf(stderr, "operation: 0 for addition, 1 for subtraction, 2 for approximated addition, 3 for approximated subtraction\n");
         fprintf(stderr, "number_of_bits: number of bits for the test case\n");
-        fprintf(stderr, "test_type: 0 for timing and throughput, 1 for user instructions and ticks\n");
-        fprintf(stderr, "case_type: 0 for random test cases, 1 for special test cases\n");
+        fprintf(stderr, "test_type: 0 for timing and throughput, 1 for hardware counters and ticks, 2 for the whole corpus\n");
+        fprintf(stderr, "case_type: 0 for random test cases, 1 for special test cases, 2 for both (corpus only)\n");
+        fprintf(stderr, "sample: corpus only, number of cases to load spread over the file (default all)\n");
         return EXIT_FAILURE;
     }
 
@@ -331,10 +521,11 @@ int main(int argc, char *argv[])
     int NUM_BITS = atoi(argv[2]);
     int test_type = atoi(argv[3]);
     int case_type = atoi(argv[4]);
+    int sample = argc == 6 ? atoi(argv[5]) : 0;
 
     assert(op >= 0 && op <= 3);
-    assert(test_type == 0 || test_type == 1);
-    assert(case_type == 0 || case_type == 1);
+    assert(test_type >= 0 && test_type <= 2);
+    assert(case_type == 0 || case_type == 1 || (test_type == 2 && case_type == 2));
     assert(NUM_BITS > 0 && NUM_BITS <= 131072);
 
     if (test_type == 0)
@@ -344,9 +535,22 @@ int main(int argc, char *argv[])
     }
     else if (test_type == 1)
     {
-        // Run the user instructions and ticks test
+        // Run the hardware counter and ticks test, PERF_RAW_EVENTS adds raw PMU events as NAME=CONFIG,...
+        perf_add_raw_events(getenv("PERF_RAW_EVENTS"));
         run_perf_test(op, NUM_BITS, case_type);
     }
+    else if (test_type == 2)
+    {
+        // Time the whole corpus, random and special cases reported apart
+        if (case_type != 1)
+        {
+            run_corpus_test(op, NUM_BITS, 0, sample);
+        }
+        if (case_type != 0)
+        {
+            run_corpus_test(op, NUM_BITS, 1, sample);
+        }
+    }
     else
     {
         fprintf(stderr, "Invalid test type: %d\n", test_type);
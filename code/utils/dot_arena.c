@@ -0,0 +1,136 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "dot_utils.h"
+#include "dot_ctx.h"
+
+/*
+    Stack-style arenas for short-lived memory.
+
+    An arena is a list of chunks with a bump pointer into the current one. dot_arena_mark records the
+    bump position and dot_arena_release rewinds to it in O(1), whatever was allocated in between. Chunks
+    past the mark are kept for reuse, so an arena used in a loop stops touching the system allocator
+    after the first iteration. Chunks come straight from the system, independently of the memory pool.
+*/
+
+#define ARENA_ALIGN 64                // Alignment of every arena allocation
+#define ARENA_CHUNK_SIZE (1 << 20)    // Default chunk size, 1 MB
+
+struct dot_arena_chunk
+{
+    struct dot_arena_chunk *next; // Next chunk, kept after a release for reuse
+    size_t capacity;              // Usable bytes after the header
+} __attribute__((aligned(ARENA_ALIGN)));
+
+// Function to get the start of the usable memory of a chunk
+static inline uint8_t *chunk_data(dot_arena_chunk_t *chunk)
+{
+    return (uint8_t *)(chunk + 1);
+}
+
+// Function to allocate a chunk that can hold at least size bytes
+static dot_arena_chunk_t *chunk_create(size_t size)
+{
+    size_t capacity = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    dot_arena_chunk_t *chunk = (dot_arena_chunk_t *)aligned_alloc(ARENA_ALIGN, sizeof(dot_arena_chunk_t) + capacity);
+    if (chunk == NULL)
+    {
+        perror("Memory allocation failed for arena chunk\n");
+        exit(EXIT_FAILURE);
+    }
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+void dot_arena_init(dot_arena_t *arena)
+{
+    arena->head = NULL;
+    arena->chunk = NULL;
+    arena->offset = 0;
+}
+
+void *dot_arena_alloc(dot_arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    // Fast path, bump inside the current chunk
+    dot_arena_chunk_t *chunk = arena->chunk;
+    if (likely(chunk != NULL && arena->offset + size <= chunk->capacity))
+    {
+        void *ptr = chunk_data(chunk) + arena->offset;
+        arena->offset += size;
+        return ptr;
+    }
+
+    // Move on to the next retained chunk if it is large enough, otherwise insert a new one
+    dot_arena_chunk_t *next = (chunk == NULL) ? arena->head : chunk->next;
+    if (next == NULL || next->capacity < size)
+    {
+        dot_arena_chunk_t *fresh = chunk_create(size);
+        fresh->next = next;
+        if (chunk == NULL)
+        {
+            arena->head = fresh;
+        }
+        else
+        {
+            chunk->next = fresh;
+        }
+        next = fresh;
+    }
+    arena->chunk = next;
+    arena->offset = size;
+    return chunk_data(next);
+}
+
+dot_arena_mark_t dot_arena_mark(const dot_arena_t *arena)
+{
+    dot_arena_mark_t mark = {arena->chunk, arena->offset};
+    return mark;
+}
+
+void dot_arena_release(dot_arena_t *arena, dot_arena_mark_t mark)
+{
+    arena->chunk = mark.chunk;
+    arena->offset = mark.offset;
+}
+
+void dot_arena_destroy(dot_arena_t *arena)
+{
+    dot_arena_chunk_t *chunk = arena->head;
+    while (chunk != NULL)
+    {
+        dot_arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    dot_arena_init(arena);
+}
+
+dot_arena_t *dot_scratch_arena(void)
+{
+    // The scratch arena lives in the context of the calling thread
+    return &__dot_ctx_current()->scratch;
+}
+
+dot_limb_t *dot_arena_limb_alloc(dot_arena_t *arena, size_t size)
+{
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    dot_limb_t *dot_limb = (dot_limb_t *)dot_arena_alloc(arena, sizeof(dot_limb_t));
+    dot_limb->dot_limbs = (uint64_t *)dot_arena_alloc(arena, size * sizeof(uint64_t));
+    dot_limb->size = size;
+    dot_limb->used = size;
+    dot_limb->alloc = size;
+    dot_limb->sign = false;
+    dot_limb->carry = false;
+    dot_limb->view = true; // The limbs belong to the arena, not the memory pool
+    return dot_limb;
+}
@@ -0,0 +1,127 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "dot_utils.h"
+#include "dot_ctx.h"
+
+/*
+    Library contexts.
+
+    Every thread gets a context of its own the first time it calls into the library, and that context is
+    destroyed when the thread exits. Threads therefore never share pools or scratch memory, and the only
+    cross-thread traffic is the lock-free remote free of dot_pool.c. A caller can create contexts itself
+    and switch between them with dot_ctx_set, for example to give a group of numbers its own pool options
+    or to free them all at once with dot_ctx_destroy.
+
+    Memory of a thread's own context is returned to the system when the thread exits. Numbers that must
+    outlive the thread that allocates them belong in a context created with dot_ctx_create.
+*/
+
+static pthread_key_t thread_ctx_key;                      // Destroys the thread's own context at thread exit
+static pthread_once_t thread_ctx_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local dot_ctx_t *thread_ctx = NULL;        // Context created for the calling thread
+static _Thread_local dot_ctx_t *current_ctx = NULL;       // Context the calling thread allocates from
+
+static void thread_ctx_exit(void *ctx)
+{
+    dot_ctx_destroy((dot_ctx_t *)ctx);
+}
+
+static void thread_ctx_key_create(void)
+{
+    if (pthread_key_create(&thread_ctx_key, thread_ctx_exit) != 0)
+    {
+        perror("Failed to create the thread context key\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+dot_ctx_t *dot_ctx_create(const dot_pool_options_t *options)
+{
+    dot_ctx_t *ctx = (dot_ctx_t *)calloc(1, sizeof(dot_ctx_t));
+    if (ctx == NULL)
+    {
+        perror("Memory allocation failed for dot_ctx_t\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options != NULL)
+    {
+        ctx->options = *options;
+    }
+    for (int node = 0; node < DOT_POOL_MAX_NODES; node++)
+    {
+        ctx->pools[node].ctx = ctx;
+    }
+    dot_arena_init(&ctx->scratch);
+    return ctx;
+}
+
+void dot_ctx_destroy(dot_ctx_t *ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+    __dot_pool_release(ctx);
+    dot_arena_destroy(&ctx->scratch);
+
+    if (current_ctx == ctx)
+    {
+        current_ctx = NULL;
+    }
+    if (thread_ctx == ctx)
+    {
+        // Destroyed explicitly, the thread gets a fresh context if it keeps going
+        thread_ctx = NULL;
+        pthread_setspecific(thread_ctx_key, NULL);
+    }
+    free(ctx);
+}
+
+dot_ctx_t *__dot_ctx_current(void)
+{
+    if (likely(current_ctx != NULL))
+    {
+        return current_ctx;
+    }
+    if (thread_ctx == NULL)
+    {
+        pthread_once(&thread_ctx_key_once, thread_ctx_key_create);
+        thread_ctx = dot_ctx_create(NULL);
+        pthread_setspecific(thread_ctx_key, thread_ctx);
+    }
+    current_ctx = thread_ctx;
+    return current_ctx;
+}
+
+dot_ctx_t *dot_ctx_get(void)
+{
+    return __dot_ctx_current();
+}
+
+void dot_ctx_set(dot_ctx_t *ctx)
+{
+    // NULL falls back to the thread's own context on the next call
+    current_ctx = ctx;
+}
+
+dot_stats_t *__dot_stats_current(void)
+{
+    return &__dot_ctx_current()->stats;
+}
+
+void dot_stats_get(dot_stats_t *stats)
+{
+    *stats = __dot_ctx_current()->stats;
+}
+
+void dot_stats_reset(void)
+{
+    dot_stats_t *stats = __dot_stats_current();
+    uint64_t pool_bytes = stats->pool_bytes;
+    memset(stats, 0, sizeof(*stats));
+    stats->pool_bytes = pool_bytes;
+    stats->pool_high_water = pool_bytes;
+}
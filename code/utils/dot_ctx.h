@@ -0,0 +1,60 @@
+#ifndef DOT_CTX_H
+#define DOT_CTX_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "dot_utils.h"
+
+/*
+    Internal layout of a library context. A context owns everything the library would otherwise keep in
+    mutable globals: the memory pools, the pool options and the scratch arena. Each thread works in its own
+    context (see dot_ctx.c), so the library is reentrant and needs no locks on its fast paths.
+*/
+
+#define DOT_POOL_NUM_CLASSES 14 // Size classes of the memory pool, 64 B, 128 B, ..., 512 KB
+
+struct dot_ctx;
+struct dot_slab;
+
+// Intrusive free-list node stored in the first bytes of a free block
+typedef struct dot_free_block
+{
+    struct dot_free_block *next;
+} dot_free_block_t;
+
+// Memory pool state, one per NUMA node in every context
+typedef struct dot_pool
+{
+    dot_free_block_t *free_list[DOT_POOL_NUM_CLASSES];              // Freed blocks of each class
+    _Atomic(dot_free_block_t *) remote_free[DOT_POOL_NUM_CLASSES]; // Blocks freed by other threads
+    uint8_t *carve_ptr[DOT_POOL_NUM_CLASSES];                       // Next never-used block of each class
+    uint8_t *carve_end[DOT_POOL_NUM_CLASSES];                       // End of the current slab of each class
+    struct dot_slab *slabs;                                         // All slabs, for destroy_memory_pool
+    _Atomic(struct dot_slab *) remote_large;                        // Large slabs freed by other threads
+    struct dot_ctx *ctx;                                            // Context owning the pool
+} dot_pool_t;
+
+struct dot_ctx
+{
+    dot_pool_options_t options;            // Backing of the pool slabs
+    dot_pool_t pools[DOT_POOL_MAX_NODES];  // One pool per NUMA node, only pools[0] without numa
+    dot_arena_t scratch;                   // Scratch arena for library temporaries
+    dot_stats_t stats;                     // Counters of dot_stats_get
+};
+
+/**
+ * @brief Internal function to get the context of the calling thread, creating it on first use
+ *
+ * @return dot_ctx_t* The current context
+ */
+dot_ctx_t *__dot_ctx_current(void);
+
+/**
+ * @brief Internal function to return all the slabs of a context's pools to the system
+ *
+ * @param ctx The context whose pools to empty
+ * @return void
+ */
+void __dot_pool_release(dot_ctx_t *ctx);
+
+#endif // DOT_CTX_H
@@ -0,0 +1,225 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <immintrin.h>
+#include "dot_utils.h"
+
+#define LIMB_BYTES 8          // Number of bytes in each dot_limb
+#define VEC_BYTES 64          // Number of bytes in each AVX512 vector
+#define DOT_NATIVE_ENDIAN -1 // x86-64 is little-endian
+
+/*
+    Byte layout helpers. The value is seen as a little-endian byte string: byte 0 is the least significant
+    byte of dot_limbs[0]. A caller buffer of count words of size bytes maps onto that string through
+    order (1: most significant word first, -1: least significant word first) and endian (1: big-endian
+    words, -1: little-endian words, 0: native), exactly as in GMP's mpz_import / mpz_export.
+*/
+
+// Byte offset in the value of byte j of word i in the caller buffer
+static inline size_t __value_offset(size_t i, size_t j, size_t count, int order, size_t size, int endian)
+{
+    size_t word = (order == 1) ? count - 1 - i : i;
+    size_t byte = (endian == 1) ? size - 1 - j : j;
+    return word * size + byte;
+}
+
+// dst[i] := src[n - 1 - i], a full byte reversal (big-endian words, most significant word first)
+static void __copy_reverse_bytes(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    // reverse the bytes within each 128-bit lane, then reverse the four lanes
+    const __m512i bswap128 = _mm512_broadcast_i32x4(_mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                                                  7, 6, 5, 4, 3, 2, 1, 0));
+    size_t i = 0;
+    for (; i + VEC_BYTES <= n; i += VEC_BYTES)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(src + n - i - VEC_BYTES));
+        v = _mm512_shuffle_epi8(v, bswap128);
+        v = _mm512_shuffle_i64x2(v, v, 0x1B);
+        _mm512_storeu_si512((void *)(dst + i), v);
+    }
+    for (; i < n; i++)
+    {
+        dst[i] = src[n - 1 - i];
+    }
+}
+
+// Byte-swap each of the n 64-bit words (big-endian words, least significant word first)
+static void __copy_bswap64(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    const __m512i bswap64 = _mm512_broadcast_i32x4(_mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+                                                                 15, 14, 13, 12, 11, 10, 9, 8));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(src + i * LIMB_BYTES));
+        _mm512_storeu_si512((void *)(dst + i * LIMB_BYTES), _mm512_shuffle_epi8(v, bswap64));
+    }
+    for (; i < n; i++)
+    {
+        // Either buffer may be the caller's, with no alignment
+        uint64_t w;
+        memcpy(&w, src + i * LIMB_BYTES, LIMB_BYTES);
+        w = __builtin_bswap64(w);
+        memcpy(dst + i * LIMB_BYTES, &w, LIMB_BYTES);
+    }
+}
+
+// Reverse the order of the n 64-bit words (little-endian words, most significant word first)
+static void __copy_reverse64(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    const __m512i reverse = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(src + (n - i - 8) * LIMB_BYTES));
+        _mm512_storeu_si512((void *)(dst + i * LIMB_BYTES), _mm512_permutexvar_epi64(reverse, v));
+    }
+    for (; i < n; i++)
+    {
+        memcpy(dst + i * LIMB_BYTES, src + (n - 1 - i) * LIMB_BYTES, LIMB_BYTES);
+    }
+}
+
+/*
+    Copies nbytes between the value bytes (val) and the caller buffer (buf), picking the fastest path for
+    the requested layout. to_buf selects the direction: buf := val when true, val := buf otherwise.
+    All the fast paths are permutations that are their own inverse, so both directions share them.
+*/
+static void __copy_layout(uint8_t *val, uint8_t *buf, size_t count, int order, size_t size, int endian, bool to_buf)
+{
+    size_t nbytes = count * size;
+    uint8_t *dst = to_buf ? buf : val;
+    const uint8_t *src = to_buf ? val : buf;
+
+    if (order == -1 && endian == -1)
+    {
+        memcpy(dst, src, nbytes);
+    }
+    else if (order == 1 && endian == 1)
+    {
+        __copy_reverse_bytes(dst, src, nbytes);
+    }
+    else if (size == LIMB_BYTES && order == -1 && endian == 1)
+    {
+        __copy_bswap64(dst, src, count);
+    }
+    else if (size == LIMB_BYTES && order == 1 && endian == -1)
+    {
+        __copy_reverse64(dst, src, count);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t j = 0; j < size; j++)
+            {
+                size_t off = __value_offset(i, j, count, order, size, endian);
+                if (to_buf)
+                    buf[i * size + j] = val[off];
+                else
+                    val[off] = buf[i * size + j];
+            }
+        }
+    }
+}
+
+dot_limb_t *dot_import(size_t count, int order, size_t size, int endian, const void *op)
+{
+    if (op == NULL || size == 0 || (order != 1 && order != -1) || endian < -1 || endian > 1)
+    {
+        return NULL;
+    }
+    if (endian == 0)
+    {
+        endian = DOT_NATIVE_ENDIAN;
+    }
+
+    // An empty buffer imports as a single zero limb
+    size_t nbytes = count * size;
+    size_t num_dot_limbs = nbytes ? (nbytes + LIMB_BYTES - 1) / LIMB_BYTES : 1;
+    dot_limb_t *num = dot_limb_t_alloc(num_dot_limbs);
+    if (num == NULL)
+    {
+        perror("Memory allocation failed for num\n");
+        exit(EXIT_FAILURE);
+    }
+    num->sign = false;
+
+    uint8_t *val = (uint8_t *)num->dot_limbs;
+    __copy_layout(val, (uint8_t *)op, count, order, size, endian, false);
+
+    // Zero the unused high bytes of the most significant limb
+    memset(val + nbytes, 0, num_dot_limbs * LIMB_BYTES - nbytes);
+    dot_limb_normalize(num);
+    return num;
+}
+
+void *dot_export(void *rop, size_t *countp, int order, size_t size, int endian, const dot_limb_t *op)
+{
+    if (op == NULL || op->dot_limbs == NULL || size == 0 || (order != 1 && order != -1) || endian < -1 || endian > 1)
+    {
+        return NULL;
+    }
+    if (endian == 0)
+    {
+        endian = DOT_NATIVE_ENDIAN;
+    }
+
+    // Count the significant bytes, the carry flag being the bit just above the most significant limb
+    size_t limb_bytes = (op->carry ? op->size : op->used) * LIMB_BYTES;
+    const uint8_t *val = (const uint8_t *)op->dot_limbs;
+    size_t sig_bytes = limb_bytes + (op->carry ? 1 : 0);
+    if (!op->carry)
+    {
+        while (sig_bytes > 0 && val[sig_bytes - 1] == 0)
+        {
+            sig_bytes--;
+        }
+    }
+
+    size_t count = (sig_bytes + size - 1) / size;
+    if (countp != NULL)
+    {
+        *countp = count;
+    }
+
+    // Zero writes no words, but an allocated buffer is still returned so NULL always means an invalid layout
+    size_t nbytes = count * size;
+    if (rop == NULL)
+    {
+        rop = memory_pool_alloc(nbytes > 0 ? nbytes : 1);
+        if (rop == NULL)
+        {
+            perror("Memory allocation failed for export buffer\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (count == 0)
+    {
+        return rop;
+    }
+    if (nbytes <= limb_bytes)
+    {
+        __copy_layout((uint8_t *)val, (uint8_t *)rop, count, order, size, endian, true);
+    }
+    else
+    {
+        // The words reach past the limbs (carry or an odd word size), stage the value with its zero padding
+        dot_arena_t *scratch = dot_scratch_arena();
+        dot_arena_mark_t mark = dot_arena_mark(scratch);
+        uint8_t *staged = (uint8_t *)dot_arena_alloc(scratch, nbytes);
+        memcpy(staged, val, limb_bytes);
+        memset(staged + limb_bytes, 0, nbytes - limb_bytes);
+        if (op->carry)
+        {
+            staged[limb_bytes] = 1;
+        }
+        __copy_layout(staged, (uint8_t *)rop, count, order, size, endian, true);
+        dot_arena_release(scratch, mark);
+    }
+    return rop;
+}
@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dot_utils.h"
+
+/*
+    Memory-mapped numbers.
+
+    A file of raw little-endian 64-bit limbs, least significant first, is mapped and wrapped as a view
+    dot_limb_t, so the kernels read and write the page cache directly with no read/copy loop and no hex
+    conversion. Mappings are advised sequential, matching the low-to-high pass of every kernel, and can be
+    prefaulted with MAP_POPULATE when the file fits in memory. Outputs are created at their final length
+    up front so a full disk is reported here instead of as a SIGBUS inside a kernel.
+*/
+
+#define LIMB_BYTES sizeof(uint64_t) // Number of bytes in each limb
+
+// A mapped number, the dot_limb_t comes first so the two pointers convert into each other
+typedef struct
+{
+    dot_limb_t num; // The number, its limbs are the mapping
+    void *addr;     // Start of the mapping
+    size_t length;  // Length of the mapping in bytes
+} dot_mmap_t;
+
+// Function to map length bytes of fd and wrap them as a number
+static dot_limb_t *__map_limbs(int fd, size_t length, int flags)
+{
+    int prot = PROT_READ | ((flags & DOT_MMAP_WRITE) ? PROT_WRITE : 0);
+    int map_flags = MAP_SHARED | ((flags & DOT_MMAP_POPULATE) ? MAP_POPULATE : 0);
+    void *addr = mmap(NULL, length, prot, map_flags, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        return NULL;
+    }
+    // Advisory only, the mapping works the same if the kernel ignores it
+    madvise(addr, length, MADV_SEQUENTIAL);
+
+    dot_mmap_t *map = (dot_mmap_t *)memory_pool_alloc(sizeof(dot_mmap_t));
+    if (map == NULL)
+    {
+        perror("Memory allocation failed for dot_mmap_t\n");
+        exit(EXIT_FAILURE);
+    }
+    dot_limb_init_buffer(&map->num, (uint64_t *)addr, length / LIMB_BYTES);
+    map->addr = addr;
+    map->length = length;
+    return &map->num;
+}
+
+dot_limb_t *dot_mmap_open(const char *path, int flags)
+{
+    int fd = open(path, (flags & DOT_MMAP_WRITE) ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    // The file must hold a whole, non-zero number of limbs
+    if (st.st_size <= 0 || st.st_size % LIMB_BYTES != 0)
+    {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    dot_limb_t *num = __map_limbs(fd, (size_t)st.st_size, flags);
+    int saved_errno = errno;
+    close(fd); // The mapping keeps its own reference to the file
+    errno = saved_errno;
+    if (num != NULL)
+    {
+        // Scans down from the top limb, which is normally non-zero
+        dot_limb_normalize(num);
+    }
+    return num;
+}
+
+dot_limb_t *dot_mmap_create(const char *path, size_t size, int flags)
+{
+    if (size == 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    // Reserve every block now, the fresh file reads as zeros
+    int err = posix_fallocate(fd, 0, (off_t)(size * LIMB_BYTES));
+    if (err != 0)
+    {
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+
+    dot_limb_t *num = __map_limbs(fd, size * LIMB_BYTES, flags | DOT_MMAP_WRITE);
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    if (num != NULL)
+    {
+        num->used = 0;
+    }
+    return num;
+}
+
+// Function to check whether the limbs of a mapped number still are its mapping
+static inline bool __is_mapped(const dot_mmap_t *map)
+{
+    return map->num.view && (void *)map->num.dot_limbs == map->addr;
+}
+
+int dot_mmap_sync(dot_limb_t *num)
+{
+    dot_mmap_t *map = (dot_mmap_t *)num;
+    if (!__is_mapped(map))
+    {
+        // Grown with dot_limb_t_realloc, the writes since then are in pool memory and would be lost silently
+        errno = EINVAL;
+        return -1;
+    }
+    return msync(map->addr, map->length, MS_SYNC);
+}
+
+void dot_mmap_close(dot_limb_t *num)
+{
+    if (num == NULL)
+    {
+        return;
+    }
+    dot_mmap_t *map = (dot_mmap_t *)num;
+    if (!__is_mapped(map) && num->dot_limbs != NULL)
+    {
+        // Detached by dot_limb_t_realloc, the limbs it copied to the pool belong to the number
+        memory_pool_free(num->dot_limbs);
+    }
+    munmap(map->addr, map->length);
+    memory_pool_free(map);
+}
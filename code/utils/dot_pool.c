@@ -0,0 +1,437 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "dot_utils.h"
+#include "dot_ctx.h"
+
+/*
+    Size-class memory pool.
+
+    Memory is taken from the system in slabs of SLAB_SIZE bytes, aligned to SLAB_SIZE. Every slab serves a
+    single size class and starts with a dot_slab_t header, so the class of any block is found in O(1) by
+    masking its address down to the slab boundary. Size classes are powers of two from 64 bytes up to
+    MAX_BLOCK_SIZE; every block is 64-byte aligned and a multiple of 64 bytes long, so a full AVX512 vector
+    load never leaves the block. Freed blocks go to a per-class free list and are reused LIFO (still warm
+    in cache). Larger requests get a dedicated run of slabs that is returned to the system on free.
+
+    The pool grows on demand and never clears memory; freshly allocated blocks are uninitialised.
+
+    Slabs are backed according to dot_pool_options_t: plain aligned_alloc, anonymous mmap, explicit huge
+    pages (MAP_HUGETLB, falling back to transparent huge pages when none are reserved) or transparent huge
+    pages through madvise. Slabs can be prefaulted when created, so first-touch page faults happen at
+    allocation time instead of inside timed kernels. With numa set there is one pool per NUMA node, every
+    slab is bound to its node with mbind, and a thread allocates from the pool of the node it first
+    allocated on. A block is always freed to the pool that owns its slab.
+
+    The pools belong to the calling thread's context (dot_ctx.h), so allocation and local frees touch no
+    shared state. A block freed by a thread other than its owner is pushed onto a lock-free remote list of
+    the owning pool, which the owner drains when its local free list runs dry. Large slabs freed that way
+    are returned to the system on the owner's next large allocation or free list refill.
+
+    A context and its slabs go away with dot_ctx_destroy or the exit of the thread that owns it, and a block
+    freed after that would be written into memory that may be unmapped. Every slab is therefore marked in a
+    map with one byte per 2 MB of address space, reserved once and only committed where slabs start, and
+    memory_pool_free checks the mark before it reads the slab header.
+*/
+
+#define SLAB_SHIFT 21                            // 2 MB slabs, the x86-64 huge page size
+#define SLAB_SIZE ((size_t)1 << SLAB_SHIFT)      // Size of a slab in bytes
+#define BLOCK_SHIFT 6                            // Blocks are multiples of 64 bytes, the cache line size
+#define BLOCK_ALIGN ((size_t)1 << BLOCK_SHIFT)   // Alignment of every block
+#define NUM_CLASSES DOT_POOL_NUM_CLASSES         // 64 B, 128 B, ..., 512 KB
+#define MAX_BLOCK_SIZE (BLOCK_ALIGN << (NUM_CLASSES - 1))
+#define LARGE_CLASS NUM_CLASSES                  // Class of dedicated large allocations
+#define SLAB_MAGIC 0x646f74736c616221ULL         // "dotslab!"
+#define PAGE_SIZE_4K 4096                        // Stride used to prefault slabs
+#define SLAB_MAP_SIZE ((size_t)1 << (47 - SLAB_SHIFT)) // Slabs in the 47-bit user address space of x86-64
+
+// Header at the start of every slab, padded to one block so the first block stays aligned
+typedef struct dot_slab
+{
+    uint64_t magic;                // SLAB_MAGIC, guards against freeing foreign pointers
+    uint32_t cls;                  // Size class of the blocks in this slab, LARGE_CLASS for large allocations
+    uint32_t backing;              // dot_pool_backing_t the slab was obtained with, to return it the same way
+    size_t length;                 // Length of the slab in bytes
+    dot_pool_t *pool;              // Pool owning the slab, freed blocks go back to it
+    struct dot_slab *prev;         // Doubly linked list of all slabs owned by the pool
+    struct dot_slab *next;
+    struct dot_slab *remote_next;  // Link in the owner's remote_large list
+} __attribute__((aligned(64))) dot_slab_t;
+
+// NUMA node of the calling thread, resolved on its first allocation
+static _Thread_local int thread_node = -1;
+
+// Non-zero at the slab number of every live slab, see slab_mark
+static _Atomic(uint8_t) *slab_live = NULL;
+static pthread_once_t slab_live_once = PTHREAD_ONCE_INIT;
+
+// Function to compute the size class of a request, size must not exceed MAX_BLOCK_SIZE
+static inline unsigned size_class(size_t size)
+{
+    if (size <= BLOCK_ALIGN)
+    {
+        return 0;
+    }
+    return 64 - __builtin_clzll((size - 1) >> BLOCK_SHIFT);
+}
+
+// Function to get the NUMA node the calling thread runs on
+static int current_node(void)
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= DOT_POOL_MAX_NODES)
+    {
+        return 0;
+    }
+    return (int)node;
+}
+
+// Function to get the pool the calling thread allocates from
+static inline dot_pool_t *current_pool(dot_ctx_t *ctx)
+{
+    if (!ctx->options.numa)
+    {
+        return &ctx->pools[0];
+    }
+    if (unlikely(thread_node < 0))
+    {
+        thread_node = current_node();
+    }
+    return &ctx->pools[thread_node];
+}
+
+// Function to map length bytes aligned to SLAB_SIZE, trimming the excess of an oversized mapping
+static void *map_aligned(size_t length, int flags)
+{
+    size_t span = length + SLAB_SIZE;
+    uint8_t *raw = (uint8_t *)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return NULL;
+    }
+    uint8_t *aligned = (uint8_t *)(((uintptr_t)raw + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1));
+    if (aligned > raw)
+    {
+        munmap(raw, aligned - raw);
+    }
+    if (aligned + length < raw + span)
+    {
+        munmap(aligned + length, raw + span - (aligned + length));
+    }
+    return aligned;
+}
+
+// Function to obtain the memory of a slab with the configured backing, updating backing to the one used
+static void *slab_map(size_t length, dot_pool_backing_t *backing)
+{
+    void *mem = NULL;
+    switch (*backing)
+    {
+    case DOT_POOL_HUGETLB:
+        // Huge page mappings are naturally aligned to the 2 MB huge page size
+        mem = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED)
+        {
+            break;
+        }
+        // No huge pages reserved, use transparent huge pages instead
+        *backing = DOT_POOL_THP;
+        /* fall through */
+    case DOT_POOL_THP:
+        mem = map_aligned(length, 0);
+        if (mem != NULL)
+        {
+            madvise(mem, length, MADV_HUGEPAGE);
+        }
+        break;
+    case DOT_POOL_MMAP:
+        mem = map_aligned(length, 0);
+        break;
+    default:
+        mem = aligned_alloc(SLAB_SIZE, length);
+        break;
+    }
+    return mem == MAP_FAILED ? NULL : mem;
+}
+
+// Function to return the memory of a slab to the system
+static void slab_unmap(void *mem, size_t length, dot_pool_backing_t backing)
+{
+    if (backing == DOT_POOL_MALLOC)
+    {
+        free(mem);
+    }
+    else
+    {
+        munmap(mem, length);
+    }
+}
+
+// Function to reserve the map of live slabs, its pages are only committed when a slab is marked in them
+static void slab_live_create(void)
+{
+    void *map = mmap(NULL, SLAB_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED)
+    {
+        perror("Memory allocation failed for the map of live slabs\n");
+        exit(EXIT_FAILURE);
+    }
+    slab_live = (_Atomic(uint8_t) *)map;
+}
+
+// Function to mark a slab live or dead, addresses above the map are never checked
+static void slab_mark(const void *slab, uint8_t live)
+{
+    size_t number = (uintptr_t)slab >> SLAB_SHIFT;
+    if (number < SLAB_MAP_SIZE)
+    {
+        atomic_store_explicit(&slab_live[number], live, memory_order_release);
+    }
+}
+
+// Function to check that the slab of a block belongs to a live context, before its header is read
+static inline bool slab_is_live(const void *slab)
+{
+    size_t number = (uintptr_t)slab >> SLAB_SHIFT;
+    if (unlikely(number >= SLAB_MAP_SIZE))
+    {
+        return true;
+    }
+    _Atomic(uint8_t) *map = slab_live;
+    return map != NULL && atomic_load_explicit(&map[number], memory_order_acquire) != 0;
+}
+
+// Function to bind a slab to a NUMA node and fault its pages in, as configured
+static void slab_place(void *mem, size_t length, int node, bool prefault)
+{
+    if (node >= 0)
+    {
+        unsigned long nodemask = 1UL << node;
+        // Best effort, on failure the pages simply follow the default first-touch policy
+        syscall(SYS_mbind, mem, length, MPOL_BIND, &nodemask, DOT_POOL_MAX_NODES + 1, 0);
+    }
+    if (prefault)
+    {
+        volatile uint8_t *page = (volatile uint8_t *)mem;
+        for (size_t offset = 0; offset < length; offset += PAGE_SIZE_4K)
+        {
+            page[offset] = 0;
+        }
+    }
+}
+
+// Function to take a SLAB_SIZE-aligned run of slabs from the system and link it into the pool
+static dot_slab_t *slab_create(dot_pool_t *pool, size_t length, unsigned cls)
+{
+    const dot_pool_options_t *options = &pool->ctx->options;
+    dot_pool_backing_t backing = options->backing;
+    dot_slab_t *slab = (dot_slab_t *)slab_map(length, &backing);
+    if (slab == NULL)
+    {
+        perror("Memory allocation failed for memory pool slab\n");
+        exit(EXIT_FAILURE);
+    }
+    slab_place(slab, length, options->numa ? (int)(pool - pool->ctx->pools) : -1, options->prefault);
+    pthread_once(&slab_live_once, slab_live_create);
+    slab_mark(slab, 1);
+
+    slab->magic = SLAB_MAGIC;
+    slab->cls = cls;
+    slab->backing = backing;
+    slab->length = length;
+    slab->pool = pool;
+    slab->prev = NULL;
+    slab->next = pool->slabs;
+    if (pool->slabs != NULL)
+    {
+        pool->slabs->prev = slab;
+    }
+    pool->slabs = slab;
+
+#ifdef DOT_ENABLE_STATS
+    dot_stats_t *stats = &pool->ctx->stats;
+    stats->pool_bytes += length;
+    if (stats->pool_bytes > stats->pool_high_water)
+    {
+        stats->pool_high_water = stats->pool_bytes;
+    }
+#endif
+    return slab;
+}
+
+// Function to unlink a slab from its pool and return it to the system
+static void slab_destroy(dot_slab_t *slab)
+{
+    dot_pool_t *pool = slab->pool;
+    if (slab->prev != NULL)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        pool->slabs = slab->next;
+    }
+    if (slab->next != NULL)
+    {
+        slab->next->prev = slab->prev;
+    }
+    slab->magic = 0;
+    slab_mark(slab, 0);
+#ifdef DOT_ENABLE_STATS
+    pool->ctx->stats.pool_bytes -= slab->length;
+#endif
+    slab_unmap(slab, slab->length, (dot_pool_backing_t)slab->backing);
+}
+
+// Function to destroy the large slabs other threads have freed, only called by the owner
+static void drain_remote_large(dot_pool_t *pool)
+{
+    dot_slab_t *slab = atomic_exchange_explicit(&pool->remote_large, NULL, memory_order_acquire);
+    while (slab != NULL)
+    {
+        dot_slab_t *next = slab->remote_next;
+        slab_destroy(slab);
+        slab = next;
+    }
+}
+
+void init_memory_pool()
+{
+    // Creates the calling thread's context, the pools themselves grow on demand
+    __dot_ctx_current();
+}
+
+void init_memory_pool_ex(const dot_pool_options_t *options)
+{
+    // Only slabs created from now on follow the new options
+    dot_ctx_t *ctx = __dot_ctx_current();
+    if (options != NULL)
+    {
+        ctx->options = *options;
+    }
+}
+
+void *memory_pool_alloc(size_t size)
+{
+    if (size == 0)
+    {
+        size = 1;
+    }
+
+    dot_pool_t *pool = current_pool(__dot_ctx_current());
+
+    // Large requests get their own slabs, the block starts right after the header
+    if (unlikely(size > MAX_BLOCK_SIZE))
+    {
+        drain_remote_large(pool);
+        size_t length = (size + sizeof(dot_slab_t) + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1);
+        dot_slab_t *slab = slab_create(pool, length, LARGE_CLASS);
+        return (uint8_t *)slab + sizeof(dot_slab_t);
+    }
+
+    unsigned cls = size_class(size);
+
+    // Reuse the most recently freed block of the class, taking over the remote frees when none is left
+    dot_free_block_t *block = pool->free_list[cls];
+    if (unlikely(block == NULL))
+    {
+        // Large slabs freed by other threads are returned here too, an owner may never allocate large again
+        drain_remote_large(pool);
+        block = atomic_exchange_explicit(&pool->remote_free[cls], NULL, memory_order_acquire);
+    }
+    if (likely(block != NULL))
+    {
+        pool->free_list[cls] = block->next;
+        return block;
+    }
+
+    // Otherwise carve a new block, taking a fresh slab when the current one is used up
+    size_t block_size = BLOCK_ALIGN << cls;
+    if (unlikely((size_t)(pool->carve_end[cls] - pool->carve_ptr[cls]) < block_size))
+    {
+        dot_slab_t *slab = slab_create(pool, SLAB_SIZE, cls);
+        pool->carve_ptr[cls] = (uint8_t *)slab + sizeof(dot_slab_t);
+        pool->carve_end[cls] = (uint8_t *)slab + SLAB_SIZE;
+    }
+    void *ptr = pool->carve_ptr[cls];
+    pool->carve_ptr[cls] += block_size;
+    return ptr;
+}
+
+void memory_pool_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    dot_slab_t *slab = (dot_slab_t *)((uintptr_t)ptr & ~(uintptr_t)(SLAB_SIZE - 1));
+    if (unlikely(!slab_is_live(slab)))
+    {
+        fprintf(stderr, "memory_pool_free: %p is not in a slab of a live context, it was not allocated from the "
+                        "memory pool or its context was destroyed\n", ptr);
+        exit(EXIT_FAILURE);
+    }
+    if (unlikely(slab->magic != SLAB_MAGIC))
+    {
+        fprintf(stderr, "memory_pool_free: %p was not allocated from the memory pool\n", ptr);
+        exit(EXIT_FAILURE);
+    }
+
+    dot_pool_t *pool = slab->pool;
+    dot_free_block_t *block = (dot_free_block_t *)ptr;
+    if (likely(pool->ctx == __dot_ctx_current()))
+    {
+        if (unlikely(slab->cls == LARGE_CLASS))
+        {
+            slab_destroy(slab);
+            return;
+        }
+        block->next = pool->free_list[slab->cls];
+        pool->free_list[slab->cls] = block;
+        return;
+    }
+
+    // The block belongs to another thread's context, hand it over through the lock-free remote lists
+    if (slab->cls == LARGE_CLASS)
+    {
+        slab->remote_next = atomic_load_explicit(&pool->remote_large, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&pool->remote_large, &slab->remote_next, slab,
+                                                      memory_order_release, memory_order_relaxed))
+            ;
+        return;
+    }
+    block->next = atomic_load_explicit(&pool->remote_free[slab->cls], memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&pool->remote_free[slab->cls], &block->next, block,
+                                                  memory_order_release, memory_order_relaxed))
+        ;
+}
+
+void __dot_pool_release(dot_ctx_t *ctx)
+{
+    for (int node = 0; node < DOT_POOL_MAX_NODES; node++)
+    {
+        dot_pool_t *pool = &ctx->pools[node];
+        while (pool->slabs != NULL)
+        {
+            slab_destroy(pool->slabs);
+        }
+        memset(pool, 0, sizeof(*pool));
+        pool->ctx = ctx;
+    }
+}
+
+void destroy_memory_pool()
+{
+    DOT_STAT_ADD(pool_resets, 1);
+    __dot_pool_release(__dot_ctx_current());
+}
@@ -16,7 +16,7 @@
 
 #define LIMB_BITS 64             // Number of hex digits in each dot_limb
 #define bits 4                   // Number of bits in each hex digit
-#define MEMORY_POOL_SIZE 1 << 25 // 1 GB memory pool
+#define DOT_LIMB_HEADER_SIZE 64  // dot_limb_t header padded to one cache line, inline limbs follow it
 
 // Define the aligned data types
 // typedef uint64_t aligned_uint64 __attribute__((aligned(64)));      // Define an aligned uint64_t
@@ -24,72 +24,18 @@
 typedef uint64_t aligned_uint64;      // Define an aligned uint64_t
 typedef uint64_t *aligned_uint64_ptr; // Define an aligned pointer to uint64_t
 
-// Declare the SIMD constants
-__m512i AVX512_ZEROS; // AVX512 vector of zeros
-__m256i AVX256_ZEROS; // AVX256 vector of zeros
-__m128i AVX128_ZEROS; // AVX128 vector of zeros
-__m512i AVX512_MASK;  // AVX512 vector of 52-bit mask
-__m256i AVX256_MASK;  // AVX256 vector of 52-bit mask
-__m128i AVX128_MASK;  // AVX128 vector of 52-bit mask
+_Static_assert(sizeof(dot_limb_t) <= DOT_LIMB_HEADER_SIZE, "dot_limb_t no longer fits its header slot");
 
-// Memory pool variables
-static uint8_t *memory_pool = NULL;
-static size_t memory_pool_offset = 0;
-static size_t memory_pool_free_count = 0;
-
-void init_memory_pool()
-{
-    memory_pool = (uint8_t *)malloc(MEMORY_POOL_SIZE);
-    if (memory_pool == NULL)
-    {
-        perror("Memory allocation failed for memory pool\n");
-        exit(EXIT_FAILURE);
-    }
-    memory_pool_offset = 0;
-    AVX512_ZEROS = _mm512_setzero_si512();
-    AVX256_ZEROS = _mm256_setzero_si256();
-    AVX128_ZEROS = _mm_setzero_si128();
-
-    AVX512_MASK = _mm512_set1_epi64(0xFFFFFFFFFFFFFFFF);
-    AVX256_MASK = _mm256_set1_epi64x(0xFFFFFFFFFFFFFFFF);
-    AVX128_MASK = _mm_set1_epi64x(0xFFFFFFFFFFFFFFFF);
-}
-
-void *memory_pool_alloc(size_t size)
-{
-    // Align the memory offset to 64 bytes
-    size_t aligned_offset = memory_pool_offset++;
-
-    if (aligned_offset + size > MEMORY_POOL_SIZE)
-    {
-        perror("Memory pool exhausted\n");
-        exit(EXIT_FAILURE);
-    }
-
-    void *ptr = memory_pool + aligned_offset;
-    memory_pool_offset = aligned_offset + size;
-    return ptr;
-}
-
-void memory_pool_free(void *ptr)
+// Function to get the address of the limbs stored inline, right after the header of a pool-allocated number
+static inline uint64_t *__inline_limbs(const dot_limb_t *dot_limb)
 {
-    // if the offset is greater than 512MB, reset the memory pool
-    if (memory_pool_offset > (MEMORY_POOL_SIZE >> 1))
-    {
-        memory_pool_offset = 0;
-        memory_pool_free_count++;
-        memset(memory_pool, 0, MEMORY_POOL_SIZE);
-    }
+    return (uint64_t *)((uint8_t *)dot_limb + DOT_LIMB_HEADER_SIZE);
 }
 
-void destroy_memory_pool()
+// Function to check if the limbs are a separate memory pool block to free on their own
+static inline bool __owns_limbs(const dot_limb_t *dot_limb)
 {
-    if (memory_pool != NULL)
-    {
-        _mm_free(memory_pool);
-        memory_pool = NULL;
-        memory_pool_offset = 0;
-    }
+    return !dot_limb->view && dot_limb->dot_limbs != NULL && dot_limb->dot_limbs != __inline_limbs(dot_limb);
 }
 
 dot_limb_t *dot_limb_t_alloc(size_t size)
@@ -100,29 +46,48 @@ dot_limb_t *dot_limb_t_alloc(size_t size)
         return NULL;
     }
 
-    dot_limb_t *dot_limb = (dot_limb_t *)memory_pool_alloc(sizeof(dot_limb_t));
+    // The header and the limbs share one block, the limbs start at the next 64-byte boundary
+    dot_limb_t *dot_limb = (dot_limb_t *)memory_pool_alloc(DOT_LIMB_HEADER_SIZE + size * sizeof(uint64_t));
     // check if the memory allocation failed
     if (dot_limb == NULL)
-    {
-        perror("Memory allocation failed for dot_limb_t structure\n");
-        exit(EXIT_FAILURE);
-    }
-
-    // Allocate memory with fixed alignment of 64
-    dot_limb->dot_limbs = (uint64_t *)memory_pool_alloc(size * sizeof(uint64_t));
-    // check if the memory allocation failed
-    if (dot_limb->dot_limbs == NULL)
     {
         perror("Memory allocation failed for dot_limb_t_alloc\n");
         exit(EXIT_FAILURE);
     }
 
+    dot_limb->dot_limbs = __inline_limbs(dot_limb);
     dot_limb->size = size;
-    dot_limb->sign = false; // Initialize sign to false (positive)
+    dot_limb->used = size;   // The limbs are uninitialised, so any of them may be significant
+    dot_limb->alloc = size;
+    dot_limb->sign = false;  // Initialize sign to false (positive)
+    dot_limb->carry = false; // Initialize carry to false
+    dot_limb->view = false;  // The limbs belong to the memory pool
 
     return dot_limb;
 }
 
+void dot_limb_init_buffer(dot_limb_t *dot_limb, uint64_t *limbs, size_t capacity)
+{
+    dot_limb->dot_limbs = limbs;
+    dot_limb->size = capacity;
+    dot_limb->used = capacity;
+    dot_limb->alloc = capacity;
+    dot_limb->sign = false;
+    dot_limb->carry = false;
+    dot_limb->view = true; // The limbs belong to the caller
+}
+
+size_t dot_limb_normalize(dot_limb_t *dot_limb)
+{
+    size_t used = dot_limb->used;
+    while (used > 0 && dot_limb->dot_limbs[used - 1] == 0)
+    {
+        used--;
+    }
+    dot_limb->used = used;
+    return used;
+}
+
 dot_limb_t *dot_limb_t_realloc(dot_limb_t *dot_limb, size_t new_size)
 {
     // Check if the dot_limb is NULL
@@ -140,9 +105,29 @@ dot_limb_t *dot_limb_t_realloc(dot_limb_t *dot_limb, size_t new_size)
     // Check if the new size is 0
     if (new_size == 0)
     {
-        memory_pool_free(dot_limb->dot_limbs);
+        if (__owns_limbs(dot_limb))
+        {
+            memory_pool_free(dot_limb->dot_limbs);
+        }
         dot_limb->dot_limbs = NULL;
         dot_limb->size = 0;
+        dot_limb->used = 0;
+        dot_limb->alloc = 0;
+        return dot_limb;
+    }
+
+    // Resize in place when the limbs already have room, padding with zeros if growing
+    if (new_size <= dot_limb->alloc)
+    {
+        if (new_size > dot_limb->size)
+        {
+            memset(dot_limb->dot_limbs + dot_limb->size, 0, (new_size - dot_limb->size) * sizeof(uint64_t));
+        }
+        else if (dot_limb->used > new_size)
+        {
+            dot_limb->used = new_size;
+        }
+        dot_limb->size = new_size;
         return dot_limb;
     }
 
@@ -153,20 +138,22 @@ dot_limb_t *dot_limb_t_realloc(dot_limb_t *dot_limb, size_t new_size)
         return NULL;
     }
 
-    // Copy old data to new memory, preserving least significant digits at lower indices
-    size_t copy_size = dot_limb->size < new_size ? dot_limb->size : new_size;
+    // Copy the significant limbs to new memory, preserving least significant digits at lower indices
+    size_t copy_size = dot_limb->used;
     memcpy(new_dot_limbs, dot_limb->dot_limbs, copy_size * sizeof(uint64_t));
 
-    // If growing, append zeros at the end (higher indices)
-    if (new_size > dot_limb->size)
+    // Append zeros at the end (higher indices)
+    memset(new_dot_limbs + copy_size, 0, (new_size - copy_size) * sizeof(uint64_t));
+
+    // Free the old memory and update dot_limb structure, borrowed and inline limbs are left in place
+    if (__owns_limbs(dot_limb))
     {
-        memset(new_dot_limbs + copy_size, 0, (new_size - copy_size) * sizeof(uint64_t));
+        memory_pool_free(dot_limb->dot_limbs);
     }
-
-    // Free the old memory and update dot_limb structure
-    memory_pool_free(dot_limb->dot_limbs);
     dot_limb->dot_limbs = new_dot_limbs;
     dot_limb->size = new_size;
+    dot_limb->alloc = new_size;
+    dot_limb->view = false;
 
     return dot_limb;
 }
@@ -175,7 +162,7 @@ void dot_limb_t_free(dot_limb_t *dot_limb)
 {
     if (dot_limb != NULL)
     {
-        if (dot_limb->dot_limbs != NULL)
+        if (__owns_limbs(dot_limb))
         {
             memory_pool_free(dot_limb->dot_limbs);
         }
@@ -192,7 +179,8 @@ void __get_str(const dot_limb_t *num, char *str)
     {
         *sp++ = '-';
     }
-    size_t num_dot_limbs = num->size;
+    // Only the used limbs can hold digits, unless the carry sits above all of them
+    size_t num_dot_limbs = num->carry ? num->size : num->used;
     unsigned char mask = 0xF; // Assuming 4 bits per digit (hex)
     bool leading_zeros = true;
 
@@ -231,7 +219,7 @@ char *dot_limb_get_str(const dot_limb_t *num)
         return NULL;
     }
 
-    if (num->size == 1 && num->dot_limbs[0] == 0)
+    if (num->used == 0 && !num->carry)
     {
         char *zero = (char *)memory_pool_alloc(2); // Allocate for "0\0"
         if (zero == NULL)
@@ -286,6 +274,8 @@ void __set_str(aligned_uint64_ptr digits, size_t n, dot_limb_t *num)
         num->dot_limbs[dot_limb_index++] = 0;
     }
     num->size = num_dot_limbs;
+    num->used = num_dot_limbs;
+    dot_limb_normalize(num);
 }
 
 dot_limb_t *dot_limb_set_str(const char *str)
@@ -296,14 +286,11 @@ dot_limb_t *dot_limb_set_str(const char *str)
         return NULL;
     }
 
-    // Allocate temporary memory for hex-string to digit conversion
+    // Allocate temporary memory for hex-string to digit conversion from the scratch arena
     size_t hex_len = strlen(str);
-    aligned_uint64_ptr digits = (uint64_t *)memory_pool_alloc(hex_len * sizeof(uint64_t));
-    if (digits == NULL)
-    {
-        perror("Memory allocation failed for digits\n");
-        exit(EXIT_FAILURE);
-    }
+    dot_arena_t *scratch = dot_scratch_arena();
+    dot_arena_mark_t mark = dot_arena_mark(scratch);
+    aligned_uint64_ptr digits = (uint64_t *)dot_arena_alloc(scratch, hex_len * sizeof(uint64_t));
 
     // Extract sign and omit any whitespace
     bool sign = false;
@@ -359,7 +346,7 @@ dot_limb_t *dot_limb_set_str(const char *str)
     num->carry = false; // Initialize carry to false
 
     __set_str(digits, actual_len, num);
-    memory_pool_free(digits); // Free the temporary digits array
+    dot_arena_release(scratch, mark); // Free the temporary digits array
     return num;
 }
 void dot_limb_t_adjust_sizes(dot_limb_t *num1, dot_limb_t *num2)
@@ -23,39 +23,318 @@ typedef struct
     aligned_uint64_ptr dot_limbs; // Pointer to the dot_limbs
     bool sign;                    // Sign of the number
     size_t size;                  // Size of the dot_limbs
+    size_t used;                  // Normalised size, every limb from used up to size is zero
+    size_t alloc;                 // Number of limbs available at dot_limbs, size may grow up to it in place
     bool carry;                   // Carry flag
+    bool view;                    // Limbs are borrowed (caller buffer, GMP, arena), not owned by the memory pool
 } dot_limb_t;
 
-// Declare the SIMD constants
-extern __m512i AVX512_ZEROS;           // 0 as chunk of 8 64-bit integers
-extern __m512i AVX512_ONES;            // 1 as chunk of 8 64-bit integers
-extern __m512i AVX512_DOT_LIMB_DIGITS; // 10^18 as chunk of 8 64-bit integers
+// SIMD constants, compile-time so the kernels read no mutable globals
+#define AVX512_ZEROS _mm512_setzero_si512()      // 0 as chunk of 8 64-bit integers
+#define AVX256_ZEROS _mm256_setzero_si256()      // 0 as chunk of 4 64-bit integers
+#define AVX128_ZEROS _mm_setzero_si128()         // 0 as chunk of 2 64-bit integers
+#define AVX512_MASK _mm512_set1_epi64(-1)        // All-ones as chunk of 8 64-bit integers
+#define AVX256_MASK _mm256_set1_epi64x(-1)       // All-ones as chunk of 4 64-bit integers
+#define AVX128_MASK _mm_set1_epi64x(-1)          // All-ones as chunk of 2 64-bit integers
 
 #define unlikely(expr) __builtin_expect(!!(expr), 0) // unlikely branch
 #define likely(expr) __builtin_expect(!!(expr), 1)   // likely branch
 
-// Memory pool functions
+// Operations counted by dot_stats_t
+typedef enum
+{
+    DOT_STATS_ADD = 0,    // dot_add_n, dot_add_nc, dot_add_words and streamed additions
+    DOT_STATS_SUB,        // dot_sub_n, dot_sub_nc, dot_sub_words and streamed subtractions
+    DOT_STATS_ADD_APPROX, // dot_add_n_approx
+    DOT_STATS_SUB_APPROX, // dot_sub_n_approx
+    DOT_STATS_OPS,
+} dot_stats_op_t;
+
+// Library statistics of one context, only collected when built with DOT_ENABLE_STATS (make STATS=1)
+typedef struct
+{
+    uint64_t calls[DOT_STATS_OPS];            // Kernel calls
+    uint64_t limbs[DOT_STATS_OPS];            // Limbs processed
+    uint64_t slow_path[DOT_STATS_OPS];        // Blocks needing the second carry/borrow pass, exact kernels
+    uint64_t uncertain_blocks[DOT_STATS_OPS]; // Blocks whose carry/borrow needed a ripple the approx kernels skip
+    uint64_t pool_bytes;                      // Bytes the memory pool currently holds from the system
+    uint64_t pool_high_water;                 // Highest pool_bytes since the last reset
+    uint64_t pool_resets;                     // destroy_memory_pool calls
+} dot_stats_t;
+
+// Statistics hooks of the kernels, they compile to nothing unless DOT_ENABLE_STATS is defined
+#ifdef DOT_ENABLE_STATS
+#define DOT_STAT_ADD(field, value) (__dot_stats_current()->field += (value))
+#define DOT_STAT_IF(field, cond)                  \
+    do                                            \
+    {                                             \
+        if (cond)                                 \
+        {                                         \
+            __dot_stats_current()->field++;       \
+        }                                         \
+    } while (0)
+#else
+#define DOT_STAT_ADD(field, value) ((void)0)
+#define DOT_STAT_IF(field, cond) ((void)0)
+#endif
+
+dot_stats_t *__dot_stats_current(void); // Statistics of the calling thread's context
+
+// Operation of a dot_stream_t
+typedef enum
+{
+    DOT_STREAM_ADD = 0, // result = a + b
+    DOT_STREAM_SUB,     // result = a - b, wrapping with a final borrow
+} dot_stream_op_t;
+
+// Add or sub over operands delivered in chunks, least significant first, see dot_stream.c
+typedef struct
+{
+    dot_stream_op_t op; // Operation of the stream
+    uint64_t carry;     // Carry or borrow into the next chunk
+    size_t limbs;       // Number of limbs processed so far
+} dot_stream_t;
+
+// Kind of a dot_expr_t node
+typedef enum
+{
+    DOT_EXPR_LEAF = 0, // An operand
+    DOT_EXPR_ADD,      // left + right
+    DOT_EXPR_SUB,      // left - right
+} dot_expr_kind_t;
+
+// A node of an expression, its children are nodes created before it
+typedef struct
+{
+    dot_expr_kind_t kind;
+    const dot_limb_t *leaf; // Operand of a leaf
+    size_t left;            // Children of an add or sub
+    size_t right;
+} dot_expr_node_t;
+
+// A DAG of sums and differences of dot_limb_t, built node by node and evaluated in one pass, see dot_eval.c
+typedef struct
+{
+    dot_expr_node_t *nodes; // Nodes by id, in creation order
+    int64_t *coeffs;        // Scratch of dot_eval, the multiplicity of every node
+    size_t count;           // Nodes in use
+    size_t capacity;        // Nodes allocated
+} dot_expr_t;
+
+// Operation of a generated kernel, see dot_jit.c
+typedef enum
+{
+    DOT_JIT_ADD = 0, // result = a + b
+    DOT_JIT_SUB,     // result = |a - b| with its sign
+} dot_jit_op_t;
+
+// A generated kernel, called like dot_add_n
+typedef void (*dot_jit_func_t)(dot_limb_t *result, dot_limb_t *a, dot_limb_t *b);
+
+// Backing memory of the memory pool slabs
+typedef enum
+{
+    DOT_POOL_MALLOC = 0, // aligned_alloc from the C library
+    DOT_POOL_MMAP,       // Anonymous mmap
+    DOT_POOL_HUGETLB,    // Explicit 2 MB huge pages (MAP_HUGETLB), falls back to DOT_POOL_THP
+    DOT_POOL_THP,        // Transparent huge pages requested with madvise(MADV_HUGEPAGE)
+} dot_pool_backing_t;
+
+#define DOT_POOL_MAX_NODES 64 // Highest number of NUMA nodes with a pool of their own
+
+// Memory pool configuration, for init_memory_pool_ex
+typedef struct
+{
+    dot_pool_backing_t backing; // Where slabs come from
+    bool prefault;              // Touch every page of a slab when it is created, not inside the kernels
+    bool numa;                  // One pool per NUMA node, threads allocate node-local memory
+} dot_pool_options_t;
+
+// Memory pool functions, see dot_pool.c for the size-class layout
 void init_memory_pool();
-void *memory_pool_alloc(size_t size);
-void memory_pool_free(void *ptr);
-void destroy_memory_pool();
+void init_memory_pool_ex(const dot_pool_options_t *options); // NULL keeps the current options
+void *memory_pool_alloc(size_t size); // 64-byte aligned, uninitialised, grows the pool as needed
+void memory_pool_free(void *ptr);     // O(1), the block is reused by the next allocation of its size class
+void destroy_memory_pool();           // Returns every slab to the system, invalidating all blocks
+
+// A stack-style arena for short-lived memory, see dot_arena.c
+typedef struct dot_arena_chunk dot_arena_chunk_t;
+typedef struct
+{
+    dot_arena_chunk_t *head;  // First chunk of the arena
+    dot_arena_chunk_t *chunk; // Chunk currently allocated from
+    size_t offset;            // Bump offset into the current chunk
+} dot_arena_t;
+
+// A position in an arena, everything allocated after it is released at once
+typedef struct
+{
+    dot_arena_chunk_t *chunk;
+    size_t offset;
+} dot_arena_mark_t;
+
+/**
+ * @brief Initialises an empty arena, no memory is taken until the first allocation
+ *
+ * @param arena The arena to initialise
+ * @return void
+ */
+void dot_arena_init(dot_arena_t *arena);
+
+/**
+ * @brief Allocates memory from an arena, with fixed alignment of 64
+ *
+ * @param arena The arena to allocate from
+ * @param size The number of bytes to allocate
+ * @return void* The pointer to the allocated memory, uninitialised
+ * @note The memory is released by dot_arena_release or dot_arena_destroy, never by memory_pool_free
+ */
+void *dot_arena_alloc(dot_arena_t *arena, size_t size);
+
+/**
+ * @brief Records the current position of an arena
+ *
+ * @param arena The arena to mark
+ * @return dot_arena_mark_t The mark to pass to dot_arena_release
+ */
+dot_arena_mark_t dot_arena_mark(const dot_arena_t *arena);
+
+/**
+ * @brief Releases everything allocated from an arena since a mark, in O(1)
+ *
+ * @param arena The arena to rewind
+ * @param mark A mark taken on this arena, marks taken after it become invalid
+ * @return void
+ */
+void dot_arena_release(dot_arena_t *arena, dot_arena_mark_t mark);
+
+/**
+ * @brief Returns all the memory of an arena to the system, leaving it empty
+ *
+ * @param arena The arena to destroy
+ * @return void
+ */
+void dot_arena_destroy(dot_arena_t *arena);
+
+/**
+ * @brief Gets the scratch arena of the calling thread, used for temporaries by the library itself
+ *
+ * @return dot_arena_t* The thread's scratch arena
+ * @note Callers must release back to their own mark before returning, the arena is shared by all nested calls
+ */
+dot_arena_t *dot_scratch_arena(void);
+
+// A library context, owning the memory pools, their options and the scratch arena, see dot_ctx.c
+typedef struct dot_ctx dot_ctx_t;
+
+/**
+ * @brief Creates a library context with empty pools
+ *
+ * A thread's own context is destroyed when the thread exits, with every number allocated in it. Numbers
+ * that are handed to other threads or outlive the thread that allocates them belong in a created context,
+ * which lives until dot_ctx_destroy.
+ *
+ * @param options The pool options of the context, NULL for the defaults
+ * @return dot_ctx_t* The new context
+ * @note Freeing a block after its context was destroyed stops the process with a message
+ */
+dot_ctx_t *dot_ctx_create(const dot_pool_options_t *options);
+
+/**
+ * @brief Destroys a context, returning its pools and scratch arena to the system
+ *
+ * @param ctx The context to destroy, no thread may be using it
+ * @return void
+ * @note Every block allocated in the context becomes invalid
+ */
+void dot_ctx_destroy(dot_ctx_t *ctx);
+
+/**
+ * @brief Gets the context the calling thread allocates from
+ *
+ * @return dot_ctx_t* The current context, the thread's own one unless dot_ctx_set was called
+ */
+dot_ctx_t *dot_ctx_get(void);
+
+/**
+ * @brief Makes the calling thread allocate from a context
+ *
+ * @param ctx The context to use, NULL to go back to the thread's own context
+ * @return void
+ * @note A context must only be current in one thread at a time
+ */
+void dot_ctx_set(dot_ctx_t *ctx);
+
+/**
+ * @brief Gets the statistics of the calling thread's context
+ *
+ * @param stats Receives a copy of the counters, all zero unless the library was built with DOT_ENABLE_STATS
+ * @return void
+ */
+void dot_stats_get(dot_stats_t *stats);
+
+/**
+ * @brief Resets the statistics of the calling thread's context
+ *
+ * @return void
+ * @note pool_bytes keeps tracking the memory held, pool_high_water restarts from it
+ */
+void dot_stats_reset(void);
+
+/**
+ * @brief Allocates dot_limb_t structure and its dot_limbs from an arena
+ *
+ * @param arena The arena to allocate from
+ * @param size The number of dot_limbs to allocate
+ * @return dot_limb_t* The pointer to the allocated number
+ * @note The number is released with the arena, never by dot_limb_t_free
+ */
+dot_limb_t *dot_arena_limb_alloc(dot_arena_t *arena, size_t size);
 
 /**
  * @brief Allocates dot_limb_t structure, with fixed alignment of 64
  *
+ * The structure and its dot_limbs are a single memory pool block, the limbs start 64 bytes after the structure.
+ *
  * @param size The number of dot_limbs to allocate
  * @return dot_limb_t* The pointer to the allocated memory
  * @note The memory should be freed using memory_pool_free
  */
 dot_limb_t *dot_limb_t_alloc(size_t size);
 
+/**
+ * @brief Initialises a dot_limb_t over a caller-owned limb buffer, without any allocation
+ *
+ * The structure and the limbs can live anywhere: on the stack, inside another structure or in mapped memory.
+ * Every kernel works on such numbers unchanged.
+ *
+ * @param dot_limb The dot_limb_t structure to initialise
+ * @param limbs The caller's buffer of limbs, it must outlive the number
+ * @param capacity The number of limbs in the buffer, which is also the initial size
+ * @return void
+ * @note Never pass such a number to dot_limb_t_free, the caller owns both the structure and the limbs
+ */
+void dot_limb_init_buffer(dot_limb_t *dot_limb, uint64_t *limbs, size_t capacity);
+
+/**
+ * @brief Recomputes the normalised size of a number whose limbs were written directly
+ *
+ * The kernels keep used up to date on their results and only process the used limbs of their operands.
+ * Numbers filled by other means start with used equal to size, which is always correct but slower;
+ * normalising them lets later operations skip their high zero limbs.
+ *
+ * @param dot_limb The number to normalise
+ * @return size_t The new used count
+ */
+size_t dot_limb_normalize(dot_limb_t *dot_limb);
+
 /**
  * @brief Reallocates memory with fixed alignment of 64
  *
  * @param dot_limb The pointer to the memory to reallocate
  * @param new_size The new size of the memory
  * @return dot_limb_t* The pointer to the reallocated memory
- * @note The old memory is freed
+ * @note Grows in place up to alloc limbs, otherwise the old memory is freed unless it is borrowed
  */
 dot_limb_t *dot_limb_t_realloc(dot_limb_t *dot_limb, size_t new_size);
 
@@ -106,6 +385,89 @@ dot_limb_t *dot_limb_set_str(const char *str);
  */
 void __set_str(aligned_uint64_ptr digits, size_t n, dot_limb_t *num);
 
+/**
+ * @brief Imports a large number from a buffer of raw binary words, compatible with GMP's mpz_import.
+ *
+ * Layouts matching the limbs are copied with memcpy, byte-swapped layouts go through AVX512 byte shuffles.
+ *
+ * @param count The number of words in the buffer
+ * @param order 1 for most significant word first, -1 for least significant word first
+ * @param size The number of bytes in each word
+ * @param endian 1 for big-endian words, -1 for little-endian words, 0 for the native endianness
+ * @param op The buffer to read the words from
+ * @return dot_limb_t* The imported number, or NULL if the layout is invalid
+ * @note The sign is not part of the data, the number is non-negative
+ */
+dot_limb_t *dot_import(size_t count, int order, size_t size, int endian, const void *op);
+
+/**
+ * @brief Exports a large number into a buffer of raw binary words, compatible with GMP's mpz_export.
+ *
+ * Leading zero words are not written, the carry flag is exported as the bit above the most significant limb.
+ *
+ * @param rop The buffer to write the words to, or NULL to allocate it from the memory pool, a 1-byte buffer
+ *            with no words written when op is zero
+ * @param countp Receives the number of words written, may be NULL
+ * @param order 1 for most significant word first, -1 for least significant word first
+ * @param size The number of bytes in each word
+ * @param endian 1 for big-endian words, -1 for little-endian words, 0 for the native endianness
+ * @param op The number to export
+ * @return void* The buffer holding the words, or NULL if the layout is invalid
+ * @note The sign is ignored, as in mpz_export
+ */
+void *dot_export(void *rop, size_t *countp, int order, size_t size, int endian, const dot_limb_t *op);
+
+// Flags of dot_mmap_open and dot_mmap_create
+#define DOT_MMAP_WRITE 0x1    // Map writable, stores go to the file
+#define DOT_MMAP_POPULATE 0x2 // Prefault the whole mapping (MAP_POPULATE), for files that fit in memory
+
+/**
+ * @brief Maps a file of raw little-endian limbs as a number, without copying
+ *
+ * The file holds 64-bit limbs, least significant first, in native little-endian order, and its length
+ * sets the size of the number. The mapping is advised sequential for the streaming kernels.
+ *
+ * @param path The file to map, its length must be a non-zero multiple of 8 bytes
+ * @param flags DOT_MMAP_WRITE to use the number as a result, DOT_MMAP_POPULATE to prefault it
+ * @return dot_limb_t* The mapped number, or NULL with errno set on failure
+ * @note Release it with dot_mmap_close, never dot_limb_t_free. Growing it with dot_limb_t_realloc copies the
+ *       limbs to the memory pool and detaches it from the file: later writes stay in memory, dot_mmap_sync
+ *       then fails with EINVAL and dot_mmap_close frees the copy
+ */
+dot_limb_t *dot_mmap_open(const char *path, int flags);
+
+/**
+ * @brief Creates a file of size zero limbs and maps it as a writable result
+ *
+ * The blocks are allocated up front, so running out of space fails here rather than inside a kernel.
+ * The kernels store a carry as a limb when there is room, so a sum of n-limb operands fits in n + 1 limbs.
+ *
+ * @param path The file to create or truncate
+ * @param size The number of limbs
+ * @param flags DOT_MMAP_POPULATE to prefault it, DOT_MMAP_WRITE is implied
+ * @return dot_limb_t* The mapped number, equal to zero, or NULL with errno set on failure
+ */
+dot_limb_t *dot_mmap_create(const char *path, size_t size, int flags);
+
+/**
+ * @brief Writes the modified limbs of a mapped number back to its file
+ *
+ * @param num A number from dot_mmap_open or dot_mmap_create
+ * @return int 0 on success, -1 with errno set on failure, EINVAL once dot_limb_t_realloc has detached it
+ */
+int dot_mmap_sync(dot_limb_t *num);
+
+/**
+ * @brief Unmaps a mapped number, its file keeps the limbs
+ *
+ * A number detached from its file by dot_limb_t_realloc has its pool copy freed, the file keeps the limbs
+ * of the last sync before the detach.
+ *
+ * @param num A number from dot_mmap_open or dot_mmap_create
+ * @return void
+ */
+void dot_mmap_close(dot_limb_t *num);
+
 // /**
 //  * @brief Adjusts the sizes of two dot_limb_t structures to be equal.
 //  *
@@ -1,5 +1,18 @@
 #include "perf_utils.h"
 #include <stdint.h>
+#include <math.h>
+
+/*
+    Hardware counter profiling.
+
+    All events are opened as one group led by the first event that opens, so the kernel schedules them
+    together and read_perf gets every counter from a single read (PERF_FORMAT_GROUP), taken at the same
+    instant. When the group shares the PMU with other groups the kernel multiplexes it; the counts are then
+    scaled by time_enabled / time_running, which is exact for steady loops and an estimate otherwise.
+
+    Events the CPU or the hypervisor does not expose are reported once and skipped, their values read as 0
+    and their derived metrics as NAN, so the same binary runs on hosts with different PMUs.
+*/
 
 extern int CORE_NO;
 
@@ -7,40 +20,146 @@ struct perf_event_attr pe[MAX_EVENTS];
 int fd[MAX_EVENTS];
 long long count;
 const char *event_names[MAX_EVENTS] = {
-    "USER_INSNS", // User Instructions
+    "USER_INSNS",      // User Instructions
+    "USER_CYCLES",     // User Cycles
+    "BRANCH_MISSES",   // Mispredicted branches
+    "L1D_READ_MISSES", // L1 data cache read misses
+    "LLC_READ_MISSES", // Last level cache read misses
 };
+int num_events = PERF_DEFAULT_EVENTS;
+bool event_open[MAX_EVENTS];
+uint64_t perf_time_enabled;
+uint64_t perf_time_running;
+
+static uint32_t event_types[MAX_EVENTS] = {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE,
+    PERF_TYPE_HW_CACHE,
+};
+static uint64_t event_configs[MAX_EVENTS] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+};
+
+static int group_fd = -1;          // Leader of the group, -1 when the group is closed
+static int num_open = 0;           // Events in the group, in the order of the group read
+static int open_index[MAX_EVENTS]; // Event index of each position in the group read
+
+// Function to add an event to the group, returns its index in the values or -1 if the group is full
+int perf_add_event(const char *name, uint32_t type, uint64_t config)
+{
+    if (num_events == MAX_EVENTS)
+    {
+        fprintf(stderr, "Too many perf events, %s not added\n", name);
+        return -1;
+    }
+    event_names[num_events] = name;
+    event_types[num_events] = type;
+    event_configs[num_events] = config;
+    return num_events++;
+}
+
+// Function to add raw PMU events from a list like "UOPS_ISSUED=0x010e,ARITH_DIV=0x0314", returns the number added
+int perf_add_raw_events(const char *list)
+{
+    int added = 0;
+    if (list == NULL)
+    {
+        return 0;
+    }
+    char *copy = strdup(list);
+    if (copy == NULL)
+    {
+        perror("Memory allocation failed for the raw event list\n");
+        exit(EXIT_FAILURE);
+    }
+    char *save = NULL;
+    for (char *item = strtok_r(copy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+    {
+        char *eq = strchr(item, '=');
+        char *end = NULL;
+        uint64_t config = eq != NULL ? strtoull(eq + 1, &end, 0) : 0;
+        if (eq == NULL || eq == item || end == eq + 1 || *end != '\0')
+        {
+            fprintf(stderr, "Invalid raw event %s, expected NAME=CONFIG\n", item);
+            exit(EXIT_FAILURE);
+        }
+        *eq = '\0';
+        // The name is kept for the whole run, like the default names
+        char *name = strdup(item);
+        if (name == NULL || perf_add_event(name, PERF_TYPE_RAW, config) < 0)
+        {
+            free(name);
+            break;
+        }
+        added++;
+    }
+    free(copy);
+    return added;
+}
 
 void initialize_perf()
 {
+    static bool reported[MAX_EVENTS];
+
+    close_perf();
+
     // Define the events to monitor
     memset(pe, 0, sizeof(struct perf_event_attr) * MAX_EVENTS);
-    for (int i = 0; i < MAX_EVENTS; i++)
+    for (int i = 0; i < num_events; i++)
     {
         pe[i].size = sizeof(struct perf_event_attr);
+        pe[i].type = event_types[i];
+        pe[i].config = event_configs[i];
         pe[i].disabled = 1;
-        pe[i].exclude_kernel = 0;
+        pe[i].exclude_kernel = 1;
         pe[i].exclude_hv = 1;
         pe[i].exclude_idle = 1;
         pe[i].exclude_user = 0;
-        pe[i].pinned = 1;
+        pe[i].read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
     }
 
-    // User-level instructions
-    pe[0].type = PERF_TYPE_HARDWARE;
-    pe[0].config = PERF_COUNT_HW_INSTRUCTIONS;
-    pe[0].exclude_kernel = 1;
-    pe[0].exclude_user = 0;
-
-    // // Open the events
-    for (int i = 0; i < MAX_EVENTS; i++)
+    // Open the events, the first one that opens leads the group
+    for (int i = 0; i < num_events; i++)
     {
-        fd[i] = perf_event_open(&pe[i], 0, CORE_NO, -1, 0);
-        if (fd[i] == -1)
+        fd[i] = perf_event_open(&pe[i], 0, CORE_NO, group_fd, 0);
+        event_open[i] = fd[i] != -1;
+        if (!event_open[i])
         {
-            fprintf(stderr, "Error opening event %d: %s\n", i, strerror(errno));
-            exit(EXIT_FAILURE);
+            if (!reported[i])
+            {
+                fprintf(stderr, "Skipping event %s: %s\n", event_names[i], strerror(errno));
+                reported[i] = true;
+            }
+            continue;
+        }
+        if (group_fd == -1)
+        {
+            group_fd = fd[i];
         }
+        open_index[num_open++] = i;
     }
+    if (num_open == 0)
+    {
+        fprintf(stderr, "Error opening events: no perf event is available\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void close_perf()
+{
+    for (int j = 0; j < num_open; j++)
+    {
+        close(fd[open_index[j]]);
+        event_open[open_index[j]] = false;
+    }
+    num_open = 0;
+    group_fd = -1;
 }
 
 long perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu, int group_fd, unsigned long flags)
@@ -53,47 +172,104 @@ long perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu, int g
 
 void read_perf(long long values[])
 {
-    for (int j = 0; j < MAX_EVENTS; j++)
+    // nr, time_enabled, time_running, then one value per event in group order
+    uint64_t buffer[3 + MAX_EVENTS];
+    if (read(group_fd, buffer, sizeof(buffer)) == -1)
+    {
+        perror("Error reading counter value");
+        exit(EXIT_FAILURE);
+    }
+    perf_time_enabled = buffer[1];
+    perf_time_running = buffer[2];
+    if (perf_time_running == 0 && perf_time_enabled != 0)
     {
-        if (read(fd[j], &values[j], sizeof(uint64_t)) == -1)
+        fprintf(stderr, "Perf event group never ran, too many events for the PMU?\n");
+    }
+
+    memset(values, 0, sizeof(long long) * num_events);
+    for (int j = 0; j < num_open && j < (int)buffer[0]; j++)
+    {
+        double scaled = (double)buffer[3 + j];
+        if (perf_time_running != 0 && perf_time_running < perf_time_enabled)
         {
-            perror("Error reading counter value");
-            exit(EXIT_FAILURE);
+            scaled = scaled * perf_time_enabled / perf_time_running;
         }
+        values[open_index[j]] = (long long)scaled;
     }
 }
 
 void write_perf(FILE *file, long long values[])
 {
-    for (int j = 0; j < MAX_EVENTS; j++)
+    for (int j = 0; j < num_events; j++)
     {
         fprintf(file, "%s,", event_names[j]);
     }
     fprintf(file, "\n");
-    for (int j = 0; j < MAX_EVENTS; j++)
+    for (int j = 0; j < num_events; j++)
     {
-        fprintf(file, "%llu,", values[j]);
+        if (event_open[j])
+        {
+            fprintf(file, "%llu,", values[j]);
+        }
+        else
+        {
+            fprintf(file, ",");
+        }
     }
     fprintf(file, "\n");
 }
 
-void start_perf()
+// Function to compute the derived metrics of a measurement over limbs limbs
+void perf_derive(const long long values[], size_t limbs, perf_derived_t *derived)
+{
+    bool cycles = event_open[PERF_EVENT_CYCLES] && values[PERF_EVENT_CYCLES] > 0;
+    derived->ipc = event_open[PERF_EVENT_INSTRUCTIONS] && cycles
+                       ? (double)values[PERF_EVENT_INSTRUCTIONS] / values[PERF_EVENT_CYCLES]
+                       : NAN;
+    derived->branch_misses_per_limb = event_open[PERF_EVENT_BRANCH_MISSES] && limbs
+                                          ? (double)values[PERF_EVENT_BRANCH_MISSES] / limbs
+                                          : NAN;
+    derived->l1d_misses_per_limb = event_open[PERF_EVENT_L1D_MISSES] && limbs
+                                       ? (double)values[PERF_EVENT_L1D_MISSES] / limbs
+                                       : NAN;
+    derived->llc_misses_per_limb = event_open[PERF_EVENT_LLC_MISSES] && limbs
+                                       ? (double)values[PERF_EVENT_LLC_MISSES] / limbs
+                                       : NAN;
+}
+
+// Function to print every available counter and the derived metrics
+void print_perf(FILE *file, long long values[], size_t limbs)
 {
-    for (int j = 0; j < MAX_EVENTS; j++)
+    perf_derived_t derived;
+    for (int j = 0; j < num_events; j++)
+    {
+        if (event_open[j])
+        {
+            fprintf(file, "%s: %lld\n", event_names[j], values[j]);
+        }
+    }
+    perf_derive(values, limbs, &derived);
+    fprintf(file, "IPC: %.3f\n", derived.ipc);
+    fprintf(file, "Branch misses per limb: %.4f\n", derived.branch_misses_per_limb);
+    fprintf(file, "L1D misses per limb: %.4f\n", derived.l1d_misses_per_limb);
+    fprintf(file, "LLC misses per limb: %.4f\n", derived.llc_misses_per_limb);
+    if (perf_time_running < perf_time_enabled)
     {
-        ioctl(fd[j], PERF_EVENT_IOC_RESET, 0);
-        ioctl(fd[j], PERF_EVENT_IOC_ENABLE, 0);
+        fprintf(file, "Multiplexed, counted %.1f%% of the time\n", 100.0 * perf_time_running / perf_time_enabled);
     }
 }
 
+void start_perf()
+{
+    ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
 void stop_perf()
 {
-    for (int j = 0; j < MAX_EVENTS; j++)
+    if (ioctl(group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP) == -1)
     {
-        if (ioctl(fd[j], PERF_EVENT_IOC_DISABLE, 0) == -1)
-        {
-            perror("Error disabling counter");
-            exit(EXIT_FAILURE);
-        }
+        perror("Error disabling counter");
+        exit(EXIT_FAILURE);
     }
-}
\ No newline at end of file
+}
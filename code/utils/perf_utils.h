@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
@@ -10,7 +12,18 @@
 #include <asm/unistd.h>
 #include <errno.h>
 
-#define MAX_EVENTS 1
+#define MAX_EVENTS 16 // Most events in the group, the defaults plus any added events
+
+// Indices of the default events in the values read by read_perf
+enum
+{
+    PERF_EVENT_INSTRUCTIONS = 0, // User-level instructions retired
+    PERF_EVENT_CYCLES,           // User-level core cycles
+    PERF_EVENT_BRANCH_MISSES,    // Mispredicted branches
+    PERF_EVENT_L1D_MISSES,       // L1 data cache read misses
+    PERF_EVENT_LLC_MISSES,       // Last level cache read misses
+    PERF_DEFAULT_EVENTS,
+};
 
 extern int CORE_NO;
 
@@ -18,13 +31,31 @@ extern struct perf_event_attr pe[MAX_EVENTS];
 extern int fd[MAX_EVENTS];
 extern long long count;
 extern const char *event_names[MAX_EVENTS];
+extern int num_events;              // Number of events configured, the defaults first
+extern bool event_open[MAX_EVENTS]; // Whether each event could be opened on this CPU
+extern uint64_t perf_time_enabled;  // Time the group was enabled, from the last read_perf
+extern uint64_t perf_time_running;  // Time the group was counting, from the last read_perf
+
+// Derived metrics of one measurement, NAN where the underlying events are not available
+typedef struct
+{
+    double ipc;                    // Instructions per cycle
+    double branch_misses_per_limb; // Mispredicted branches per limb
+    double l1d_misses_per_limb;    // L1D read misses per limb
+    double llc_misses_per_limb;    // LLC read misses per limb
+} perf_derived_t;
 
 // Function declarations
+int perf_add_event(const char *name, uint32_t type, uint64_t config);
+int perf_add_raw_events(const char *list);
 void initialize_perf();
+void close_perf();
 long perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu, int group_fd, unsigned long flags);
 void read_perf(long long values[]);
 void write_perf(FILE *file, long long values[]);
+void perf_derive(const long long values[], size_t limbs, perf_derived_t *derived);
+void print_perf(FILE *file, long long values[], size_t limbs);
 void start_perf();
 void stop_perf();
 
-#endif // PERF_UTILS_H
\ No newline at end of file
+#endif // PERF_UTILS_H
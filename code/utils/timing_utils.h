@@ -16,6 +16,8 @@
 #include <libgen.h>
 #include <ctype.h>
 #include <sys/stat.h>
+#include <stdint.h>
+#include <cpuid.h>
 
 #define CHUNK 655360 // Chunk size for reading the file
 
@@ -146,6 +148,174 @@ static inline unsigned long long measure_rdtscp_end()
     return ticks;
 }
 
+// TSC calibration
+
+#define TSC_CALIBRATION_NS 50000000 // Length of the CLOCK_MONOTONIC_RAW window when cpuid gives no frequency
+#define TSC_OVERHEAD_ROUNDS 1000    // Empty measurements taken, the smallest one is the overhead
+
+static double tsc_ghz = 0;                  // TSC ticks per nanosecond, 0 until calibrate_tsc runs
+static const char *tsc_source = "none";     // Where tsc_ghz came from, "cpuid" or "clock"
+static unsigned long long tsc_overhead = 0; // Ticks of an empty measure_rdtsc_start/measure_rdtscp_end pair
+
+// Function to find the TSC frequency and the cost of a measurement, returns the frequency in GHz
+static inline double calibrate_tsc()
+{
+    unsigned eax, ebx, ecx, edx;
+    // Leaf 0x15 gives the TSC as a ratio of the crystal clock, when the crystal frequency is enumerated
+    if (__get_cpuid_max(0, NULL) >= 0x15 && __get_cpuid(0x15, &eax, &ebx, &ecx, &edx) && eax && ebx && ecx)
+    {
+        tsc_ghz = (double)ecx * ebx / eax / 1e9;
+        tsc_source = "cpuid";
+    }
+    else
+    {
+        // Count ticks over a fixed stretch of the raw monotonic clock, which NTP does not slew
+        struct timespec ts0, ts1;
+        long long ns;
+        ts0 = get_timespec();
+        unsigned long long t0 = measure_rdtsc_start();
+        do
+        {
+            ts1 = get_timespec();
+            ns = (ts1.tv_sec - ts0.tv_sec) * 1000000000LL + (ts1.tv_nsec - ts0.tv_nsec);
+        } while (ns < TSC_CALIBRATION_NS);
+        unsigned long long t1 = measure_rdtscp_end();
+        tsc_ghz = (double)(t1 - t0) / ns;
+        tsc_source = "clock";
+    }
+
+    tsc_overhead = ~0ULL;
+    for (int i = 0; i < TSC_OVERHEAD_ROUNDS; i++)
+    {
+        unsigned long long t0 = measure_rdtsc_start();
+        unsigned long long t1 = measure_rdtscp_end();
+        if (t1 - t0 < tsc_overhead)
+        {
+            tsc_overhead = t1 - t0;
+        }
+    }
+    return tsc_ghz;
+}
+
+// Function to convert TSC ticks to microseconds, calibrating on first use
+static inline double tsc_ticks_to_us(double ticks)
+{
+    if (tsc_ghz == 0)
+    {
+        calibrate_tsc();
+    }
+    return ticks / (tsc_ghz * 1000.0);
+}
+
+// Latency histograms
+
+/*
+    HDR-style log-linear buckets: values below HIST_SUB_BUCKETS get a bucket each, every power of two above
+    that is split into HIST_SUB_BUCKETS / 2 equal buckets. A recorded value is off by at most 1 / 32 of itself,
+    from a single tick up to 2^64 ticks, in a fixed array with no allocation on the recording path.
+*/
+
+#define HIST_SUB_BITS 6                        // log2 of the number of exact values
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)  // Exact values 0 .. 63, then 32 buckets per power of two
+#define HIST_BUCKETS (HIST_SUB_BUCKETS + (64 - HIST_SUB_BITS) * (HIST_SUB_BUCKETS / 2))
+
+typedef struct
+{
+    uint64_t counts[HIST_BUCKETS]; // Values recorded in each bucket
+    uint64_t total;                // Values recorded
+    uint64_t min, max;             // Exact extremes
+} latency_hist_t;
+
+// Function to empty a histogram
+static inline void hist_init(latency_hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = ~0ULL;
+}
+
+// Function to get the bucket of a value
+static inline int hist_bucket(uint64_t v)
+{
+    if (v < HIST_SUB_BUCKETS)
+    {
+        return (int)v;
+    }
+    int shift = (63 - __builtin_clzll(v)) - HIST_SUB_BITS + 1; // Keeps the top HIST_SUB_BITS bits
+    return HIST_SUB_BUCKETS + (shift - 1) * (HIST_SUB_BUCKETS / 2) + (int)((v >> shift) - HIST_SUB_BUCKETS / 2);
+}
+
+// Function to get the smallest value of a bucket
+static inline uint64_t hist_bucket_low(int bucket)
+{
+    if (bucket < HIST_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    int shift = (bucket - HIST_SUB_BUCKETS) / (HIST_SUB_BUCKETS / 2) + 1;
+    uint64_t top = (bucket - HIST_SUB_BUCKETS) % (HIST_SUB_BUCKETS / 2) + HIST_SUB_BUCKETS / 2;
+    return top << shift;
+}
+
+// Function to get the largest value of a bucket
+static inline uint64_t hist_bucket_high(int bucket)
+{
+    if (bucket < HIST_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    int shift = (bucket - HIST_SUB_BUCKETS) / (HIST_SUB_BUCKETS / 2) + 1;
+    return hist_bucket_low(bucket) + (1ULL << shift) - 1;
+}
+
+// Function to record a value
+static inline void hist_record(latency_hist_t *h, uint64_t v)
+{
+    h->counts[hist_bucket(v)]++;
+    h->total++;
+    h->min = v < h->min ? v : h->min;
+    h->max = v > h->max ? v : h->max;
+}
+
+// Function to get the value at or below which p percent of the recorded values lie
+static inline uint64_t hist_percentile(const latency_hist_t *h, double p)
+{
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * h->total + 0.5);
+    rank = rank < 1 ? 1 : (rank > h->total ? h->total : rank);
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen >= rank)
+        {
+            // Highest value of the bucket, but never past what was recorded
+            uint64_t v = hist_bucket_high(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+// Function to time calls of func one by one into a histogram, in ticks with the measurement overhead removed
+#define HIST_RDTSC(h, calls, func)                                           \
+    do                                                                       \
+    {                                                                        \
+        if (tsc_ghz == 0)                                                    \
+        {                                                                    \
+            calibrate_tsc();                                                 \
+        }                                                                    \
+        for (long __c = 0; __c < (calls); __c++)                             \
+        {                                                                    \
+            unsigned long long __t0 = measure_rdtsc_start();                 \
+            func;                                                            \
+            unsigned long long __t1 = measure_rdtscp_end() - __t0;           \
+            hist_record((h), __t1 > tsc_overhead ? __t1 - tsc_overhead : 0); \
+        }                                                                    \
+    } while (0)
+
 // Function to measure the time taken by a function using the rusage system call
 #define TIME_RUSAGE(t, func)                     \
     do                                           \
@@ -192,7 +362,7 @@ static inline unsigned long long measure_rdtscp_end()
         (t) = (double)__tmp / __times;              \
     } while (0)
 
-// Function to measure the time taken by a function using the rdtsc instruction
+// Function to measure the time taken by a function in microseconds, using the rdtsc instruction
 #define TIME_RDTSC(t, func)                         \
     do                                              \
     {                                               \
@@ -212,8 +382,7 @@ static inline unsigned long long measure_rdtscp_end()
             __t1 = measure_rdtscp_end();            \
             __tmp = __t1 - __t0;                    \
         } while (__tmp < 700000000);                \
-        __tmp = __tmp * 0.000357;                   \
-        (t) = (double)(__tmp) / __times;            \
+        (t) = tsc_ticks_to_us(__tmp) / __times;     \
     } while (0)
 
 // Function to measure the time taken by a function using the rdtsc instruction
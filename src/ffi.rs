@@ -0,0 +1,32 @@
+//! Raw declarations of the slice-level libdot primitives, see code/include/dotlib.h.
+
+/// Operation of a stream, `dot_stream_op_t`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum DotStreamOp {
+    Add = 0,
+    Sub = 1,
+}
+
+/// State of a streaming addition or subtraction, `dot_stream_t`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct DotStream {
+    pub op: DotStreamOp,
+    pub carry: u64,
+    pub limbs: usize,
+}
+
+unsafe extern "C" {
+    /// Adds `n` limbs of `a` and `b` plus `carry` into `result`, returns the carry out.
+    /// `result` may alias `a` or `b`.
+    pub fn dot_add_nc(result: *mut u64, a: *const u64, b: *const u64, n: usize, carry: u64) -> u64;
+
+    /// Subtracts `n` limbs of `y` and `borrow` from `x` into `result`, returns the borrow out.
+    /// `result` may alias `x` or `y`.
+    pub fn dot_sub_nc(result: *mut u64, x: *const u64, y: *const u64, n: usize, borrow: u64) -> u64;
+
+    pub fn dot_stream_init(stream: *mut DotStream, op: DotStreamOp);
+    pub fn dot_stream_update(stream: *mut DotStream, result: *mut u64, a: *const u64, b: *const u64, n: usize);
+    pub fn dot_stream_finish(stream: *mut DotStream) -> u64;
+}
@@ -0,0 +1,328 @@
+//! Safe bindings to libdot, the AVX-512 multi-precision add/sub kernels under `code/`.
+//!
+//! Numbers are limb slices, least significant limb first, as in the C library and GMP's mpn layer.
+//! [`DotInt`] borrows a `&[u64]` and [`DotIntMut`] a `&mut [u64]`, so the kernels run straight on the
+//! caller's memory. Only the by-value `+` and `-` of two [`DotInt`]s allocate, for their result.
+//!
+//! ```
+//! use lia_verif::{DotInt, DotIntMut};
+//!
+//! let a = [u64::MAX, 1];
+//! let b = [1, 2];
+//! assert_eq!(DotInt::new(&a) + DotInt::new(&b), vec![0, 4, 0]);
+//!
+//! let mut acc = [u64::MAX, u64::MAX];
+//! let mut acc = DotIntMut::new(&mut acc);
+//! acc += DotInt::new(&b);
+//! assert_eq!(acc.limbs(), &[0, 2]);
+//! assert!(acc.carry());
+//! ```
+
+use std::ops::{Add, AddAssign, Sub, SubAssign};
+use std::sync::atomic::{AtomicU8, Ordering};
+
+pub mod ffi;
+pub mod portable;
+
+fn check_len(op: &str, a: usize, b: usize, result: usize) {
+    if a != b || result != a {
+        panic!("{} of {} and {} limbs into {} limbs, all three must be equal", op, a, b, result);
+    }
+}
+
+// 0 until the CPU is checked, then AVX512_YES or AVX512_NO
+static AVX512: AtomicU8 = AtomicU8::new(0);
+const AVX512_YES: u8 = 1;
+const AVX512_NO: u8 = 2;
+
+#[cfg(test)]
+thread_local! {
+    // Lets a test run the portable fallback on a CPU that has the kernels
+    static FORCE_PORTABLE: std::cell::Cell<bool> = const { std::cell::Cell::new(false) };
+}
+
+#[cfg(target_arch = "x86_64")]
+fn detect_avx512() -> bool {
+    is_x86_feature_detected!("avx512f")
+        && is_x86_feature_detected!("avx512bw")
+        && is_x86_feature_detected!("avx512vl")
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+fn detect_avx512() -> bool {
+    false
+}
+
+/// Whether the libdot kernels can run here: they need AVX-512F, BW and VL, checked on the first call.
+/// Without them every function and operator of the crate falls back to [`portable`].
+pub fn has_avx512() -> bool {
+    #[cfg(test)]
+    if FORCE_PORTABLE.with(|force| force.get()) {
+        return false;
+    }
+    match AVX512.load(Ordering::Relaxed) {
+        AVX512_YES => true,
+        AVX512_NO => false,
+        _ => {
+            let yes = detect_avx512();
+            AVX512.store(if yes { AVX512_YES } else { AVX512_NO }, Ordering::Relaxed);
+            yes
+        }
+    }
+}
+
+/// Writes `a + b + carry` into `result` with the libdot kernel and returns the carry out.
+///
+/// # Panics
+///
+/// If the three slices differ in length.
+pub fn add_nc(result: &mut [u64], a: &[u64], b: &[u64], carry: bool) -> bool {
+    check_len("add", a.len(), b.len(), result.len());
+    if !has_avx512() {
+        return portable::add_nc(result, a, b, carry);
+    }
+    // SAFETY: all three slices hold result.len() limbs, the kernel masks its loads and stores to n, and the
+    // CPU has the instructions it was compiled for
+    unsafe { ffi::dot_add_nc(result.as_mut_ptr(), a.as_ptr(), b.as_ptr(), result.len(), carry as u64) != 0 }
+}
+
+/// Writes `x - y - borrow` into `result` with the libdot kernel and returns the borrow out.
+///
+/// # Panics
+///
+/// If the three slices differ in length.
+pub fn sub_nc(result: &mut [u64], x: &[u64], y: &[u64], borrow: bool) -> bool {
+    check_len("sub", x.len(), y.len(), result.len());
+    if !has_avx512() {
+        return portable::sub_nc(result, x, y, borrow);
+    }
+    // SAFETY: as in add_nc
+    unsafe { ffi::dot_sub_nc(result.as_mut_ptr(), x.as_ptr(), y.as_ptr(), result.len(), borrow as u64) != 0 }
+}
+
+/// A read-only number borrowed from a limb slice.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct DotInt<'a> {
+    limbs: &'a [u64],
+}
+
+impl<'a> DotInt<'a> {
+    pub fn new(limbs: &'a [u64]) -> Self {
+        DotInt { limbs }
+    }
+
+    pub fn limbs(&self) -> &'a [u64] {
+        self.limbs
+    }
+
+    pub fn len(&self) -> usize {
+        self.limbs.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.limbs.is_empty()
+    }
+
+    /// Writes `self + rhs + carry` into `result`, returns the carry out.
+    pub fn add_into(self, rhs: DotInt<'_>, carry: bool, result: &mut [u64]) -> bool {
+        add_nc(result, self.limbs, rhs.limbs, carry)
+    }
+
+    /// Writes `self - rhs - borrow` into `result`, returns the borrow out.
+    pub fn sub_into(self, rhs: DotInt<'_>, borrow: bool, result: &mut [u64]) -> bool {
+        sub_nc(result, self.limbs, rhs.limbs, borrow)
+    }
+}
+
+impl<'a> From<&'a [u64]> for DotInt<'a> {
+    fn from(limbs: &'a [u64]) -> Self {
+        DotInt::new(limbs)
+    }
+}
+
+/// The exact sum, one limb longer than the operands.
+impl Add<DotInt<'_>> for DotInt<'_> {
+    type Output = Vec<u64>;
+
+    fn add(self, rhs: DotInt<'_>) -> Vec<u64> {
+        let mut result = vec![0; self.len() + 1];
+        let n = self.len();
+        result[n] = self.add_into(rhs, false, &mut result[..n]) as u64;
+        result
+    }
+}
+
+/// The difference modulo 2^(64 n), like `u64::wrapping_sub`; [`DotInt::sub_into`] returns the borrow.
+impl Sub<DotInt<'_>> for DotInt<'_> {
+    type Output = Vec<u64>;
+
+    fn sub(self, rhs: DotInt<'_>) -> Vec<u64> {
+        let mut result = vec![0; self.len()];
+        self.sub_into(rhs, false, &mut result);
+        result
+    }
+}
+
+/// A number updated in place in a borrowed limb slice, with the carry or borrow out of the last update.
+#[derive(Debug)]
+pub struct DotIntMut<'a> {
+    limbs: &'a mut [u64],
+    carry: bool,
+}
+
+impl<'a> DotIntMut<'a> {
+    pub fn new(limbs: &'a mut [u64]) -> Self {
+        DotIntMut { limbs, carry: false }
+    }
+
+    pub fn limbs(&self) -> &[u64] {
+        self.limbs
+    }
+
+    pub fn limbs_mut(&mut self) -> &mut [u64] {
+        self.limbs
+    }
+
+    pub fn as_int(&self) -> DotInt<'_> {
+        DotInt::new(self.limbs)
+    }
+
+    /// Carry out of the last `+=`, or borrow out of the last `-=`.
+    pub fn carry(&self) -> bool {
+        self.carry
+    }
+
+    /// Adds `rhs` and `carry` in place, so a number can be summed in chunks, returns the carry out.
+    pub fn add_assign_carry(&mut self, rhs: DotInt<'_>, carry: bool) -> bool {
+        let n = self.limbs.len();
+        check_len("add", n, rhs.len(), n);
+        if !has_avx512() {
+            self.carry = portable::add_assign_nc(self.limbs, rhs.limbs, carry);
+            return self.carry;
+        }
+        // SAFETY: dot_add_nc allows the result to alias an operand, the CPU has the kernel's instructions
+        self.carry = unsafe {
+            let r = self.limbs.as_mut_ptr();
+            ffi::dot_add_nc(r, r, rhs.limbs.as_ptr(), n, carry as u64) != 0
+        };
+        self.carry
+    }
+
+    /// Subtracts `rhs` and `borrow` in place, returns the borrow out.
+    pub fn sub_assign_borrow(&mut self, rhs: DotInt<'_>, borrow: bool) -> bool {
+        let n = self.limbs.len();
+        check_len("sub", n, rhs.len(), n);
+        if !has_avx512() {
+            self.carry = portable::sub_assign_nc(self.limbs, rhs.limbs, borrow);
+            return self.carry;
+        }
+        // SAFETY: as in add_assign_carry
+        self.carry = unsafe {
+            let r = self.limbs.as_mut_ptr();
+            ffi::dot_sub_nc(r, r, rhs.limbs.as_ptr(), n, borrow as u64) != 0
+        };
+        self.carry
+    }
+}
+
+impl<'a> From<&'a mut [u64]> for DotIntMut<'a> {
+    fn from(limbs: &'a mut [u64]) -> Self {
+        DotIntMut::new(limbs)
+    }
+}
+
+impl AddAssign<DotInt<'_>> for DotIntMut<'_> {
+    fn add_assign(&mut self, rhs: DotInt<'_>) {
+        self.add_assign_carry(rhs, false);
+    }
+}
+
+impl SubAssign<DotInt<'_>> for DotIntMut<'_> {
+    fn sub_assign(&mut self, rhs: DotInt<'_>) {
+        self.sub_assign_borrow(rhs, false);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // xorshift64*, with runs of all-ones and zero limbs so carries ripple across the 8-limb chunks
+    fn operand(state: &mut u64, n: usize) -> Vec<u64> {
+        (0..n)
+            .map(|_| {
+                *state ^= *state >> 12;
+                *state ^= *state << 25;
+                *state ^= *state >> 27;
+                match state.wrapping_mul(0x2545F4914F6CDD1D) {
+                    x if x % 4 == 0 => u64::MAX,
+                    x if x % 4 == 1 => 0,
+                    x => x,
+                }
+            })
+            .collect()
+    }
+
+    #[test]
+    fn matches_portable() {
+        let mut state = 1;
+        for n in 0..70 {
+            for carry in [false, true] {
+                let a = operand(&mut state, n);
+                let b = operand(&mut state, n);
+                let (mut want, mut got) = (vec![0; n], vec![0; n]);
+
+                let want_carry = portable::add_nc(&mut want, &a, &b, carry);
+                assert_eq!(add_nc(&mut got, &a, &b, carry), want_carry);
+                assert_eq!(got, want);
+
+                let want_borrow = portable::sub_nc(&mut want, &a, &b, carry);
+                assert_eq!(sub_nc(&mut got, &a, &b, carry), want_borrow);
+                assert_eq!(got, want);
+            }
+        }
+    }
+
+    #[test]
+    fn operators() {
+        let mut state = 2;
+        for n in [1, 7, 8, 9, 64] {
+            let a = operand(&mut state, n);
+            let b = operand(&mut state, n);
+
+            let sum = DotInt::new(&a) + DotInt::new(&b);
+            let mut want = vec![0; n];
+            let carry = portable::add_nc(&mut want, &a, &b, false);
+            assert_eq!(&sum[..n], &want[..]);
+            assert_eq!(sum[n], carry as u64);
+
+            let mut acc = a.clone();
+            let mut acc = DotIntMut::new(&mut acc);
+            acc += DotInt::new(&b);
+            assert_eq!(acc.limbs(), &want[..]);
+            assert_eq!(acc.carry(), carry);
+            acc -= DotInt::new(&b);
+            assert_eq!(acc.limbs(), &a[..]);
+            assert_eq!(acc.carry(), carry);
+
+            let mut want = vec![0; n];
+            portable::sub_nc(&mut want, &a, &b, false);
+            assert_eq!(DotInt::new(&a) - DotInt::new(&b), want);
+        }
+    }
+
+    #[test]
+    fn portable_fallback() {
+        FORCE_PORTABLE.with(|force| force.set(true));
+        assert!(!has_avx512());
+        matches_portable();
+        operators();
+        FORCE_PORTABLE.with(|force| force.set(false));
+    }
+
+    #[test]
+    #[should_panic]
+    fn length_mismatch() {
+        let _ = DotInt::new(&[1, 2]) + DotInt::new(&[1]);
+    }
+}
@@ -0,0 +1,54 @@
+//! Pure-Rust limb loops with the semantics of `dot_add_nc`/`dot_sub_nc`, the baseline of `cargo bench`
+//! and the reference of the tests. They work on any target, but run one limb at a time.
+
+/// Writes `a + b + carry` into `result`, returns the carry out. The slices must have the same length.
+pub fn add_nc(result: &mut [u64], a: &[u64], b: &[u64], carry: bool) -> bool {
+    assert!(a.len() == result.len() && b.len() == result.len());
+    let mut carry = carry;
+    for ((r, &x), &y) in result.iter_mut().zip(a).zip(b) {
+        let (s, c1) = x.overflowing_add(y);
+        let (s, c2) = s.overflowing_add(carry as u64);
+        *r = s;
+        carry = c1 | c2;
+    }
+    carry
+}
+
+/// Writes `x - y - borrow` into `result`, returns the borrow out. The slices must have the same length.
+pub fn sub_nc(result: &mut [u64], x: &[u64], y: &[u64], borrow: bool) -> bool {
+    assert!(x.len() == result.len() && y.len() == result.len());
+    let mut borrow = borrow;
+    for ((r, &a), &b) in result.iter_mut().zip(x).zip(y) {
+        let (d, b1) = a.overflowing_sub(b);
+        let (d, b2) = d.overflowing_sub(borrow as u64);
+        *r = d;
+        borrow = b1 | b2;
+    }
+    borrow
+}
+
+/// Adds `b + carry` to `acc` in place, returns the carry out. The slices must have the same length.
+pub fn add_assign_nc(acc: &mut [u64], b: &[u64], carry: bool) -> bool {
+    assert!(b.len() == acc.len());
+    let mut carry = carry;
+    for (r, &y) in acc.iter_mut().zip(b) {
+        let (s, c1) = r.overflowing_add(y);
+        let (s, c2) = s.overflowing_add(carry as u64);
+        *r = s;
+        carry = c1 | c2;
+    }
+    carry
+}
+
+/// Subtracts `y + borrow` from `acc` in place, returns the borrow out. The slices must have the same length.
+pub fn sub_assign_nc(acc: &mut [u64], y: &[u64], borrow: bool) -> bool {
+    assert!(y.len() == acc.len());
+    let mut borrow = borrow;
+    for (r, &b) in acc.iter_mut().zip(y) {
+        let (d, b1) = r.overflowing_sub(b);
+        let (d, b2) = d.overflowing_sub(borrow as u64);
+        *r = d;
+        borrow = b1 | b2;
+    }
+    borrow
+}